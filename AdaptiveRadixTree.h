@@ -0,0 +1,878 @@
+/**********************************
+ * FILE NAME: AdaptiveRadixTree.h
+ *
+ * DESCRIPTION: Adaptive radix tree (ART) map with path compression
+ **********************************/
+
+#ifndef ADAPTIVERADIXTREE_H_
+#define ADAPTIVERADIXTREE_H_
+
+#include "stdincludes.h"
+#include "SlabArena.h"
+#include <stdint.h>
+#include <utility>
+#include <new>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Macros
+ */
+// compressed path bytes kept inline in an inner node; longer paths are read from a leaf key
+#define ART_MAX_PREFIX 8
+
+/**
+ * CLASS NAME: AdaptiveRadixTree
+ *
+ * DESCRIPTION: Ordered map over byte string keys. Inner nodes branch on one
+ * 				key byte and come in four sizes (4, 16, 48 and 256 children),
+ * 				growing and shrinking with their fan-out. Chains of single
+ * 				child nodes are collapsed into a prefix stored in the node
+ * 				below (path compression). A key that ends at an inner node
+ * 				is kept in that node's terminal slot.
+ *
+ * 				Leaves hold the full key and value and nothing else. Leaves
+ * 				and nodes are carved from the tree's own SlabArena, so they
+ * 				carry no malloc header. Point lookups skip the compressed
+ * 				prefixes on the way down and compare the full key once at the
+ * 				leaf. Iterators step to the next key with one descent
+ * 				(O(key length)), so they need no parent links or stack.
+ *
+ * 				K must convert to string_view (string or string_view). The
+ * 				interface mirrors the subset of std::map used by the storage
+ * 				layer. Iterators stay valid until their own entry is erased.
+ */
+template <class K, class V>
+class AdaptiveRadixTree {
+public:
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef std::pair<const K, V> value_type;
+	typedef size_t size_type;
+
+private:
+	struct Leaf {
+		value_type value;
+		template <class KK, class VV>
+		Leaf(KK &&key, VV &&v): value(std::forward<KK>(key), std::forward<VV>(v)) {}
+	};
+	enum NodeType {NODE4, NODE16, NODE48, NODE256};
+	// reference to a child: an Inner pointer, or a Leaf pointer with the low bit set
+	typedef uintptr_t Ref;
+	struct Inner {
+		uint8_t type;
+		uint16_t count;
+		uint32_t prefixLen;
+		unsigned char prefix[ART_MAX_PREFIX];
+		Leaf *terminal;
+	};
+	// Node4 and Node16 keep their key bytes sorted
+	struct Node4 : Inner {
+		unsigned char keys[4];
+		Ref children[4];
+	};
+	struct Node16 : Inner {
+		unsigned char keys[16];
+		Ref children[16];
+	};
+	// index maps a key byte to its child slot plus one, zero meaning none
+	struct Node48 : Inner {
+		unsigned char index[256];
+		Ref children[48];
+	};
+	struct Node256 : Inner {
+		Ref children[256];
+	};
+
+public:
+	template <class LeafPtr, class RefT, class Ptr>
+	class Iterator {
+	public:
+		Iterator(): tree(NULL), leaf(NULL) {}
+		Iterator(const AdaptiveRadixTree *tree, LeafPtr leaf): tree(tree), leaf(leaf) {}
+		// allow iterator -> const_iterator
+		template <class L, class R, class P>
+		Iterator(const Iterator<L, R, P> &another): tree(another.tree), leaf(another.leaf) {}
+		RefT operator *() const {
+			return leaf->value;
+		}
+		Ptr operator ->() const {
+			return &leaf->value;
+		}
+		Iterator& operator ++() {
+			leaf = tree->boundLeaf(keyOf(leaf), true);
+			return *this;
+		}
+		Iterator operator ++(int) {
+			Iterator old = *this;
+			++*this;
+			return old;
+		}
+		bool operator ==(const Iterator &another) const {
+			return leaf == another.leaf;
+		}
+		bool operator !=(const Iterator &another) const {
+			return leaf != another.leaf;
+		}
+		const AdaptiveRadixTree *tree;
+		LeafPtr leaf;
+	};
+	typedef Iterator<Leaf *, value_type &, value_type *> iterator;
+	typedef Iterator<const Leaf *, const value_type &, const value_type *> const_iterator;
+
+	AdaptiveRadixTree(): root(0), size_(0) {}
+	virtual ~AdaptiveRadixTree() {
+		clear();
+	}
+
+	iterator begin() {
+		return iterator(this, root != 0 ? minLeaf(root) : NULL);
+	}
+	iterator end() {
+		return iterator(this, NULL);
+	}
+	const_iterator begin() const {
+		return const_iterator(this, root != 0 ? minLeaf(root) : NULL);
+	}
+	const_iterator end() const {
+		return const_iterator(this, NULL);
+	}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+	size_t size() const {
+		return size_;
+	}
+
+	template <class KK>
+	iterator find(const KK &key) {
+		return iterator(this, findLeaf(string_view(key)));
+	}
+	template <class KK>
+	const_iterator find(const KK &key) const {
+		return const_iterator(this, findLeaf(string_view(key)));
+	}
+	template <class KK>
+	size_t count(const KK &key) const {
+		return findLeaf(string_view(key)) != NULL ? 1 : 0;
+	}
+	// first entry whose key is not less than key
+	template <class KK>
+	iterator lower_bound(const KK &key) {
+		return iterator(this, boundLeaf(string_view(key), false));
+	}
+	template <class KK>
+	const_iterator lower_bound(const KK &key) const {
+		return const_iterator(this, boundLeaf(string_view(key), false));
+	}
+
+	/**
+	 * Inserts (key, value) unless key is already present.
+	 * Returns the position of the key and whether an insert happened.
+	 */
+	template <class KK, class VV>
+	std::pair<iterator, bool> emplace(KK &&key, VV &&value) {
+		string_view view(key);
+		std::pair<Leaf *, bool> slot = insertLeaf(view, [&]() {
+			return new (allocate(sizeof(Leaf))) Leaf(std::forward<KK>(key), std::forward<VV>(value));
+		});
+		return std::make_pair(iterator(this, slot.first), slot.second);
+	}
+	// the hint is accepted for std::map compatibility and ignored
+	template <class KK, class VV>
+	iterator emplace_hint(const_iterator hint, KK &&key, VV &&value) {
+		return emplace(std::forward<KK>(key), std::forward<VV>(value)).first;
+	}
+	std::pair<iterator, bool> insert(const value_type &value) {
+		return emplace(value.first, value.second);
+	}
+	V& operator [](const K &key) {
+		return emplace(key, V()).first->second;
+	}
+
+	/**
+	 * Single descent find-or-insert. The stored key is produced by makeKey()
+	 * and only when an insert happens (see FlatHashMap::lazy_emplace).
+	 */
+	template <class KK, class MakeKey>
+	std::pair<iterator, bool> lazy_emplace(const KK &key, MakeKey makeKey) {
+		std::pair<Leaf *, bool> slot = insertLeaf(string_view(key), [&]() {
+			return new (allocate(sizeof(Leaf))) Leaf(makeKey(), V());
+		});
+		return std::make_pair(iterator(this, slot.first), slot.second);
+	}
+
+	void erase(iterator it) {
+		erase(string_view(it.leaf->value.first));
+	}
+	template <class KK>
+	size_t erase(const KK &key) {
+		Leaf *removed = eraseFrom(root, string_view(key), 0);
+		if ( removed == NULL ) {
+			return 0;
+		}
+		freeLeaf(removed);
+		size_--;
+		return 1;
+	}
+
+	void clear() {
+		freeTree(root);
+		pool.clear();
+		root = 0;
+		size_ = 0;
+	}
+
+	void swap(AdaptiveRadixTree &another) {
+		std::swap(root, another.root);
+		std::swap(size_, another.size_);
+		pool.swap(another.pool);
+	}
+
+private:
+	Ref root;
+	size_t size_;
+	SlabArena pool;
+
+	AdaptiveRadixTree(const AdaptiveRadixTree &another);
+	AdaptiveRadixTree& operator =(const AdaptiveRadixTree &another);
+
+	static bool isLeaf(Ref ref) {
+		return (ref & 1) != 0;
+	}
+	static Leaf *leafOf(Ref ref) {
+		return (Leaf *)(ref & ~(Ref)1);
+	}
+	static Inner *innerOf(Ref ref) {
+		return (Inner *) ref;
+	}
+	static Ref refOf(Leaf *leaf) {
+		return (Ref) leaf | 1;
+	}
+	static Ref refOf(Inner *node) {
+		return (Ref) node;
+	}
+	static string_view keyOf(const Leaf *leaf) {
+		return string_view(leaf->value.first);
+	}
+	static unsigned char byteAt(string_view key, size_t depth) {
+		return (unsigned char) key[depth];
+	}
+
+	/**
+	 * Slot of the child for byte b, or NULL
+	 */
+	static Ref *findChild(Inner *node, unsigned char b) {
+		switch ( node->type ) {
+			case NODE4: {
+				Node4 *n = static_cast<Node4 *>(node);
+				for ( int i = 0; i < n->count; i++ ) {
+					if ( n->keys[i] == b ) {
+						return &n->children[i];
+					}
+				}
+				return NULL;
+			}
+			case NODE16: {
+				Node16 *n = static_cast<Node16 *>(node);
+#ifdef __SSE2__
+				__m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i *>(n->keys));
+				int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8((char) b), keys)) & ((1 << n->count) - 1);
+				return mask ? &n->children[__builtin_ctz(mask)] : NULL;
+#else
+				for ( int i = 0; i < n->count; i++ ) {
+					if ( n->keys[i] == b ) {
+						return &n->children[i];
+					}
+				}
+				return NULL;
+#endif
+			}
+			case NODE48: {
+				Node48 *n = static_cast<Node48 *>(node);
+				return n->index[b] ? &n->children[n->index[b] - 1] : NULL;
+			}
+			default: {
+				Node256 *n = static_cast<Node256 *>(node);
+				return n->children[b] ? &n->children[b] : NULL;
+			}
+		}
+	}
+
+	/**
+	 * Child with the smallest byte above b (b = -1 for the first child), or 0
+	 */
+	static Ref childAbove(const Inner *node, int b) {
+		switch ( node->type ) {
+			case NODE4:
+			case NODE16: {
+				const unsigned char *keys = node->type == NODE4 ? static_cast<const Node4 *>(node)->keys
+						: static_cast<const Node16 *>(node)->keys;
+				const Ref *children = node->type == NODE4 ? static_cast<const Node4 *>(node)->children
+						: static_cast<const Node16 *>(node)->children;
+				for ( int i = 0; i < node->count; i++ ) {
+					if ( keys[i] > b ) {
+						return children[i];
+					}
+				}
+				return 0;
+			}
+			case NODE48: {
+				const Node48 *n = static_cast<const Node48 *>(node);
+				for ( int i = b + 1; i < 256; i++ ) {
+					if ( n->index[i] ) {
+						return n->children[n->index[i] - 1];
+					}
+				}
+				return 0;
+			}
+			default: {
+				const Node256 *n = static_cast<const Node256 *>(node);
+				for ( int i = b + 1; i < 256; i++ ) {
+					if ( n->children[i] ) {
+						return n->children[i];
+					}
+				}
+				return 0;
+			}
+		}
+	}
+
+	static Leaf *minLeaf(Ref ref) {
+		while ( !isLeaf(ref) ) {
+			Inner *node = innerOf(ref);
+			if ( node->terminal != NULL ) {
+				return node->terminal;
+			}
+			ref = childAbove(node, -1);
+		}
+		return leafOf(ref);
+	}
+
+	/**
+	 * Set the compressed path of node to len bytes of key starting at from
+	 */
+	static void setPrefix(Inner *node, string_view key, size_t from, size_t len) {
+		node->prefixLen = (uint32_t) len;
+		memcpy(node->prefix, key.data() + from, len < ART_MAX_PREFIX ? len : ART_MAX_PREFIX);
+	}
+
+	/**
+	 * Number of leading bytes of node's compressed path (which starts at
+	 * depth) that match key
+	 */
+	static size_t prefixMismatch(Inner *node, string_view key, size_t depth) {
+		string_view full;
+		for ( size_t i = 0; i < node->prefixLen; i++ ) {
+			if ( depth + i >= key.size() ) {
+				return i;
+			}
+			unsigned char c;
+			if ( i < ART_MAX_PREFIX ) {
+				c = node->prefix[i];
+			}
+			else {
+				if ( full.data() == NULL ) {
+					full = keyOf(minLeaf(refOf(node)));
+				}
+				c = byteAt(full, depth + i);
+			}
+			if ( c != byteAt(key, depth + i) ) {
+				return i;
+			}
+		}
+		return node->prefixLen;
+	}
+
+	static void copyHeader(Inner *to, const Inner *from) {
+		to->count = from->count;
+		to->prefixLen = from->prefixLen;
+		memcpy(to->prefix, from->prefix, ART_MAX_PREFIX);
+		to->terminal = from->terminal;
+	}
+
+	/**
+	 * Add child under byte b, growing node into the next size when full.
+	 * ref is the slot that points at node.
+	 */
+	void addChild(Ref &ref, Inner *node, unsigned char b, Ref child) {
+		switch ( node->type ) {
+			case NODE4: {
+				Node4 *n = static_cast<Node4 *>(node);
+				if ( n->count < 4 ) {
+					int i = n->count;
+					while ( i > 0 && n->keys[i - 1] > b ) {
+						n->keys[i] = n->keys[i - 1];
+						n->children[i] = n->children[i - 1];
+						i--;
+					}
+					n->keys[i] = b;
+					n->children[i] = child;
+					n->count++;
+					return;
+				}
+				Node16 *grown = newNode<Node16>();
+				grown->type = NODE16;
+				copyHeader(grown, n);
+				memcpy(grown->keys, n->keys, sizeof(n->keys));
+				memcpy(grown->children, n->children, sizeof(n->children));
+				freeInner(n);
+				ref = refOf(grown);
+				addChild(ref, grown, b, child);
+				return;
+			}
+			case NODE16: {
+				Node16 *n = static_cast<Node16 *>(node);
+				if ( n->count < 16 ) {
+					int i = n->count;
+					while ( i > 0 && n->keys[i - 1] > b ) {
+						n->keys[i] = n->keys[i - 1];
+						n->children[i] = n->children[i - 1];
+						i--;
+					}
+					n->keys[i] = b;
+					n->children[i] = child;
+					n->count++;
+					return;
+				}
+				Node48 *grown = newNode<Node48>();
+				grown->type = NODE48;
+				copyHeader(grown, n);
+				for ( int i = 0; i < n->count; i++ ) {
+					grown->index[n->keys[i]] = (unsigned char)(i + 1);
+					grown->children[i] = n->children[i];
+				}
+				freeInner(n);
+				ref = refOf(grown);
+				addChild(ref, grown, b, child);
+				return;
+			}
+			case NODE48: {
+				Node48 *n = static_cast<Node48 *>(node);
+				if ( n->count < 48 ) {
+					int slot = 0;
+					while ( n->children[slot] != 0 ) {
+						slot++;
+					}
+					n->children[slot] = child;
+					n->index[b] = (unsigned char)(slot + 1);
+					n->count++;
+					return;
+				}
+				Node256 *grown = newNode<Node256>();
+				grown->type = NODE256;
+				copyHeader(grown, n);
+				for ( int i = 0; i < 256; i++ ) {
+					if ( n->index[i] ) {
+						grown->children[i] = n->children[n->index[i] - 1];
+					}
+				}
+				freeInner(n);
+				ref = refOf(grown);
+				addChild(ref, grown, b, child);
+				return;
+			}
+			default: {
+				Node256 *n = static_cast<Node256 *>(node);
+				n->children[b] = child;
+				n->count++;
+				return;
+			}
+		}
+	}
+
+	/**
+	 * Remove the child under byte b, shrinking node into the next smaller
+	 * size once it is sparse enough. ref is the slot that points at node.
+	 */
+	void removeChild(Ref &ref, Inner *node, unsigned char b) {
+		switch ( node->type ) {
+			case NODE4:
+			case NODE16: {
+				unsigned char *keys = node->type == NODE4 ? static_cast<Node4 *>(node)->keys
+						: static_cast<Node16 *>(node)->keys;
+				Ref *children = node->type == NODE4 ? static_cast<Node4 *>(node)->children
+						: static_cast<Node16 *>(node)->children;
+				int i = 0;
+				while ( keys[i] != b ) {
+					i++;
+				}
+				for ( ; i + 1 < node->count; i++ ) {
+					keys[i] = keys[i + 1];
+					children[i] = children[i + 1];
+				}
+				node->count--;
+				if ( node->type == NODE16 && node->count <= 3 ) {
+					Node4 *shrunk = newNode<Node4>();
+					shrunk->type = NODE4;
+					copyHeader(shrunk, node);
+					memcpy(shrunk->keys, keys, node->count);
+					memcpy(shrunk->children, children, node->count * sizeof(Ref));
+					freeInner(node);
+					ref = refOf(shrunk);
+				}
+				return;
+			}
+			case NODE48: {
+				Node48 *n = static_cast<Node48 *>(node);
+				n->children[n->index[b] - 1] = 0;
+				n->index[b] = 0;
+				n->count--;
+				if ( n->count <= 12 ) {
+					Node16 *shrunk = newNode<Node16>();
+					shrunk->type = NODE16;
+					copyHeader(shrunk, n);
+					int j = 0;
+					for ( int i = 0; i < 256; i++ ) {
+						if ( n->index[i] ) {
+							shrunk->keys[j] = (unsigned char) i;
+							shrunk->children[j++] = n->children[n->index[i] - 1];
+						}
+					}
+					freeInner(n);
+					ref = refOf(shrunk);
+				}
+				return;
+			}
+			default: {
+				Node256 *n = static_cast<Node256 *>(node);
+				n->children[b] = 0;
+				n->count--;
+				if ( n->count <= 37 ) {
+					Node48 *shrunk = newNode<Node48>();
+					shrunk->type = NODE48;
+					copyHeader(shrunk, n);
+					int j = 0;
+					for ( int i = 0; i < 256; i++ ) {
+						if ( n->children[i] ) {
+							shrunk->children[j] = n->children[i];
+							shrunk->index[i] = (unsigned char)(++j);
+						}
+					}
+					freeInner(n);
+					ref = refOf(shrunk);
+				}
+				return;
+			}
+		}
+	}
+
+	void *allocate(size_t size) {
+		return pool.allocate(size);
+	}
+
+	template <class T>
+	T *newNode() {
+		return new (allocate(sizeof(T))) T();
+	}
+
+	void freeInner(Inner *node) {
+		static const size_t sizes[] = {sizeof(Node4), sizeof(Node16), sizeof(Node48), sizeof(Node256)};
+		pool.deallocate((char *) node, sizes[node->type]);
+	}
+
+	void freeLeaf(Leaf *leaf) {
+		leaf->~Leaf();
+		pool.deallocate((char *) leaf, sizeof(Leaf));
+	}
+
+	/**
+	 * Run the leaf destructors below ref; the memory itself is dropped with
+	 * the pool
+	 */
+	static void freeTree(Ref ref) {
+		if ( ref == 0 ) {
+			return;
+		}
+		if ( isLeaf(ref) ) {
+			leafOf(ref)->~Leaf();
+			return;
+		}
+		Inner *node = innerOf(ref);
+		if ( node->terminal != NULL ) {
+			node->terminal->~Leaf();
+		}
+		switch ( node->type ) {
+			case NODE4:
+				for ( int i = 0; i < node->count; i++ ) {
+					freeTree(static_cast<Node4 *>(node)->children[i]);
+				}
+				break;
+			case NODE16:
+				for ( int i = 0; i < node->count; i++ ) {
+					freeTree(static_cast<Node16 *>(node)->children[i]);
+				}
+				break;
+			case NODE48:
+				for ( int i = 0; i < 48; i++ ) {
+					freeTree(static_cast<Node48 *>(node)->children[i]);
+				}
+				break;
+			default:
+				for ( int i = 0; i < 256; i++ ) {
+					freeTree(static_cast<Node256 *>(node)->children[i]);
+				}
+				break;
+		}
+	}
+
+	/**
+	 * Point lookup. Compressed paths are skipped without comparing; the full
+	 * key is compared once at the end.
+	 */
+	Leaf *findLeaf(string_view key) const {
+		Ref ref = root;
+		size_t depth = 0;
+		while ( ref != 0 ) {
+			if ( isLeaf(ref) ) {
+				Leaf *leaf = leafOf(ref);
+				return keyOf(leaf) == key ? leaf : NULL;
+			}
+			Inner *node = innerOf(ref);
+			depth += node->prefixLen;
+			if ( key.size() <= depth ) {
+				Leaf *leaf = node->terminal;
+				return leaf != NULL && key.size() == depth && keyOf(leaf) == key ? leaf : NULL;
+			}
+			Ref *child = findChild(node, byteAt(key, depth));
+			if ( child == NULL ) {
+				return NULL;
+			}
+			ref = *child;
+			depth++;
+		}
+		return NULL;
+	}
+
+	/**
+	 * First leaf whose key is greater than key (strict) or not less than it.
+	 * fallback is the nearest subtree to the right of the path walked so far;
+	 * its smallest leaf is the answer once the path runs out.
+	 */
+	Leaf *boundLeaf(string_view key, bool strict) const {
+		Ref ref = root;
+		Ref fallback = 0;
+		size_t depth = 0;
+		if ( ref == 0 ) {
+			return NULL;
+		}
+		while ( true ) {
+			if ( isLeaf(ref) ) {
+				Leaf *leaf = leafOf(ref);
+				int order = keyOf(leaf).compare(key);
+				if ( order > 0 || (order == 0 && !strict) ) {
+					return leaf;
+				}
+				return fallback != 0 ? minLeaf(fallback) : NULL;
+			}
+			Inner *node = innerOf(ref);
+			size_t matched = prefixMismatch(node, key, depth);
+			if ( matched < node->prefixLen ) {
+				// key ends inside the path, or leaves it below or above every key here
+				if ( depth + matched >= key.size()
+						|| byteAt(key, depth + matched) < byteAt(keyOf(minLeaf(ref)), depth + matched) ) {
+					return minLeaf(ref);
+				}
+				return fallback != 0 ? minLeaf(fallback) : NULL;
+			}
+			depth += node->prefixLen;
+			if ( key.size() == depth ) {
+				if ( node->terminal == NULL || !strict ) {
+					return minLeaf(ref);
+				}
+				return minLeaf(childAbove(node, -1));
+			}
+			unsigned char b = byteAt(key, depth);
+			Ref above = childAbove(node, b);
+			if ( above != 0 ) {
+				fallback = above;
+			}
+			Ref *child = findChild(node, b);
+			if ( child == NULL ) {
+				return fallback != 0 ? minLeaf(fallback) : NULL;
+			}
+			ref = *child;
+			depth++;
+		}
+	}
+
+	/**
+	 * Put a leaf into a fresh node either as its terminal (the key ends at
+	 * depth) or as the child for its byte at depth
+	 */
+	void place(Node4 *node, Leaf *leaf, size_t depth) {
+		string_view key = keyOf(leaf);
+		if ( key.size() == depth ) {
+			node->terminal = leaf;
+			return;
+		}
+		Ref ref = refOf(node);
+		addChild(ref, node, byteAt(key, depth), refOf(leaf));
+	}
+
+	/**
+	 * Find key, or insert the leaf built by makeLeaf() in its place
+	 */
+	template <class MakeLeaf>
+	std::pair<Leaf *, bool> insertLeaf(string_view key, MakeLeaf makeLeaf) {
+		if ( root == 0 ) {
+			Leaf *leaf = makeLeaf();
+			root = refOf(leaf);
+			size_++;
+			return std::make_pair(leaf, true);
+		}
+		Ref *slot = &root;
+		size_t depth = 0;
+		while ( true ) {
+			Ref ref = *slot;
+			if ( isLeaf(ref) ) {
+				Leaf *existing = leafOf(ref);
+				string_view other = keyOf(existing);
+				if ( other == key ) {
+					return std::make_pair(existing, false);
+				}
+				// split the leaf into a node over the bytes both keys share
+				size_t common = depth;
+				size_t limit = min(other.size(), key.size());
+				while ( common < limit && other[common] == key[common] ) {
+					common++;
+				}
+				Node4 *node = newNode<Node4>();
+				node->type = NODE4;
+				setPrefix(node, key, depth, common - depth);
+				Leaf *leaf = makeLeaf();
+				// the caller's key may have been moved into the leaf
+				key = keyOf(leaf);
+				place(node, existing, common);
+				place(node, leaf, common);
+				*slot = refOf(node);
+				size_++;
+				return std::make_pair(leaf, true);
+			}
+
+			Inner *node = innerOf(ref);
+			size_t matched = prefixMismatch(node, key, depth);
+			if ( matched < node->prefixLen ) {
+				// split the compressed path where key leaves it
+				string_view full = keyOf(minLeaf(ref));
+				unsigned char c = byteAt(full, depth + matched);
+				Node4 *split = newNode<Node4>();
+				split->type = NODE4;
+				setPrefix(split, key, depth, matched);
+				setPrefix(node, full, depth + matched + 1, node->prefixLen - matched - 1);
+				Ref splitRef = refOf(split);
+				addChild(splitRef, split, c, ref);
+				Leaf *leaf = makeLeaf();
+				// the caller's key may have been moved into the leaf
+				key = keyOf(leaf);
+				if ( key.size() == depth + matched ) {
+					split->terminal = leaf;
+				}
+				else {
+					addChild(splitRef, split, byteAt(key, depth + matched), refOf(leaf));
+				}
+				*slot = splitRef;
+				size_++;
+				return std::make_pair(leaf, true);
+			}
+			depth += node->prefixLen;
+
+			if ( key.size() == depth ) {
+				if ( node->terminal != NULL ) {
+					return std::make_pair(node->terminal, false);
+				}
+				node->terminal = makeLeaf();
+				size_++;
+				return std::make_pair(node->terminal, true);
+			}
+
+			unsigned char b = byteAt(key, depth);
+			Ref *child = findChild(node, b);
+			if ( child != NULL ) {
+				slot = child;
+				depth++;
+				continue;
+			}
+			Leaf *leaf = makeLeaf();
+			addChild(*slot, node, b, refOf(leaf));
+			size_++;
+			return std::make_pair(leaf, true);
+		}
+	}
+
+	/**
+	 * Remove key below the node at slot (whose path starts at depth).
+	 * Returns the detached leaf.
+	 */
+	Leaf *eraseFrom(Ref &slot, string_view key, size_t depth) {
+		Ref ref = slot;
+		if ( ref == 0 ) {
+			return NULL;
+		}
+		if ( isLeaf(ref) ) {
+			Leaf *leaf = leafOf(ref);
+			if ( keyOf(leaf) != key ) {
+				return NULL;
+			}
+			slot = 0;
+			return leaf;
+		}
+		Inner *node = innerOf(ref);
+		if ( prefixMismatch(node, key, depth) < node->prefixLen ) {
+			return NULL;
+		}
+		size_t below = depth + node->prefixLen;
+		Leaf *removed;
+		if ( key.size() == below ) {
+			if ( node->terminal == NULL || keyOf(node->terminal) != key ) {
+				return NULL;
+			}
+			removed = node->terminal;
+			node->terminal = NULL;
+		}
+		else {
+			unsigned char b = byteAt(key, below);
+			Ref *child = findChild(node, b);
+			if ( child == NULL ) {
+				return NULL;
+			}
+			if ( !isLeaf(*child) ) {
+				return eraseFrom(*child, key, below + 1);
+			}
+			removed = leafOf(*child);
+			if ( keyOf(removed) != key ) {
+				return NULL;
+			}
+			removeChild(slot, node, b);
+		}
+		collapse(slot, depth);
+		return removed;
+	}
+
+	/**
+	 * Replace a node left with a single entry by that entry, merging the
+	 * compressed paths when the entry is an inner node
+	 */
+	void collapse(Ref &slot, size_t depth) {
+		Inner *node = innerOf(slot);
+		if ( node->count == 0 ) {
+			slot = refOf(node->terminal);
+			freeInner(node);
+			return;
+		}
+		if ( node->count > 1 || node->terminal != NULL ) {
+			return;
+		}
+		Ref child = childAbove(node, -1);
+		if ( !isLeaf(child) ) {
+			Inner *below = innerOf(child);
+			setPrefix(below, keyOf(minLeaf(child)), depth, node->prefixLen + 1 + below->prefixLen);
+		}
+		slot = child;
+		freeInner(node);
+	}
+};
+
+#endif /* ADAPTIVERADIXTREE_H_ */
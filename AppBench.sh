@@ -0,0 +1,51 @@
+#!/bin/bash
+
+#################################################
+# FILE NAME: AppBench.sh
+#
+# DESCRIPTION: Times the Application test workloads with every HashTable
+#              storage backend (see HASHTABLE in the Makefile)
+#
+# RUN PROCEDURE:
+# $ chmod +x AppBench.sh
+# $ ./AppBench.sh [runs]
+#################################################
+
+RUNS=${1:-3}
+BACKENDS="map flat art"
+TESTS="create delete read update"
+TIMEFORMAT="%R"
+
+printf "%-8s" "backend"
+for test in ${TESTS}
+do
+	printf "%10s" "${test}"
+done
+echo "   (seconds, best of ${RUNS})"
+
+for backend in ${BACKENDS}
+do
+	make clean > /dev/null 2>&1
+	make HASHTABLE=${backend} > /dev/null 2>&1
+	if [ $? -ne 0 ]
+	then
+		echo "COMPILATION ERROR (${backend}) !!!"
+		exit 1
+	fi
+	printf "%-8s" "${backend}"
+	for test in ${TESTS}
+	do
+		best=""
+		for (( run = 0; run < RUNS; run++ ))
+		do
+			elapsed=$( { time ./Application ./testcases/${test}.conf > /dev/null 2>&1; } 2>&1 )
+			if [ -z "${best}" ] || awk -v a="${elapsed}" -v b="${best}" 'BEGIN { exit !(a < b) }'
+			then
+				best=${elapsed}
+			fi
+		done
+		printf "%10s" "${best}"
+	done
+	echo ""
+done
+make clean > /dev/null 2>&1
@@ -77,13 +77,14 @@ Application::Application(char *infile) {
  * Destructor
  */
 Application::~Application() {
-	delete log;
 	delete en;
 	delete en1;
 	for ( int i = 0; i < par->EN_GPSZ; i++ ) {
 		delete mp1[i];
 		delete mp2[i];
 	}
+	// after the nodes, which may still log as they shut down
+	delete log;
 	free(mp1);
 	free(mp2);
 	delete par;
@@ -188,6 +189,7 @@ void Application::mp1Run() {
  * 				including:
  * 				1) Ring operations
  * 				2) CRUD operations
+ * 				3) Sending the messages batched by each node
  */
 void Application::mp2Run() {
 	int i;
@@ -324,6 +326,13 @@ void Application::mp2Run() {
 		} // End of update test
 
 	} // end of if ( par->getcurrtime == TEST_TIME)
+
+	/**
+	 * Send the requests the nodes batched this tick
+	 */
+	for ( i = 0; i <= par->EN_GPSZ-1; i++ ) {
+		mp2[i]->flushMessages();
+	}
 }
 
 /**
@@ -0,0 +1,489 @@
+/**********************************
+ * FILE NAME: BPlusTree.cpp
+ *
+ * DESCRIPTION: BPlusTree class definition
+ **********************************/
+
+#include "BPlusTree.h"
+
+/**
+ * Constructor
+ */
+BPlusTree::BPlusTree(): keyCount(0) {
+	first = new Leaf();
+	first->leaf = true;
+	first->count = 0;
+	first->prev = NULL;
+	first->next = NULL;
+	root = first;
+}
+
+/**
+ * Destructor
+ */
+BPlusTree::~BPlusTree() {
+	freeNode(root);
+}
+
+/**
+ * FUNCTION NAME: prefixOf
+ *
+ * DESCRIPTION: First 8 bytes of the key, big endian and zero padded, so that
+ * 				integer order matches byte order
+ */
+uint64_t BPlusTree::prefixOf(string_view key) {
+	uint64_t prefix = 0;
+	size_t n = key.size() < 8 ? key.size() : 8;
+	for ( size_t i = 0; i < 8; i++ ) {
+		prefix <<= 8;
+		if ( i < n ) {
+			prefix |= (unsigned char) key[i];
+		}
+	}
+	return prefix;
+}
+
+/**
+ * FUNCTION NAME: compare
+ *
+ * DESCRIPTION: Three way comparison that only reads the key bytes when the
+ * 				inline prefixes tie
+ */
+int BPlusTree::compare(uint64_t prefixA, string_view a, uint64_t prefixB, string_view b) {
+	if ( prefixA != prefixB ) {
+		return prefixA < prefixB ? -1 : 1;
+	}
+	return a.compare(b);
+}
+
+/**
+ * FUNCTION NAME: lowerSlot
+ *
+ * DESCRIPTION: First slot of the node whose key is not less than key
+ */
+int BPlusTree::lowerSlot(const Node *node, uint64_t prefix, string_view key) {
+	int low = 0, high = node->count;
+	while ( low < high ) {
+		int mid = (low + high) / 2;
+		if ( compare(node->prefixes[mid], node->keys[mid], prefix, key) < 0 ) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+/**
+ * FUNCTION NAME: childSlot
+ *
+ * DESCRIPTION: Child of an inner node whose subtree holds key: the number of
+ * 				separators not greater than key
+ */
+int BPlusTree::childSlot(const Inner *inner, uint64_t prefix, string_view key) {
+	int low = 0, high = inner->count;
+	while ( low < high ) {
+		int mid = (low + high) / 2;
+		if ( compare(inner->prefixes[mid], inner->keys[mid], prefix, key) <= 0 ) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+string_view BPlusTree::minKey(const Node *node) {
+	while ( !node->leaf ) {
+		node = static_cast<const Inner *>(node)->children[0];
+	}
+	return node->keys[0];
+}
+
+void BPlusTree::setKey(Node *node, int slot, string_view key) {
+	node->keys[slot] = key;
+	node->prefixes[slot] = prefixOf(key);
+}
+
+/**
+ * FUNCTION NAME: moveKeys
+ *
+ * DESCRIPTION: Move count keys with their prefixes; the ranges may overlap
+ */
+void BPlusTree::moveKeys(Node *to, int toSlot, Node *from, int fromSlot, int count) {
+	if ( count <= 0 ) {
+		return;
+	}
+	memmove(&to->prefixes[toSlot], &from->prefixes[fromSlot], count * sizeof(uint64_t));
+	memmove((void *)&to->keys[toSlot], (const void *)&from->keys[fromSlot], count * sizeof(string_view));
+}
+
+/**
+ * FUNCTION NAME: insert
+ *
+ * DESCRIPTION: Add a key to the index
+ *
+ * RETURNS:
+ * true if the key was added
+ * false if it was already present
+ */
+bool BPlusTree::insert(string_view key) {
+	bool inserted = false;
+	string_view separator;
+	Node *right = insertInto(root, prefixOf(key), key, inserted, separator);
+	if ( right != NULL ) {
+		// the root split: grow the tree by one level
+		Inner *grown = new Inner();
+		grown->leaf = false;
+		grown->count = 1;
+		setKey(grown, 0, separator);
+		grown->children[0] = root;
+		grown->children[1] = right;
+		root = grown;
+	}
+	if ( inserted ) {
+		keyCount++;
+	}
+	return inserted;
+}
+
+/**
+ * FUNCTION NAME: insertInto
+ *
+ * DESCRIPTION: Insert below node
+ *
+ * RETURNS:
+ * the new right sibling if node split (separator is set to its smallest key), else NULL
+ */
+BPlusTree::Node *BPlusTree::insertInto(Node *node, uint64_t prefix, string_view key, bool &inserted, string_view &separator) {
+	if ( node->leaf ) {
+		Leaf *leaf = static_cast<Leaf *>(node);
+		int slot = lowerSlot(leaf, prefix, key);
+		if ( slot < leaf->count && compare(leaf->prefixes[slot], leaf->keys[slot], prefix, key) == 0 ) {
+			return NULL;
+		}
+		inserted = true;
+		if ( leaf->count < BPTREE_LEAF_SLOTS ) {
+			moveKeys(leaf, slot + 1, leaf, slot, leaf->count - slot);
+			setKey(leaf, slot, key);
+			leaf->count++;
+			return NULL;
+		}
+		// split, then insert into the half the key belongs to
+		int mid = BPTREE_LEAF_SLOTS / 2;
+		Leaf *right = new Leaf();
+		right->leaf = true;
+		right->count = leaf->count - mid;
+		moveKeys(right, 0, leaf, mid, right->count);
+		leaf->count = mid;
+		right->next = leaf->next;
+		if ( right->next != NULL ) {
+			right->next->prev = right;
+		}
+		right->prev = leaf;
+		leaf->next = right;
+		Leaf *target = slot <= mid ? leaf : right;
+		if ( target == right ) {
+			slot -= mid;
+		}
+		moveKeys(target, slot + 1, target, slot, target->count - slot);
+		setKey(target, slot, key);
+		target->count++;
+		separator = right->keys[0];
+		return right;
+	}
+
+	Inner *inner = static_cast<Inner *>(node);
+	int slot = childSlot(inner, prefix, key);
+	string_view childSeparator;
+	Node *child = insertInto(inner->children[slot], prefix, key, inserted, childSeparator);
+	if ( child == NULL ) {
+		return NULL;
+	}
+	if ( inner->count < BPTREE_INNER_SLOTS ) {
+		moveKeys(inner, slot + 1, inner, slot, inner->count - slot);
+		memmove(&inner->children[slot + 2], &inner->children[slot + 1], (inner->count - slot) * sizeof(Node *));
+		setKey(inner, slot, childSeparator);
+		inner->children[slot + 1] = child;
+		inner->count++;
+		return NULL;
+	}
+
+	// split a full inner node: lay out all keys and children, then cut at the middle key
+	string_view keys[BPTREE_INNER_SLOTS + 1];
+	Node *children[BPTREE_INNER_SLOTS + 2];
+	for ( int i = 0, k = 0; i <= BPTREE_INNER_SLOTS; i++ ) {
+		keys[i] = (i == slot) ? childSeparator : inner->keys[k++];
+	}
+	for ( int i = 0, c = 0; i <= BPTREE_INNER_SLOTS + 1; i++ ) {
+		children[i] = (i == slot + 1) ? child : inner->children[c++];
+	}
+	int mid = (BPTREE_INNER_SLOTS + 1) / 2;
+	Inner *right = new Inner();
+	right->leaf = false;
+	inner->count = mid;
+	for ( int i = 0; i < mid; i++ ) {
+		setKey(inner, i, keys[i]);
+		inner->children[i] = children[i];
+	}
+	inner->children[mid] = children[mid];
+	right->count = BPTREE_INNER_SLOTS - mid;
+	for ( int i = 0; i < right->count; i++ ) {
+		setKey(right, i, keys[mid + 1 + i]);
+		right->children[i] = children[mid + 1 + i];
+	}
+	right->children[right->count] = children[BPTREE_INNER_SLOTS + 1];
+	separator = keys[mid];
+	return right;
+}
+
+/**
+ * FUNCTION NAME: erase
+ *
+ * DESCRIPTION: Remove a key from the index
+ *
+ * RETURNS:
+ * true if the key was removed
+ * false if it was not present
+ */
+bool BPlusTree::erase(string_view key) {
+	if ( !eraseFrom(root, prefixOf(key), key) ) {
+		return false;
+	}
+	keyCount--;
+	if ( !root->leaf && root->count == 0 ) {
+		// the root lost its last separator: shrink the tree by one level
+		Inner *old = static_cast<Inner *>(root);
+		root = old->children[0];
+		delete old;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: eraseFrom
+ *
+ * DESCRIPTION: Erase below node, refreshing a separator equal to the erased
+ * 				key and rebalancing an underfull child on the way back up
+ */
+bool BPlusTree::eraseFrom(Node *node, uint64_t prefix, string_view key) {
+	if ( node->leaf ) {
+		int slot = lowerSlot(node, prefix, key);
+		if ( slot == node->count || compare(node->prefixes[slot], node->keys[slot], prefix, key) != 0 ) {
+			return false;
+		}
+		moveKeys(node, slot, node, slot + 1, node->count - slot - 1);
+		node->count--;
+		return true;
+	}
+
+	Inner *inner = static_cast<Inner *>(node);
+	int slot = childSlot(inner, prefix, key);
+	Node *child = inner->children[slot];
+	if ( !eraseFrom(child, prefix, key) ) {
+		return false;
+	}
+	if ( slot > 0 && child->count > 0
+			&& compare(inner->prefixes[slot - 1], inner->keys[slot - 1], prefix, key) == 0 ) {
+		setKey(inner, slot - 1, minKey(child));
+	}
+	int minimum = child->leaf ? BPTREE_LEAF_SLOTS / 2 : BPTREE_INNER_SLOTS / 2;
+	if ( child->count < minimum ) {
+		rebalance(inner, slot);
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: rebalance
+ *
+ * DESCRIPTION: Fix the underfull child at slot of parent by merging it with a
+ * 				sibling, or by borrowing one key from the sibling if both do
+ * 				not fit into one node
+ */
+void BPlusTree::rebalance(Inner *parent, int slot) {
+	if ( parent->count == 0 ) {
+		return;
+	}
+	// separator s sits between the siblings left and right
+	int s = slot > 0 ? slot - 1 : 0;
+	Node *left = parent->children[s];
+	Node *right = parent->children[s + 1];
+	bool rightIsShort = (slot == s + 1);
+
+	if ( left->leaf ) {
+		Leaf *l = static_cast<Leaf *>(left);
+		Leaf *r = static_cast<Leaf *>(right);
+		if ( l->count + r->count <= BPTREE_LEAF_SLOTS ) {
+			moveKeys(l, l->count, r, 0, r->count);
+			l->count += r->count;
+			l->next = r->next;
+			if ( l->next != NULL ) {
+				l->next->prev = l;
+			}
+			delete r;
+		}
+		else {
+			if ( rightIsShort ) {
+				moveKeys(r, 1, r, 0, r->count);
+				moveKeys(r, 0, l, l->count - 1, 1);
+				l->count--;
+				r->count++;
+			}
+			else {
+				moveKeys(l, l->count, r, 0, 1);
+				l->count++;
+				moveKeys(r, 0, r, 1, r->count - 1);
+				r->count--;
+			}
+			setKey(parent, s, r->keys[0]);
+			return;
+		}
+	}
+	else {
+		Inner *l = static_cast<Inner *>(left);
+		Inner *r = static_cast<Inner *>(right);
+		if ( l->count + 1 + r->count <= BPTREE_INNER_SLOTS ) {
+			// pull the separator down between the two halves
+			moveKeys(l, l->count, parent, s, 1);
+			moveKeys(l, l->count + 1, r, 0, r->count);
+			memcpy(&l->children[l->count + 1], &r->children[0], (r->count + 1) * sizeof(Node *));
+			l->count += 1 + r->count;
+			delete r;
+		}
+		else {
+			if ( rightIsShort ) {
+				// rotate the last child of left through the separator
+				moveKeys(r, 1, r, 0, r->count);
+				memmove(&r->children[1], &r->children[0], (r->count + 1) * sizeof(Node *));
+				moveKeys(r, 0, parent, s, 1);
+				r->children[0] = l->children[l->count];
+				moveKeys(parent, s, l, l->count - 1, 1);
+				l->count--;
+				r->count++;
+			}
+			else {
+				// rotate the first child of right through the separator
+				moveKeys(l, l->count, parent, s, 1);
+				l->children[l->count + 1] = r->children[0];
+				l->count++;
+				moveKeys(parent, s, r, 0, 1);
+				moveKeys(r, 0, r, 1, r->count - 1);
+				memmove(&r->children[0], &r->children[1], r->count * sizeof(Node *));
+				r->count--;
+			}
+			return;
+		}
+	}
+
+	// right was merged into left: drop separator s and child s + 1
+	moveKeys(parent, s, parent, s + 1, parent->count - s - 1);
+	memmove(&parent->children[s + 1], &parent->children[s + 2], (parent->count - s - 1) * sizeof(Node *));
+	parent->count--;
+}
+
+/**
+ * FUNCTION NAME: contains
+ *
+ * DESCRIPTION: Returns true if the key is in the index
+ */
+bool BPlusTree::contains(string_view key) const {
+	Cursor cursor = lowerBound(key);
+	return cursor.valid() && cursor.key() == key;
+}
+
+/**
+ * FUNCTION NAME: lowerBound
+ *
+ * DESCRIPTION: Cursor at the first key not less than key
+ */
+BPlusTree::Cursor BPlusTree::lowerBound(string_view key) const {
+	uint64_t prefix = prefixOf(key);
+	const Node *node = root;
+	while ( !node->leaf ) {
+		const Inner *inner = static_cast<const Inner *>(node);
+		node = inner->children[childSlot(inner, prefix, key)];
+	}
+	const Leaf *leaf = static_cast<const Leaf *>(node);
+	int slot = lowerSlot(leaf, prefix, key);
+	if ( slot == leaf->count ) {
+		return Cursor(leaf->next, 0);
+	}
+	return Cursor(leaf, slot);
+}
+
+/**
+ * FUNCTION NAME: begin
+ *
+ * DESCRIPTION: Cursor at the smallest key
+ */
+BPlusTree::Cursor BPlusTree::begin() const {
+	return Cursor(first->count > 0 ? first : NULL, 0);
+}
+
+size_t BPlusTree::size() const {
+	return keyCount;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Remove every key
+ */
+void BPlusTree::clear() {
+	freeNode(root);
+	first = new Leaf();
+	first->leaf = true;
+	first->count = 0;
+	first->prev = NULL;
+	first->next = NULL;
+	root = first;
+	keyCount = 0;
+}
+
+/**
+ * FUNCTION NAME: swap
+ *
+ * DESCRIPTION: Exchange the contents of two trees
+ */
+void BPlusTree::swap(BPlusTree &anotherTree) {
+	std::swap(root, anotherTree.root);
+	std::swap(first, anotherTree.first);
+	std::swap(keyCount, anotherTree.keyCount);
+}
+
+/**
+ * FUNCTION NAME: freeNode
+ *
+ * DESCRIPTION: Free a subtree
+ */
+void BPlusTree::freeNode(Node *node) {
+	if ( node->leaf ) {
+		delete static_cast<Leaf *>(node);
+		return;
+	}
+	Inner *inner = static_cast<Inner *>(node);
+	for ( int i = 0; i <= inner->count; i++ ) {
+		freeNode(inner->children[i]);
+	}
+	delete inner;
+}
+
+/**
+ * Cursor constructor
+ */
+BPlusTree::Cursor::Cursor(const Leaf *leaf, int index): leaf(leaf), index(index) {}
+
+/**
+ * FUNCTION NAME: next
+ *
+ * DESCRIPTION: Step to the next key in order
+ */
+void BPlusTree::Cursor::next() {
+	if ( ++index >= leaf->count ) {
+		leaf = leaf->next;
+		index = 0;
+	}
+}
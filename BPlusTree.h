@@ -0,0 +1,104 @@
+/**********************************
+ * FILE NAME: BPlusTree.h
+ *
+ * DESCRIPTION: Header file of the BPlusTree class
+ **********************************/
+
+#ifndef BPLUSTREE_H_
+#define BPLUSTREE_H_
+
+#include "stdincludes.h"
+#include <stdint.h>
+
+/*
+ * Macros
+ */
+// keys per leaf and per inner node
+#define BPTREE_LEAF_SLOTS 32
+#define BPTREE_INNER_SLOTS 32
+
+/**
+ * CLASS NAME: BPlusTree
+ *
+ * DESCRIPTION: Ordered set of keys used as the range index of HashTable.
+ * 				The tree stores views of key bytes it does not own; a key's
+ * 				bytes must stay valid until it is erased.
+ *
+ * 				Nodes are wide and keep the first 8 key bytes inline as an
+ * 				integer next to each view, so most comparisons on the way down
+ * 				never touch the key bytes. Leaves are linked in key order for
+ * 				O(log n + k) range walks.
+ * 				Every separator in an inner node is the smallest key of the
+ * 				subtree to its right, so separators always refer to live keys.
+ */
+class BPlusTree {
+private:
+	struct Node {
+		bool leaf;
+		int count;
+		uint64_t prefixes[BPTREE_INNER_SLOTS > BPTREE_LEAF_SLOTS ? BPTREE_INNER_SLOTS : BPTREE_LEAF_SLOTS];
+		string_view keys[BPTREE_INNER_SLOTS > BPTREE_LEAF_SLOTS ? BPTREE_INNER_SLOTS : BPTREE_LEAF_SLOTS];
+	};
+	struct Leaf : Node {
+		Leaf *prev;
+		Leaf *next;
+	};
+	struct Inner : Node {
+		Node *children[BPTREE_INNER_SLOTS + 1];
+	};
+public:
+	/**
+	 * CLASS NAME: Cursor
+	 *
+	 * DESCRIPTION: Position in the leaf chain. Any insert or erase invalidates it.
+	 */
+	class Cursor {
+	public:
+		Cursor(): leaf(NULL), index(0) {}
+		bool valid() const {
+			return leaf != NULL;
+		}
+		string_view key() const {
+			return leaf->keys[index];
+		}
+		void next();
+	private:
+		friend class BPlusTree;
+		const Leaf *leaf;
+		int index;
+		Cursor(const Leaf *leaf, int index);
+	};
+
+	BPlusTree();
+	virtual ~BPlusTree();
+	// returns false if the key was already present
+	bool insert(string_view key);
+	// returns false if the key was not present
+	bool erase(string_view key);
+	bool contains(string_view key) const;
+	// first key not less than key
+	Cursor lowerBound(string_view key) const;
+	Cursor begin() const;
+	size_t size() const;
+	void clear();
+	void swap(BPlusTree &anotherTree);
+private:
+	Node *root;
+	Leaf *first;
+	size_t keyCount;
+	BPlusTree(const BPlusTree &anotherTree);
+	BPlusTree& operator =(const BPlusTree &anotherTree);
+	static uint64_t prefixOf(string_view key);
+	static int compare(uint64_t prefixA, string_view a, uint64_t prefixB, string_view b);
+	static int lowerSlot(const Node *node, uint64_t prefix, string_view key);
+	static int childSlot(const Inner *inner, uint64_t prefix, string_view key);
+	static string_view minKey(const Node *node);
+	static void setKey(Node *node, int slot, string_view key);
+	static void moveKeys(Node *to, int toSlot, Node *from, int fromSlot, int count);
+	Node *insertInto(Node *node, uint64_t prefix, string_view key, bool &inserted, string_view &separator);
+	bool eraseFrom(Node *node, uint64_t prefix, string_view key);
+	void rebalance(Inner *parent, int slot);
+	void freeNode(Node *node);
+};
+
+#endif /* BPLUSTREE_H_ */
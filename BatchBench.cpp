@@ -0,0 +1,125 @@
+/**********************************
+ * FILE NAME: BatchBench.cpp
+ *
+ * DESCRIPTION: Lookup throughput of HashTable::multiGet by batch size, against
+ * 				one find per key. Keys are looked up in random order over a
+ * 				table much larger than the cache, so every lookup misses.
+ * 				HashTable runs on the backend picked by HASHTABLE at build time;
+ * 				only the flat backend prefetches.
+ *
+ * RUN PROCEDURE:
+ * $ make bench
+ * $ ./BatchBench [numKeys [numLookups]]     e.g. ./BatchBench 4000000 4000000
+ **********************************/
+
+#include "stdincludes.h"
+#include "HashTable.h"
+#include <chrono>
+
+/*
+ * Macros
+ */
+#define DEFAULT_KEYS 4000000
+#define DEFAULT_LOOKUPS 4000000
+#define BENCH_KEY_LENGTH 6
+
+static const char alphanum[] =
+"0123456789"
+"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+"abcdefghijklmnopqrstuvwxyz";
+
+// keys per multiGet
+static const size_t batchSizes[] = {1, 8, 32, 128};
+
+/**
+ * FUNCTION NAME: makeKey
+ *
+ * DESCRIPTION: Deterministic, unique key for index i
+ */
+static void makeKey(uint64_t i, string &key) {
+	uint32_t x = (uint32_t)(i * 2654435761ULL);
+	key.assign(BENCH_KEY_LENGTH, '0');
+	for ( int c = 0; c < BENCH_KEY_LENGTH; c++ ) {
+		key[c] = alphanum[x % 62];
+		x /= 62;
+	}
+}
+
+static double elapsedNs(chrono::steady_clock::time_point start) {
+	return (double)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * FUNCTION NAME: runFind
+ *
+ * DESCRIPTION: Look every key up with find; returns lookups per second
+ */
+static double runFind(HashTable &table, const vector<string_view> &keys, uint64_t &found) {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for ( size_t i = 0; i < keys.size(); i++ ) {
+		found += table.find(keys[i]) != NULL;
+	}
+	return keys.size() * 1e9 / elapsedNs(start);
+}
+
+/**
+ * FUNCTION NAME: runMultiGet
+ *
+ * DESCRIPTION: Look every key up with multiGet, batch keys at a time;
+ * 				returns lookups per second
+ */
+static double runMultiGet(HashTable &table, const vector<string_view> &keys, size_t batch, uint64_t &found) {
+	vector<string_view> batchKeys;
+	vector<const Entry *> entries;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for ( size_t first = 0; first + batch <= keys.size(); first += batch ) {
+		batchKeys.assign(keys.begin() + first, keys.begin() + first + batch);
+		found += table.multiGet(batchKeys, entries);
+	}
+	return (keys.size() / batch * batch) * 1e9 / elapsedNs(start);
+}
+
+/**
+ * Main function
+ */
+int main(int argc, char *argv[]) {
+	uint64_t numKeys = DEFAULT_KEYS;
+	uint64_t numLookups = DEFAULT_LOOKUPS;
+	if ( argc > 1 ) {
+		numKeys = strtoull(argv[1], NULL, 10);
+	}
+	if ( argc > 2 ) {
+		numLookups = strtoull(argv[2], NULL, 10);
+	}
+
+	HashTable table;
+	string key;
+	for ( uint64_t i = 0; i < numKeys; i++ ) {
+		makeKey(i, key);
+		table.insertOrAssign(key, "value" + to_string(i % 100));
+	}
+	// the lookup keys are made up front so that the timed loops only look up
+	vector<string> lookupKeys(numLookups);
+	vector<string_view> keys(numLookups);
+	uint64_t r = 88172645463325252ULL;
+	for ( uint64_t i = 0; i < numLookups; i++ ) {
+		r ^= r << 13; r ^= r >> 7; r ^= r << 17;
+		makeKey(r % numKeys, lookupKeys[i]);
+		keys[i] = lookupKeys[i];
+	}
+
+	uint64_t found = 0;
+	printf("%llu keys, %llu random lookups\n", (unsigned long long)numKeys, (unsigned long long)numLookups);
+	printf("%8s %14s %12s\n", "batch", "lookups/s", "ns/lookup");
+	double single = runFind(table, keys, found);
+	printf("%8s %14.0f %12.1f\n", "find", single, 1e9 / single);
+	for ( size_t b = 0; b < sizeof(batchSizes) / sizeof(batchSizes[0]); b++ ) {
+		double lookups = runMultiGet(table, keys, batchSizes[b], found);
+		printf("%8zu %14.0f %12.1f   x%.2f\n", batchSizes[b], lookups, 1e9 / lookups, lookups / single);
+	}
+	// keeps the lookups from being optimized out
+	if ( found == 0 ) {
+		printf("no key found\n");
+	}
+	return SUCCESS;
+}
@@ -0,0 +1,109 @@
+/**********************************
+ * FILE NAME: BloomFilter.cpp
+ *
+ * DESCRIPTION: BloomFilter class definition
+ **********************************/
+
+#include "BloomFilter.h"
+
+/**
+ * Constructor: a filter that matches every key (used until load)
+ */
+BloomFilter::BloomFilter() {}
+
+/**
+ * Constructor
+ */
+BloomFilter::BloomFilter(size_t keys) {
+	size_t bytes = (keys * BLOOM_BITS_PER_KEY + 7) / 8;
+	if ( bytes < 8 ) {
+		bytes = 8;
+	}
+	// k = bits per key * ln 2 minimises the false positive rate
+	int probes = (int)(BLOOM_BITS_PER_KEY * 0.69);
+	bits.assign(bytes + 1, '\0');
+	bits[0] = (char) probes;
+}
+
+size_t BloomFilter::bitCount() const {
+	return (bits.size() - 1) * 8;
+}
+
+/**
+ * FUNCTION NAME: hash
+ *
+ * DESCRIPTION: 64-bit FNV-1a with a final avalanche step
+ */
+uint64_t BloomFilter::hash(string_view key) {
+	uint64_t h = 14695981039346656037ULL;
+	for ( size_t i = 0; i < key.size(); i++ ) {
+		h ^= (unsigned char) key[i];
+		h *= 1099511628211ULL;
+	}
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Set the k bits of key
+ */
+void BloomFilter::add(string_view key) {
+	uint64_t h = hash(key);
+	uint64_t delta = (h >> 32) | (h << 32);
+	size_t n = bitCount();
+	int probes = (unsigned char) bits[0];
+	for ( int i = 0; i < probes; i++ ) {
+		size_t bit = (size_t)(h % n);
+		bits[1 + bit / 8] |= (char)(1 << (bit % 8));
+		h += delta;
+	}
+}
+
+/**
+ * FUNCTION NAME: mayContain
+ *
+ * RETURNS:
+ * false if the key was certainly never added
+ * true otherwise
+ */
+bool BloomFilter::mayContain(string_view key) const {
+	if ( bits.size() <= 1 ) {
+		return true;
+	}
+	uint64_t h = hash(key);
+	uint64_t delta = (h >> 32) | (h << 32);
+	size_t n = bitCount();
+	int probes = (unsigned char) bits[0];
+	for ( int i = 0; i < probes; i++ ) {
+		size_t bit = (size_t)(h % n);
+		if ( (bits[1 + bit / 8] & (1 << (bit % 8))) == 0 ) {
+			return false;
+		}
+		h += delta;
+	}
+	return true;
+}
+
+string_view BloomFilter::bytes() const {
+	return bits;
+}
+
+/**
+ * FUNCTION NAME: load
+ *
+ * DESCRIPTION: Restore a filter from the output of bytes()
+ *
+ * RETURNS:
+ * false if the bytes are not a filter
+ */
+bool BloomFilter::load(string_view bytes) {
+	if ( bytes.size() < 2 || bytes[0] == 0 ) {
+		return false;
+	}
+	bits.assign(bytes);
+	return true;
+}
@@ -0,0 +1,46 @@
+/**********************************
+ * FILE NAME: BloomFilter.h
+ *
+ * DESCRIPTION: Header file of the BloomFilter class
+ **********************************/
+
+#ifndef BLOOMFILTER_H_
+#define BLOOMFILTER_H_
+
+#include "stdincludes.h"
+#include <stdint.h>
+
+/*
+ * Macros
+ */
+// about 1% false positives at 10 bits per key
+#define BLOOM_BITS_PER_KEY 10
+
+/**
+ * CLASS NAME: BloomFilter
+ *
+ * DESCRIPTION: Set membership filter with no false negatives, kept next to
+ * 				each sorted run so that a lookup of a key the run does not hold
+ * 				usually costs no disk read.
+ * 				The k probe positions are derived from one 64-bit hash by
+ * 				double hashing. The hash is fixed (not std::hash) because the
+ * 				bits are stored on disk and read back by later processes.
+ */
+class BloomFilter {
+public:
+	BloomFilter();
+	// empty filter sized for about keys keys
+	explicit BloomFilter(size_t keys);
+	void add(string_view key);
+	bool mayContain(string_view key) const;
+	// raw form: the probe count byte followed by the bit array
+	string_view bytes() const;
+	bool load(string_view bytes);
+	static uint64_t hash(string_view key);
+private:
+	// bits[0] is the probe count, the bit array follows
+	string bits;
+	size_t bitCount() const;
+};
+
+#endif /* BLOOMFILTER_H_ */
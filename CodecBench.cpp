@@ -0,0 +1,87 @@
+/**********************************
+ * FILE NAME: CodecBench.cpp
+ *
+ * DESCRIPTION: Encode and decode throughput of the Mp2Message codec, per
+ * 				message type. Every type is encoded into a reused buffer and
+ * 				decoded back in place, with a short key and a value of
+ * 				valueBytes for the types that carry them; the bytes per
+ * 				message and the average cost of each side are reported.
+ *
+ * RUN PROCEDURE:
+ * $ make bench
+ * $ ./CodecBench [numMessages [valueBytes]]     e.g. ./CodecBench 10000000 100
+ **********************************/
+
+#include "stdincludes.h"
+#include "Message.h"
+#include <chrono>
+
+/*
+ * Macros
+ */
+#define DEFAULT_MESSAGES 10000000
+#define DEFAULT_VALUE_BYTES 100
+
+static const char *typeNames[] = {"CREATE", "READ", "UPDATE", "DELETE", "REPLY", "READREPLY"};
+
+/**
+ * Main function
+ */
+int main(int argc, char *argv[]) {
+	uint64_t numMessages = DEFAULT_MESSAGES;
+	size_t valueBytes = DEFAULT_VALUE_BYTES;
+	if ( argc > 1 ) {
+		numMessages = strtoull(argv[1], NULL, 10);
+	}
+	if ( argc > 2 ) {
+		valueBytes = strtoull(argv[2], NULL, 10);
+	}
+
+	string key = "k7Qx2";
+	string value(valueBytes, 'v');
+	Address from("1:0");
+	string buffer;
+	// summed over the decoded messages so the loops are not optimized away
+	uint64_t checksum = 0;
+
+	printf("%-10s %8s %14s %14s\n", "type", "bytes", "encode ns/msg", "decode ns/msg");
+	for ( int type = CREATE; type <= READREPLY; type++ ) {
+		Mp2MessageView msg;
+		msg.type = (MessageType) type;
+		msg.fromMessageType = UPDATE;
+		msg.replica = SECONDARY;
+		msg.success = true;
+		msg.fromAddr = from;
+		msg.version = ((uint64_t) 1200 << 32) | 4711;
+		msg.expiresAt = 1300;
+		msg.key = key;
+		msg.value = value;
+
+		auto start = chrono::steady_clock::now();
+		for ( uint64_t i = 0; i < numMessages; i++ ) {
+			msg.transID = (int) i;
+			msg.encode(buffer);
+			checksum += buffer.size();
+		}
+		double encodeNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / numMessages;
+
+		Mp2MessageView decoded;
+		start = chrono::steady_clock::now();
+		for ( uint64_t i = 0; i < numMessages; i++ ) {
+			if ( !decoded.decode(buffer.data(), buffer.size()) ) {
+				printf("%s does not decode\n", typeNames[type]);
+				return 1;
+			}
+			checksum += decoded.transID + decoded.value.size();
+		}
+		double decodeNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / numMessages;
+
+		if ( decoded.type != msg.type || decoded.transID != msg.transID || buffer.size() != msg.encodedSize() ) {
+			printf("%s does not round trip\n", typeNames[type]);
+			return 1;
+		}
+		printf("%-10s %8zu %14.1f %14.1f\n", typeNames[type], buffer.size(), encodeNs, decodeNs);
+	}
+	printf("checksum %llu\n", (unsigned long long) checksum);
+	return 0;
+}
@@ -0,0 +1,257 @@
+/**********************************
+ * FILE NAME: ColdStore.cpp
+ *
+ * DESCRIPTION: ColdStore class definition
+ **********************************/
+
+#include "ColdStore.h"
+
+/*
+ * Fixed width fields of a record, in host byte order: the file never
+ * outlives the process that wrote it
+ */
+static void putU32(string &out, uint32_t value) {
+	out.append((const char *) &value, sizeof(value));
+}
+
+static void putU64(string &out, uint64_t value) {
+	out.append((const char *) &value, sizeof(value));
+}
+
+static uint32_t getU32(const char *in) {
+	uint32_t value;
+	memcpy(&value, in, sizeof(value));
+	return value;
+}
+
+static uint64_t getU64(const char *in) {
+	uint64_t value;
+	memcpy(&value, in, sizeof(value));
+	return value;
+}
+
+/**
+ * Constructor
+ */
+ColdStore::ColdStore() {}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Create the file of the cold records in directory
+ */
+bool ColdStore::open(const string &directory) {
+	this->directory = directory;
+	return file.open(directory);
+}
+
+/**
+ * FUNCTION NAME: hash
+ *
+ * DESCRIPTION: std::hash with a final avalanche step; the index keeps only
+ * 				this hash of a key, so its low bits must be well mixed
+ */
+uint64_t ColdStore::hash(string_view key) {
+	uint64_t h = std::hash<string_view>()(key);
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/**
+ * FUNCTION NAME: put
+ *
+ * DESCRIPTION: Append the record of key to the file buffer and index it.
+ * 				The record cannot be read before the next flush.
+ *
+ * RETURNS:
+ * false if another cold key has the same hash or the record does not fit
+ * the index, in which case nothing is written
+ */
+bool ColdStore::put(string_view key, const Entry &entry) {
+	uint64_t h = hash(key);
+	size_t size = COLD_RECORD_HEADER + key.size() + entry.value().size();
+	uint64_t offset = file.liveBytes() + file.deadBytes();
+	if ( size > COLD_MAX_RECORD || offset > COLD_MAX_OFFSET || index.count(h) > 0 ) {
+		return false;
+	}
+	string record;
+	record.reserve(size);
+	putU32(record, (uint32_t) key.size());
+	putU32(record, (uint32_t) entry.value().size());
+	putU64(record, entry.getVersion());
+	record.push_back((char) entry.getReplica());
+	putU32(record, entry.getExpiresAt());
+	record.append(key.data(), key.size());
+	record.append(entry.value().data(), entry.value().size());
+	offset = file.append(record);
+	index.emplace(h, offset << COLD_SIZE_BITS | size);
+	unflushed.push_back(h);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: flush
+ *
+ * DESCRIPTION: Write the records put since the last flush
+ *
+ * RETURNS:
+ * false on an I/O error, in which case those records are dropped from the
+ * index and their keys must be kept hot
+ */
+bool ColdStore::flush() {
+	if ( file.flush() ) {
+		unflushed.clear();
+		return true;
+	}
+	for ( size_t i = 0; i < unflushed.size(); i++ ) {
+		index.erase(unflushed[i]);
+	}
+	unflushed.clear();
+	return false;
+}
+
+/**
+ * FUNCTION NAME: read
+ *
+ * DESCRIPTION: Read the record at location into buffer with one pread and
+ * 				decode it; key and the entry's value are views of buffer
+ */
+bool ColdStore::read(uint64_t location, string_view &key, Entry &entry, string &buffer) const {
+	size_t size = location & COLD_MAX_RECORD;
+	if ( !file.read(location >> COLD_SIZE_BITS, size, buffer) || size < COLD_RECORD_HEADER ) {
+		return false;
+	}
+	const char *header = buffer.data();
+	size_t keySize = getU32(header);
+	size_t valueSize = getU32(header + 4);
+	if ( COLD_RECORD_HEADER + keySize + valueSize != size ) {
+		return false;
+	}
+	key = string_view(header + COLD_RECORD_HEADER, keySize);
+	entry = Entry(string_view(header + COLD_RECORD_HEADER + keySize, valueSize), getU64(header + 8),
+			(ReplicaType) header[16], getU32(header + 17));
+	return true;
+}
+
+/**
+ * FUNCTION NAME: get
+ *
+ * DESCRIPTION: Look the key up: one probe of the index, then one read of
+ * 				the record, whose key must match (another key of the same
+ * 				hash is never cold)
+ */
+bool ColdStore::get(string_view key, Entry &entry, string &buffer) const {
+	FlatHashMap<uint64_t, uint64_t>::const_iterator search = index.find(hash(key));
+	if ( search == index.end() ) {
+		return false;
+	}
+	string_view stored;
+	return read(search->second, stored, entry, buffer) && stored == key;
+}
+
+void ColdStore::remove(string_view key) {
+	FlatHashMap<uint64_t, uint64_t>::iterator search = index.find(hash(key));
+	if ( search != index.end() ) {
+		file.release(search->second & COLD_MAX_RECORD);
+		index.erase(search);
+	}
+}
+
+/**
+ * FUNCTION NAME: takeAny
+ *
+ * DESCRIPTION: Read and remove the record of the first indexed key. A record
+ * 				that cannot be read is dropped.
+ *
+ * RETURNS:
+ * false once the store is empty
+ */
+bool ColdStore::takeAny(string &key, Entry &entry, string &buffer) {
+	while ( !index.empty() ) {
+		FlatHashMap<uint64_t, uint64_t>::iterator first = index.begin();
+		string_view stored;
+		bool readable = read(first->second, stored, entry, buffer);
+		file.release(first->second & COLD_MAX_RECORD);
+		index.erase(first);
+		if ( readable ) {
+			key.assign(stored);
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: collectKeys
+ *
+ * DESCRIPTION: Append the key of every indexed record to keys, one pread per
+ * 				record. The records stay in the store. A record that cannot
+ * 				be read is skipped.
+ */
+void ColdStore::collectKeys(vector<string> &keys) const {
+	string buffer;
+	string_view key;
+	Entry entry;
+	for ( FlatHashMap<uint64_t, uint64_t>::const_iterator it = index.begin(); it != index.end(); ++it ) {
+		if ( read(it->second, key, entry, buffer) ) {
+			keys.emplace_back(key);
+		}
+	}
+}
+
+size_t ColdStore::size() const {
+	return index.size();
+}
+
+bool ColdStore::shouldCompact() const {
+	return file.shouldCompact();
+}
+
+/**
+ * FUNCTION NAME: compact
+ *
+ * DESCRIPTION: Copy the indexed records into a fresh file, leaving the dead
+ * 				bytes behind. On an I/O error the old file is kept.
+ */
+bool ColdStore::compact() {
+	SpillFile fresh;
+	if ( !flush() || !fresh.open(directory) ) {
+		return false;
+	}
+	vector<pair<uint64_t *, uint64_t> > moves;
+	string record;
+	for ( FlatHashMap<uint64_t, uint64_t>::iterator it = index.begin(); it != index.end(); ++it ) {
+		size_t size = it->second & COLD_MAX_RECORD;
+		if ( !file.read(it->second >> COLD_SIZE_BITS, size, record) ) {
+			return false;
+		}
+		moves.emplace_back(&it->second, fresh.append(record) << COLD_SIZE_BITS | size);
+		if ( fresh.pendingBytes() >= SPILL_FLUSH_BYTES && !fresh.flush() ) {
+			return false;
+		}
+	}
+	if ( !fresh.flush() ) {
+		return false;
+	}
+	for ( size_t i = 0; i < moves.size(); i++ ) {
+		*moves[i].first = moves[i].second;
+	}
+	file.swap(fresh);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Forget every record, starting a fresh file
+ */
+void ColdStore::clear() {
+	index.clear();
+	unflushed.clear();
+	SpillFile fresh;
+	if ( fresh.open(directory) ) {
+		file.swap(fresh);
+	}
+}
@@ -0,0 +1,76 @@
+/**********************************
+ * FILE NAME: ColdStore.h
+ *
+ * DESCRIPTION: Header file of the ColdStore class
+ **********************************/
+
+#ifndef COLDSTORE_H_
+#define COLDSTORE_H_
+
+#include "stdincludes.h"
+#include "Entry.h"
+#include "SpillFile.h"
+#include "FlatHashMap.h"
+#include <stdint.h>
+
+/*
+ * Macros
+ */
+// key and value sizes, version, replica type and expiry tick
+#define COLD_RECORD_HEADER 21
+// a record's offset and size share one word of the index
+#define COLD_SIZE_BITS 24
+#define COLD_MAX_RECORD ((1UL << COLD_SIZE_BITS) - 1)
+#define COLD_MAX_OFFSET ((1ULL << (64 - COLD_SIZE_BITS)) - 1)
+// keys the demotion hand visits per tick
+#define COLD_SWEEP_KEYS 256
+
+/**
+ * CLASS NAME: ColdStore
+ *
+ * DESCRIPTION: Cold tier of an in-memory table: whole records (key, entry
+ * 				metadata and value) appended to a SpillFile, so a cold key
+ * 				costs no arena bytes and no slot in the table. The only memory
+ * 				per key is one 16-byte slot of an index from the 64-bit hash of
+ * 				the key to the offset and size of its record; the key itself is
+ * 				kept in the record and checked on read. Reading a cold key is
+ * 				one probe of the index and one pread. A key whose hash is
+ * 				already indexed is refused and stays hot.
+ * 				Records are buffered until flush, and a removed record leaves
+ * 				dead bytes until compact rewrites the file.
+ */
+class ColdStore {
+public:
+	ColdStore();
+	bool open(const string &directory);
+	// buffer the record of key; false if it cannot be indexed
+	bool put(string_view key, const Entry &entry);
+	// write the buffered records out; on failure they are forgotten
+	bool flush();
+	// the entry of a cold key, its value a view of buffer
+	bool get(string_view key, Entry &entry, string &buffer) const;
+	// forget the record of a key get just found
+	void remove(string_view key);
+	// take the record of any cold key out of the store
+	bool takeAny(string &key, Entry &entry, string &buffer);
+	// append the key of every record, reading the records in place
+	void collectKeys(vector<string> &keys) const;
+	size_t size() const;
+	bool shouldCompact() const;
+	// copy the records still indexed into a fresh file
+	bool compact();
+	void clear();
+private:
+	SpillFile file;
+	string directory;
+	// key hash to offset << COLD_SIZE_BITS | size
+	FlatHashMap<uint64_t, uint64_t> index;
+	// hashes indexed since the last flush
+	vector<uint64_t> unflushed;
+	static uint64_t hash(string_view key);
+	bool read(uint64_t location, string_view &key, Entry &entry, string &buffer) const;
+	ColdStore(const ColdStore &anotherStore);
+	ColdStore& operator =(const ColdStore &anotherStore);
+};
+
+#endif /* COLDSTORE_H_ */
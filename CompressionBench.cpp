@@ -0,0 +1,103 @@
+/**********************************
+ * FILE NAME: CompressionBench.cpp
+ *
+ * DESCRIPTION: Compression ratio and per-value cost of ValueDictionary on
+ * 				small, repetitive values like the ones nodes store: short
+ * 				records built from a few field names and a small vocabulary.
+ * 				The dictionary is trained on DICT_SAMPLE_BYTES of the values,
+ * 				then every value is compressed and decompressed, and the
+ * 				average cost of each is reported in nanoseconds.
+ *
+ * RUN PROCEDURE:
+ * $ make bench
+ * $ ./CompressionBench [numValues]     e.g. ./CompressionBench 1000000
+ **********************************/
+
+#include "stdincludes.h"
+#include "ValueDictionary.h"
+#include <chrono>
+
+/*
+ * Macros
+ */
+#define DEFAULT_VALUES 1000000
+
+static const char *fields[] = {"user", "region", "status", "plan", "updated"};
+static const char *words[] = {"active", "inactive", "us-east", "us-west", "eu-central", "free", "premium",
+		"enterprise", "pending", "2024-01-01"};
+
+/**
+ * FUNCTION NAME: makeValue
+ *
+ * DESCRIPTION: Deterministic record for index i
+ */
+static void makeValue(uint64_t i, string &value) {
+	uint64_t x = i * 0x9E3779B97F4A7C15ULL;
+	value = "{";
+	for ( int f = 0; f < 5; f++ ) {
+		value += "\"";
+		value += fields[f];
+		value += "\":\"";
+		value += f == 0 ? to_string(i) : string(words[x % 10]);
+		value += f < 4 ? "\"," : "\"}";
+		x /= 10;
+	}
+}
+
+/**
+ * Main function
+ */
+int main(int argc, char *argv[]) {
+	uint64_t numValues = DEFAULT_VALUES;
+	if ( argc > 1 ) {
+		numValues = strtoull(argv[1], NULL, 10);
+	}
+
+	vector<string> values(numValues);
+	for ( uint64_t i = 0; i < numValues; i++ ) {
+		makeValue(i, values[i]);
+	}
+
+	ValueDictionary dictionary;
+	vector<string_view> sample(values.begin(), values.begin() + min(numValues, (uint64_t) 1000));
+	auto start = chrono::steady_clock::now();
+	dictionary.train(sample);
+	double trainMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+	vector<string> encoded(numValues);
+	uint64_t kept = 0;
+	start = chrono::steady_clock::now();
+	for ( uint64_t i = 0; i < numValues; i++ ) {
+		kept += dictionary.compress(values[i], encoded[i]);
+	}
+	double compressNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / numValues;
+
+	if ( kept < numValues ) {
+		printf("%llu values did not compress\n", (unsigned long long) (numValues - kept));
+		return 1;
+	}
+
+	string decoded;
+	uint64_t raw = 0;
+	uint64_t packed = 0;
+	start = chrono::steady_clock::now();
+	for ( uint64_t i = 0; i < numValues; i++ ) {
+		dictionary.decompress(encoded[i], decoded);
+		raw += decoded.size();
+		packed += encoded[i].size();
+	}
+	double decompressNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / numValues;
+
+	for ( uint64_t i = 0; i < numValues; i++ ) {
+		dictionary.decompress(encoded[i], decoded);
+		if ( decoded != values[i] ) {
+			printf("value %llu does not round trip\n", (unsigned long long) i);
+			return 1;
+		}
+	}
+	printf("%llu values, %zu symbols trained in %.1f ms\n", (unsigned long long) numValues, dictionary.symbols(), trainMs);
+	printf("%llu bytes compressed to %llu (ratio %.2f)\n", (unsigned long long) raw, (unsigned long long) packed,
+			packed > 0 ? (double) raw / packed : 0.0);
+	printf("compress %.0f ns/value, decompress %.0f ns/value\n", compressNs, decompressNs);
+	return 0;
+}
@@ -0,0 +1,174 @@
+/**********************************
+ * FILE NAME: ConcurrentBench.cpp
+ *
+ * DESCRIPTION: Multi-threaded read/write mix benchmark of ConcurrentHashTable,
+ * 				against HashTable behind a single mutex
+ *
+ * RUN PROCEDURE:
+ * $ make bench
+ * $ ./ConcurrentBench [numKeys [maxThreads]]     e.g. ./ConcurrentBench 1000000 16
+ **********************************/
+
+#include "stdincludes.h"
+#include "ConcurrentHashTable.h"
+#include "HashTable.h"
+#include <chrono>
+#include <thread>
+
+/*
+ * Macros
+ */
+#define DEFAULT_KEYS 1000000
+#define OPS_PER_THREAD 2000000
+#define BENCH_KEY_LENGTH 6
+
+static const char alphanum[] =
+"0123456789"
+"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+"abcdefghijklmnopqrstuvwxyz";
+
+// percentage of reads in each mix
+static const int readPercents[] = {100, 90, 50};
+
+/**
+ * CLASS NAME: LockedHashTable
+ *
+ * DESCRIPTION: HashTable shared through one global mutex, the baseline
+ */
+class LockedHashTable {
+public:
+	bool read(string_view key, string &value) {
+		lock_guard<mutex> guard(lock);
+		const Entry *entry = table.find(key);
+		if ( entry == NULL ) {
+			return false;
+		}
+		value.assign(entry->value());
+		return true;
+	}
+	void insertOrAssign(string_view key, string_view value) {
+		lock_guard<mutex> guard(lock);
+		table.insertOrAssign(key, value);
+	}
+	void erase(string_view key) {
+		lock_guard<mutex> guard(lock);
+		table.erase(key);
+	}
+private:
+	mutex lock;
+	HashTable table;
+};
+
+/**
+ * FUNCTION NAME: makeKey
+ *
+ * DESCRIPTION: Deterministic, unique key for index i
+ */
+static void makeKey(uint64_t i, string &key) {
+	uint32_t x = (uint32_t)(i * 2654435761ULL);
+	key.assign(BENCH_KEY_LENGTH, '0');
+	for ( int c = 0; c < BENCH_KEY_LENGTH; c++ ) {
+		key[c] = alphanum[x % 62];
+		x /= 62;
+	}
+}
+
+/**
+ * FUNCTION NAME: worker
+ *
+ * DESCRIPTION: One benchmark thread. A write erases a key or puts it back,
+ * 				so the table size stays around numKeys and memory is retired.
+ */
+template <class Table>
+static void worker(Table *table, uint64_t numKeys, int readPercent, uint64_t seed, uint64_t *found) {
+	string key;
+	string value;
+	string newValue = "value";
+	uint64_t r = seed * 0x9E3779B97F4A7C15ULL + 88172645463325252ULL;
+	uint64_t hits = 0;
+	for ( uint64_t i = 0; i < OPS_PER_THREAD; i++ ) {
+		r ^= r << 13; r ^= r >> 7; r ^= r << 17;
+		makeKey((r >> 8) % numKeys, key);
+		if ( (int)(r % 100) < readPercent ) {
+			hits += table->read(key, value);
+		}
+		else if ( r & 0x80 ) {
+			table->erase(key);
+		}
+		else {
+			table->insertOrAssign(key, newValue);
+		}
+	}
+	*found = hits;
+}
+
+/**
+ * FUNCTION NAME: run
+ *
+ * DESCRIPTION: Preload numKeys keys, then run threads workers at once
+ *
+ * RETURNS:
+ * million operations per second over all threads
+ */
+template <class Table>
+static double run(Table *table, uint64_t numKeys, int threads, int readPercent) {
+	vector<thread> pool;
+	vector<uint64_t> found(threads);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for ( int t = 0; t < threads; t++ ) {
+		pool.push_back(thread(worker<Table>, table, numKeys, readPercent, (uint64_t)t + 1, &found[t]));
+	}
+	for ( int t = 0; t < threads; t++ ) {
+		pool[t].join();
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	return (double)threads * OPS_PER_THREAD / seconds / 1e6;
+}
+
+template <class Table>
+static void preload(Table *table, uint64_t numKeys) {
+	string key;
+	for ( uint64_t i = 0; i < numKeys; i++ ) {
+		makeKey(i, key);
+		table->insertOrAssign(key, "value");
+	}
+}
+
+/**********************************
+ * FUNCTION NAME: main
+ *
+ * DESCRIPTION: main function. Start from here
+ **********************************/
+int main(int argc, char *argv[]) {
+	uint64_t numKeys = DEFAULT_KEYS;
+	int maxThreads = (int)thread::hardware_concurrency();
+	if ( argc > 1 ) {
+		numKeys = strtoull(argv[1], NULL, 10);
+	}
+	if ( argc > 2 ) {
+		maxThreads = atoi(argv[2]);
+	}
+	if ( maxThreads < 1 ) {
+		maxThreads = 1;
+	}
+
+	ConcurrentHashTable concurrent;
+	LockedHashTable locked;
+	preload(&concurrent, numKeys);
+	preload(&locked, numKeys);
+
+	printf("%llu keys, %d ops per thread, %u hardware threads\n", (unsigned long long)numKeys, OPS_PER_THREAD,
+			thread::hardware_concurrency());
+	printf("%-8s %8s %14s %14s\n", "reads", "threads", "concurrent", "locked");
+	printf("%-8s %8s %14s %14s\n", "", "", "Mops/s", "Mops/s");
+	for ( size_t m = 0; m < sizeof(readPercents) / sizeof(readPercents[0]); m++ ) {
+		for ( int threads = 1; threads <= maxThreads; threads *= 2 ) {
+			double concurrentOps = run(&concurrent, numKeys, threads, readPercents[m]);
+			double lockedOps = run(&locked, numKeys, threads, readPercents[m]);
+			printf("%6d%% %8d %14.2f %14.2f\n", readPercents[m], threads, concurrentOps, lockedOps);
+		}
+	}
+	concurrent.getEpochManager().collect();
+	printf("retired, not yet freed: %zu\n", concurrent.getEpochManager().pendingCount());
+	return SUCCESS;
+}
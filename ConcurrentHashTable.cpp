@@ -0,0 +1,270 @@
+/**********************************
+ * FILE NAME: ConcurrentHashTable.cpp
+ *
+ * DESCRIPTION: ConcurrentHashTable class definition
+ **********************************/
+
+#include "ConcurrentHashTable.h"
+
+/**
+ * Constructor
+ */
+ConcurrentHashTable::ConcurrentHashTable(): table(newTable(CHT_MIN_BUCKETS)), size(0) {}
+
+/**
+ * Destructor. No other thread may use the table any more.
+ */
+ConcurrentHashTable::~ConcurrentHashTable() {
+	freeTableAndNodes(table.load());
+}
+
+string_view ConcurrentHashTable::Node::key() const {
+	return string_view((const char *)(this + 1), keySize);
+}
+
+string_view ConcurrentHashTable::Node::value() const {
+	return string_view((const char *)(this + 1) + keySize, valueSize);
+}
+
+/**
+ * FUNCTION NAME: hashKey
+ *
+ * DESCRIPTION: Hash of a key, mixed so that the low bits pick buckets and stripes well
+ */
+size_t ConcurrentHashTable::hashKey(string_view key) {
+	uint64_t h = (uint64_t)std::hash<string_view>()(key) * 0x9E3779B97F4A7C15ULL;
+	return (size_t)(h ^ (h >> 32));
+}
+
+/**
+ * FUNCTION NAME: newNode
+ *
+ * DESCRIPTION: Allocate a chain node holding copies of key and value
+ */
+ConcurrentHashTable::Node *ConcurrentHashTable::newNode(size_t hash, string_view key, string_view value, Node *next) {
+	Node *node = (Node *) malloc(sizeof(Node) + key.size() + value.size());
+	new (&node->next) std::atomic<Node *>(next);
+	node->hash = hash;
+	node->keySize = (uint32_t)key.size();
+	node->valueSize = (uint32_t)value.size();
+	memcpy((char *)(node + 1), key.data(), key.size());
+	memcpy((char *)(node + 1) + key.size(), value.data(), value.size());
+	return node;
+}
+
+/**
+ * FUNCTION NAME: newTable
+ *
+ * DESCRIPTION: Allocate an empty bucket array (buckets must be a power of two)
+ */
+ConcurrentHashTable::Table *ConcurrentHashTable::newTable(size_t buckets) {
+	Table *created = new Table;
+	created->mask = buckets - 1;
+	created->buckets = new std::atomic<Node *>[buckets];
+	for ( size_t i = 0; i < buckets; i++ ) {
+		created->buckets[i].store(NULL, memory_order_relaxed);
+	}
+	return created;
+}
+
+void ConcurrentHashTable::freeNode(void *node) {
+	free(node);
+}
+
+void ConcurrentHashTable::freeTable(void *table) {
+	Table *retired = (Table *) table;
+	delete[] retired->buckets;
+	delete retired;
+}
+
+void ConcurrentHashTable::freeTableAndNodes(void *table) {
+	Table *retired = (Table *) table;
+	for ( size_t i = 0; i <= retired->mask; i++ ) {
+		Node *node = retired->buckets[i].load(memory_order_relaxed);
+		while ( node != NULL ) {
+			Node *next = node->next.load(memory_order_relaxed);
+			free(node);
+			node = next;
+		}
+	}
+	freeTable(retired);
+}
+
+/**
+ * FUNCTION NAME: findNode
+ *
+ * DESCRIPTION: Walk the key's chain. The caller is pinned or holds the key's stripe.
+ *
+ * RETURNS:
+ * the node of the key, or NULL if not found
+ */
+ConcurrentHashTable::Node *ConcurrentHashTable::findNode(Table *current, size_t hash, string_view key) {
+	Node *node = current->buckets[hash & current->mask].load(memory_order_acquire);
+	while ( node != NULL ) {
+		if ( node->hash == hash && node->key() == key ) {
+			return node;
+		}
+		node = node->next.load(memory_order_acquire);
+	}
+	return NULL;
+}
+
+/**
+ * FUNCTION NAME: read
+ *
+ * DESCRIPTION: Lock free lookup. The value is copied out while pinned.
+ *
+ * RETURNS:
+ * true if the key was found
+ */
+bool ConcurrentHashTable::read(string_view key, string &value) {
+	size_t hash = hashKey(key);
+	EpochManager::Guard guard(epochs);
+	Node *node = findNode(table.load(memory_order_acquire), hash, key);
+	if ( node == NULL ) {
+		return false;
+	}
+	value.assign(node->value());
+	return true;
+}
+
+/**
+ * FUNCTION NAME: contains
+ *
+ * DESCRIPTION: Lock free membership test
+ */
+bool ConcurrentHashTable::contains(string_view key) {
+	size_t hash = hashKey(key);
+	EpochManager::Guard guard(epochs);
+	return findNode(table.load(memory_order_acquire), hash, key) != NULL;
+}
+
+/**
+ * FUNCTION NAME: insertOrAssign
+ *
+ * DESCRIPTION: Store the value under the key, replacing any previous value
+ *
+ * RETURNS:
+ * true if the key was inserted
+ * false if an existing value was replaced
+ */
+bool ConcurrentHashTable::insertOrAssign(string_view key, string_view value) {
+	size_t hash = hashKey(key);
+	size_t buckets;
+	{
+		lock_guard<mutex> lock(stripes[hash % CHT_STRIPES].lock);
+		// the table only changes while every stripe is held, so it is stable here
+		Table *current = table.load(memory_order_relaxed);
+		buckets = current->mask + 1;
+		std::atomic<Node *> *link = &current->buckets[hash & current->mask];
+		for ( Node *node = link->load(memory_order_relaxed); node != NULL; node = link->load(memory_order_relaxed) ) {
+			if ( node->hash == hash && node->key() == key ) {
+				// swap in a copy; readers on the old node still see its value
+				link->store(newNode(hash, key, value, node->next.load(memory_order_relaxed)), memory_order_release);
+				epochs.retire(node, freeNode);
+				return false;
+			}
+			link = &node->next;
+		}
+		Node *head = current->buckets[hash & current->mask].load(memory_order_relaxed);
+		current->buckets[hash & current->mask].store(newNode(hash, key, value, head), memory_order_release);
+	}
+	if ( size.fetch_add(1, memory_order_relaxed) + 1 > buckets * CHT_MAX_LOAD ) {
+		grow(buckets);
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: updateIfPresent
+ *
+ * DESCRIPTION: Replace the value of the key only if the key is found
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false if the key was not found
+ */
+bool ConcurrentHashTable::updateIfPresent(string_view key, string_view value) {
+	size_t hash = hashKey(key);
+	lock_guard<mutex> lock(stripes[hash % CHT_STRIPES].lock);
+	Table *current = table.load(memory_order_relaxed);
+	std::atomic<Node *> *link = &current->buckets[hash & current->mask];
+	for ( Node *node = link->load(memory_order_relaxed); node != NULL; node = link->load(memory_order_relaxed) ) {
+		if ( node->hash == hash && node->key() == key ) {
+			link->store(newNode(hash, key, value, node->next.load(memory_order_relaxed)), memory_order_release);
+			epochs.retire(node, freeNode);
+			return true;
+		}
+		link = &node->next;
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: erase
+ *
+ * DESCRIPTION: Delete the key. The node keeps its next pointer, so readers
+ * 				standing on it can finish their walk.
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false if the key was not found
+ */
+bool ConcurrentHashTable::erase(string_view key) {
+	size_t hash = hashKey(key);
+	lock_guard<mutex> lock(stripes[hash % CHT_STRIPES].lock);
+	Table *current = table.load(memory_order_relaxed);
+	std::atomic<Node *> *link = &current->buckets[hash & current->mask];
+	for ( Node *node = link->load(memory_order_relaxed); node != NULL; node = link->load(memory_order_relaxed) ) {
+		if ( node->hash == hash && node->key() == key ) {
+			link->store(node->next.load(memory_order_relaxed), memory_order_release);
+			epochs.retire(node, freeNode);
+			size.fetch_sub(1, memory_order_relaxed);
+			return true;
+		}
+		link = &node->next;
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: grow
+ *
+ * DESCRIPTION: Double the bucket array, unless another writer already did
+ * 				since the caller saw seenBuckets. Every stripe is held, so the
+ * 				old chains are frozen while they are copied.
+ */
+void ConcurrentHashTable::grow(size_t seenBuckets) {
+	for ( int i = 0; i < CHT_STRIPES; i++ ) {
+		stripes[i].lock.lock();
+	}
+	Table *current = table.load(memory_order_relaxed);
+	if ( current->mask + 1 == seenBuckets ) {
+		Table *grown = newTable(seenBuckets * 2);
+		for ( size_t i = 0; i <= current->mask; i++ ) {
+			for ( Node *node = current->buckets[i].load(memory_order_relaxed); node != NULL;
+					node = node->next.load(memory_order_relaxed) ) {
+				std::atomic<Node *> &bucket = grown->buckets[node->hash & grown->mask];
+				bucket.store(newNode(node->hash, node->key(), node->value(), bucket.load(memory_order_relaxed)),
+						memory_order_relaxed);
+			}
+		}
+		table.store(grown, memory_order_release);
+		epochs.retire(current, freeTableAndNodes);
+	}
+	for ( int i = CHT_STRIPES - 1; i >= 0; i-- ) {
+		stripes[i].lock.unlock();
+	}
+}
+
+size_t ConcurrentHashTable::currentSize() const {
+	return size.load(memory_order_relaxed);
+}
+
+size_t ConcurrentHashTable::bucketCount() const {
+	return table.load(memory_order_acquire)->mask + 1;
+}
+
+EpochManager& ConcurrentHashTable::getEpochManager() {
+	return epochs;
+}
@@ -0,0 +1,90 @@
+/**********************************
+ * FILE NAME: ConcurrentHashTable.h
+ *
+ * DESCRIPTION: Header file of the ConcurrentHashTable class
+ **********************************/
+
+#ifndef CONCURRENTHASHTABLE_H_
+#define CONCURRENTHASHTABLE_H_
+
+#include "stdincludes.h"
+#include "EpochManager.h"
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+
+/*
+ * Macros
+ */
+// number of write locks; a key's stripe does not depend on the table size
+#define CHT_STRIPES 256
+#define CHT_MIN_BUCKETS 1024
+// grow once there are more keys than buckets times this
+#define CHT_MAX_LOAD 1
+
+/**
+ * CLASS NAME: ConcurrentHashTable
+ *
+ * DESCRIPTION: Thread safe variant of HashTable for a multi-threaded server.
+ * 				Separate chaining over an array of atomic bucket heads.
+ * 				Chain nodes are immutable once published: an update links in
+ * 				a new node in place of the old one.
+ *
+ * 				Reads take no lock. They pin an epoch (EpochManager) and walk
+ * 				the chain with acquire loads.
+ * 				Writes lock one of CHT_STRIPES stripes chosen by key hash,
+ * 				so writers to different stripes run in parallel. Unlinked
+ * 				nodes are retired to the EpochManager and freed once no
+ * 				reader can still reach them.
+ * 				Growing takes every stripe, copies the chains into a doubled
+ * 				bucket array and publishes it; readers still on the old array
+ * 				see a consistent snapshot until they leave their epoch.
+ */
+class ConcurrentHashTable {
+public:
+	ConcurrentHashTable();
+	virtual ~ConcurrentHashTable();
+	bool read(string_view key, string &value);
+	bool contains(string_view key);
+	// returns true if the key was inserted, false if an existing value was replaced
+	bool insertOrAssign(string_view key, string_view value);
+	bool updateIfPresent(string_view key, string_view value);
+	bool erase(string_view key);
+	size_t currentSize() const;
+	size_t bucketCount() const;
+	EpochManager& getEpochManager();
+private:
+	// a chain node: key and value bytes follow the header in the same allocation
+	struct Node {
+		std::atomic<Node *> next;
+		size_t hash;
+		uint32_t keySize;
+		uint32_t valueSize;
+		string_view key() const;
+		string_view value() const;
+	};
+	struct Table {
+		size_t mask;
+		std::atomic<Node *> *buckets;
+	};
+	struct alignas(64) Stripe {
+		mutex lock;
+	};
+	std::atomic<Table *> table;
+	std::atomic<size_t> size;
+	Stripe stripes[CHT_STRIPES];
+	EpochManager epochs;
+	ConcurrentHashTable(const ConcurrentHashTable &anotherTable);
+	ConcurrentHashTable& operator =(const ConcurrentHashTable &anotherTable);
+	static size_t hashKey(string_view key);
+	static Node *newNode(size_t hash, string_view key, string_view value, Node *next);
+	static Table *newTable(size_t buckets);
+	static void freeNode(void *node);
+	static void freeTable(void *table);
+	static void freeTableAndNodes(void *table);
+	Node *findNode(Table *current, size_t hash, string_view key);
+	void grow(size_t seenBuckets);
+};
+
+#endif /* CONCURRENTHASHTABLE_H_ */
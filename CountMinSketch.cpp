@@ -0,0 +1,95 @@
+/**********************************
+ * FILE NAME: CountMinSketch.cpp
+ *
+ * DESCRIPTION: CountMinSketch class definition
+ **********************************/
+
+#include "CountMinSketch.h"
+
+/**
+ * Constructor
+ */
+CountMinSketch::CountMinSketch(size_t width, size_t depth): width(width), depth(depth),
+		counts(width * depth, 0), events(0) {
+	assert(width > 0 && (width & (width - 1)) == 0 && depth > 0 && depth <= SKETCH_MAX_DEPTH);
+}
+
+/**
+ * FUNCTION NAME: hash
+ *
+ * DESCRIPTION: std::hash with a final avalanche step, so that both halves
+ * 				of the result are usable for double hashing
+ */
+uint64_t CountMinSketch::hash(string_view key) {
+	uint64_t h = std::hash<string_view>()(key);
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Count one event of key. The counter of each row is derived
+ * 				from one hash by double hashing; only the counters that are
+ * 				below the new estimate are raised to it.
+ *
+ * RETURNS:
+ * the estimate of key after the event
+ */
+uint64_t CountMinSketch::add(string_view key) {
+	uint64_t h = hash(key);
+	uint64_t delta = (h >> 32) | 1;
+	size_t mask = width - 1;
+	uint32_t *cell[SKETCH_MAX_DEPTH];
+	uint32_t lowest = UINT32_MAX;
+	for ( size_t row = 0; row < depth; row++ ) {
+		cell[row] = &counts[row * width + (size_t)(h & mask)];
+		if ( *cell[row] < lowest ) {
+			lowest = *cell[row];
+		}
+		h += delta;
+	}
+	events++;
+	// a saturated counter stays put
+	if ( lowest == UINT32_MAX ) {
+		return lowest;
+	}
+	for ( size_t row = 0; row < depth; row++ ) {
+		if ( *cell[row] == lowest ) {
+			(*cell[row])++;
+		}
+	}
+	return (uint64_t) lowest + 1;
+}
+
+/**
+ * FUNCTION NAME: estimate
+ *
+ * RETURNS:
+ * an upper bound of the events counted for key
+ */
+uint64_t CountMinSketch::estimate(string_view key) const {
+	uint64_t h = hash(key);
+	uint64_t delta = (h >> 32) | 1;
+	size_t mask = width - 1;
+	uint32_t lowest = UINT32_MAX;
+	for ( size_t row = 0; row < depth; row++ ) {
+		uint32_t count = counts[row * width + (size_t)(h & mask)];
+		if ( count < lowest ) {
+			lowest = count;
+		}
+		h += delta;
+	}
+	return lowest;
+}
+
+uint64_t CountMinSketch::total() const {
+	return events;
+}
+
+void CountMinSketch::clear() {
+	fill(counts.begin(), counts.end(), 0);
+	events = 0;
+}
@@ -0,0 +1,52 @@
+/**********************************
+ * FILE NAME: CountMinSketch.h
+ *
+ * DESCRIPTION: Header file of the CountMinSketch class
+ **********************************/
+
+#ifndef COUNTMINSKETCH_H_
+#define COUNTMINSKETCH_H_
+
+#include "stdincludes.h"
+#include <stdint.h>
+
+/*
+ * Macros
+ */
+// counters per row (a power of two); an estimate is off by at most
+// e / SKETCH_WIDTH of all the events counted ...
+#define SKETCH_WIDTH 2048
+// ... except with probability e^-SKETCH_DEPTH
+#define SKETCH_DEPTH 4
+#define SKETCH_MAX_DEPTH 16
+
+/**
+ * CLASS NAME: CountMinSketch
+ *
+ * DESCRIPTION: Approximate event count per key in fixed memory. Each key
+ * 				maps to one counter in each of depth rows, and its estimate
+ * 				is the smallest of them: collisions only add, so the estimate
+ * 				never undercounts. Updates are conservative, raising only the
+ * 				counters below the new estimate, which keeps keys that share
+ * 				a counter with a hot key from inheriting all of its count.
+ * 				Adding and estimating cost depth counter accesses.
+ */
+class CountMinSketch {
+public:
+	CountMinSketch(size_t width = SKETCH_WIDTH, size_t depth = SKETCH_DEPTH);
+	// count one more event of key; returns its new estimate
+	uint64_t add(string_view key);
+	uint64_t estimate(string_view key) const;
+	// events counted over all keys
+	uint64_t total() const;
+	void clear();
+private:
+	size_t width;
+	size_t depth;
+	// depth rows of width counters
+	vector<uint32_t> counts;
+	uint64_t events;
+	static uint64_t hash(string_view key);
+};
+
+#endif /* COUNTMINSKETCH_H_ */
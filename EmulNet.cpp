@@ -77,30 +77,70 @@ void *EmulNet::ENinit(Address *myaddr, short port) {
 }
 
 /**
- * FUNCTION NAME: ENsend
+ * FUNCTION NAME: ENalloc
  *
- * DESCRIPTION: EmulNet send function
+ * DESCRIPTION: Take a message buffer with room for capacity payload bytes
+ * 				from the pool. The caller holds its only reference.
  *
  * RETURNS:
- * size
+ * the payload
  */
-int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
-	en_msg *em;
-	static char temp[2048];
+char *EmulNet::ENalloc(int capacity) {
+	en_msg *em = (en_msg *) pool.allocate(sizeof(en_msg) + capacity);
+	em->size = 0;
+	em->capacity = capacity;
+	em->refs = 1;
+	return (char *)(em + 1);
+}
+
+/**
+ * FUNCTION NAME: ENretain
+ *
+ * DESCRIPTION: Take another reference to a message buffer
+ */
+void EmulNet::ENretain(char *payload) {
+	((en_msg *) payload - 1)->refs++;
+}
+
+/**
+ * FUNCTION NAME: ENrelease
+ *
+ * DESCRIPTION: Drop a reference to a message buffer, returning it to the
+ * 				pool with the last one
+ */
+void EmulNet::ENrelease(char *payload) {
+	en_msg *em = (en_msg *) payload - 1;
+	if ( --em->refs == 0 ) {
+		pool.deallocate((char *) em, sizeof(en_msg) + em->capacity);
+	}
+}
+
+/**
+ * FUNCTION NAME: ENsendBuffer
+ *
+ * DESCRIPTION: EmulNet send function for a buffer from ENalloc holding size
+ * 				payload bytes. The caller's reference passes to the network,
+ * 				which releases it if the message is dropped; nothing is copied.
+ *
+ * RETURNS:
+ * size, or 0 if the message is dropped
+ */
+int EmulNet::ENsendBuffer(Address *myaddr, Address *toaddr, char *payload, int size) {
+	en_msg *em = (en_msg *) payload - 1;
 	int sendmsg = rand() % 100;
+	int dst = *(int *)(toaddr->addr);
 
-	if( (emulnet.currbuffsize >= ENBUFFSIZE) || (size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) || (par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100)) ) {
+	if( (dst < 0) || (dst > MAX_NODES) || (emulnet.mailbox[dst].size() >= ENMAILBOXSIZE) || (size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) || (par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100)) ) {
+		ENrelease(payload);
 		return 0;
 	}
 
-	em = (en_msg *)malloc(sizeof(en_msg) + size);
 	em->size = size;
-
 	memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
 	memcpy(&(em->to.addr), &(toaddr->addr), sizeof(em->from.addr));
-	memcpy(em + 1, data, size);
 
-	emulnet.buff[emulnet.currbuffsize++] = em;
+	emulnet.mailbox[dst].push_back(em);
+	emulnet.currbuffsize++;
 
 	int src = *(int *)(myaddr->addr);
 	int time = par->getcurrtime();
@@ -111,12 +151,30 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
 	sent_msgs[src][time]++;
 
 	#ifdef DEBUGLOG
-		sprintf(temp, "Sending 4+%d B msg type %d to %d.%d.%d.%d:%d ", size-4, *(int *)data, toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], *(short *)&toaddr->addr[4]);
+		static char temp[2048];
+		sprintf(temp, "Sending 4+%d B msg type %d to %d.%d.%d.%d:%d ", size-4, *(int *)payload, toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], *(short *)&toaddr->addr[4]);
 	#endif
 
 	return size;
 }
 
+/**
+ * FUNCTION NAME: ENsend
+ *
+ * DESCRIPTION: EmulNet send function: copies data into a pooled buffer
+ *
+ * RETURNS:
+ * size
+ */
+int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
+	if ( size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE ) {
+		return 0;
+	}
+	char *payload = ENalloc(size);
+	memcpy(payload, data, size);
+	return ENsendBuffer(myaddr, toaddr, payload, size);
+}
+
 /**
  * FUNCTION NAME: ENsend
  *
@@ -126,52 +184,38 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
  * size
  */
 int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
-	char * str = (char *) malloc(data.length() * sizeof(char));
-	memcpy(str, data.c_str(), data.size());
-	int ret = this->ENsend(myaddr, toaddr, str, (data.length() * sizeof(char)));
-	free(str);
-	return ret;
+	return this->ENsend(myaddr, toaddr, &data[0], (data.length() * sizeof(char)));
 }
 
 /**
  * FUNCTION NAME: ENrecv
  *
- * DESCRIPTION: EmulNet receive function
+ * DESCRIPTION: EmulNet receive function. Drains the mailbox of this node, in
+ * 				the order the messages were sent, so a receive costs only the
+ * 				messages waiting for it. Each message's buffer is handed to
+ * 				enq with the network's reference: the receiver releases it
+ * 				with ENrelease once it is done with the payload.
  *
  * RETURN:
  * 0
  */
 int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue){
 	// times is always assumed to be 1
-	int i;
-	char* tmp;
-	int sz;
-	en_msg *emsg;
-
-	for( i = emulnet.currbuffsize - 1; i >= 0; i-- ) {
-		emsg = emulnet.buff[i];
-
-		if ( 0 == strcmp(emsg->to.addr, myaddr->addr) ) {
-			sz = emsg->size;
-			tmp = (char *) malloc(sz * sizeof(char));
-			memcpy(tmp, (char *)(emsg+1), sz);
-
-			emulnet.buff[i] = emulnet.buff[emulnet.currbuffsize-1];
-			emulnet.currbuffsize--;
-
-			(*enq)(queue, (char *)tmp, sz);
-
-			free(emsg);
-
-			int dst = *(int *)(myaddr->addr);
-			int time = par->getcurrtime();
+	int dst = *(int *)(myaddr->addr);
+	int time = par->getcurrtime();
 
-			assert(dst <= MAX_NODES);
-			assert(time < MAX_TIME);
+	assert(dst >= 0 && dst <= MAX_NODES);
+	assert(time < MAX_TIME);
 
-			recv_msgs[dst][time]++;
-		}
+	vector<en_msg *> &mailbox = emulnet.mailbox[dst];
+	for ( size_t i = 0; i < mailbox.size(); i++ ) {
+		en_msg *emsg = mailbox[i];
+		(*enq)(queue, (char *)(emsg+1), emsg->size);
+		recv_msgs[dst][time]++;
 	}
+	emulnet.currbuffsize -= (int) mailbox.size();
+	// keeps its capacity for the next tick
+	mailbox.clear();
 
 	return 0;
 }
@@ -188,9 +232,13 @@ int EmulNet::ENcleanup() {
 
 	FILE* file = fopen("msgcount.log", "w+");
 
-	while(emulnet.currbuffsize > 0) {
-		free(emulnet.buff[--emulnet.currbuffsize]);
+	for ( i = 0; i <= MAX_NODES; i++ ) {
+		for ( j = 0; j < (int) emulnet.mailbox[i].size(); j++ ) {
+			ENrelease((char *)(emulnet.mailbox[i][j] + 1));
+		}
+		emulnet.mailbox[i].clear();
 	}
+	emulnet.currbuffsize = 0;
 
 	for ( i = 1; i <= par->EN_GPSZ; i++ ) {
 		fprintf(file, "node %3d ", i);
@@ -9,20 +9,28 @@
 
 #define MAX_NODES 1000
 #define MAX_TIME 3600
-#define ENBUFFSIZE 30000
+// messages waiting for one node; more are dropped
+#define ENMAILBOXSIZE 30000
 
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "SlabArena.h"
 
 using namespace std;
 
 /**
  * Struct Name: en_msg
+ *
+ * Header of a pooled message buffer; the payload follows it
  */
 typedef struct en_msg {
 	// Number of bytes after the class
 	int size;
+	// Payload bytes the buffer was allocated with
+	int capacity;
+	// Holders of the buffer; it goes back to the pool with the last one
+	int refs;
 	// Source node
 	Address from;
 	// Destination node
@@ -31,22 +39,23 @@ typedef struct en_msg {
 
 /**
  * Class Name: EM
+ *
+ * Messages in flight, in one mailbox per destination indexed by node id
  */
 class EM {
 public:
 	int nextid;
+	// messages in flight over all mailboxes
 	int currbuffsize;
 	int firsteltindex;
-	en_msg* buff[ENBUFFSIZE];
+	vector<en_msg*> mailbox[MAX_NODES + 1];
 	EM() {}
 	EM& operator = (EM &anotherEM) {
 		this->nextid = anotherEM.getNextId();
 		this->currbuffsize = anotherEM.getCurrBuffSize();
 		this->firsteltindex = anotherEM.getFirstEltIndex();
-		int i = this->currbuffsize;
-		while (i > 0) {
-			this->buff[i] = anotherEM.buff[i];
-			i--;
+		for ( int i = 0; i <= MAX_NODES; i++ ) {
+			this->mailbox[i] = anotherEM.mailbox[i];
 		}
 		return *this;
 	}
@@ -84,6 +93,8 @@ private:
 	int recv_msgs[MAX_NODES + 1][MAX_TIME];
 	int enInited;
 	EM emulnet;
+	// Size classed pool of the message buffers
+	SlabArena pool;
 public:
  	EmulNet(Params *p);
  	EmulNet(EmulNet &anotherEmulNet);
@@ -92,6 +103,11 @@ public:
 	void *ENinit(Address *myaddr, short port);
 	int ENsend(Address *myaddr, Address *toaddr, string data);
 	int ENsend(Address *myaddr, Address *toaddr, char *data, int size);
+	// pooled buffers: the payload is written once and passed on by ownership
+	char *ENalloc(int capacity);
+	int ENsendBuffer(Address *myaddr, Address *toaddr, char *payload, int size);
+	void ENretain(char *payload);
+	void ENrelease(char *payload);
 	int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue);
 	int ENcleanup();
 };
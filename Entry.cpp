@@ -1,5 +1,5 @@
 /**********************************
- * FILE NAME: Application.h
+ * FILE NAME: Entry.cpp
  *
  * DESCRIPTION: Entry class definition
  **********************************/
@@ -8,41 +8,80 @@
 /**
  * constructor
  */
-Entry::Entry(string _value, int _timestamp, ReplicaType _replica){
-	this->delimiter = ":";
-	value = _value;
-	timestamp = _timestamp;
-	replica = _replica;
-}
+Entry::Entry(): data(""), version(0), size(0), expiresAt(0), replica(PRIMARY), place(VALUE_INLINE),
+		flags(ENTRY_REFERENCED), touchedAt(0) {}
 
 /**
  * constructor
+ */
+Entry::Entry(string_view _value, uint64_t _version, ReplicaType _replica, uint32_t _expiresAt) {
+	setValue(_value);
+	version = _version;
+	expiresAt = _expiresAt;
+	replica = (uint8_t) _replica;
+	flags = ENTRY_REFERENCED;
+	touchedAt = 0;
+}
+
+/**
+ * FUNCTION NAME: setValue
  *
- * DESCRIPTION: Convert string to get an Entry object
+ * DESCRIPTION: Point the entry at new value bytes. The bytes are not copied.
  */
-Entry::Entry(string entry){
-	vector<string> tuple;
-	this->delimiter = ":";
-	size_t pos = entry.find(delimiter);
-	size_t start = 0;
-	while (pos != string::npos) {
-		string field = entry.substr(start, pos-start);
-		tuple.push_back(field);
-		start = pos + delimiter.size();
-		pos = entry.find(delimiter, start);
-	}
-	tuple.push_back(entry.substr(start));
-
-	value = tuple.at(0);
-	timestamp = stoi(tuple.at(1));
-	replica = static_cast<ReplicaType>(stoi(tuple.at(2)));
+void Entry::setValue(string_view _value) {
+	data = _value.data();
+	size = (uint32_t) _value.size();
+	place = VALUE_INLINE;
+}
+
+void Entry::setVersion(uint64_t _version) {
+	version = _version;
+}
+
+void Entry::setReplica(ReplicaType _replica) {
+	replica = (uint8_t) _replica;
 }
 
 /**
- * FUNCTION NAME: converToString
+ * FUNCTION NAME: setFlag
  *
- * DESCRIPTION: Convert the object to a string representation
+ * DESCRIPTION: Set or clear bit of flags
  */
-string Entry::convertToString() {
-	return value + delimiter + to_string(timestamp) + delimiter + to_string(replica);
+void Entry::setFlag(uint8_t bit, bool on) {
+	flags = on ? (flags | bit) : (flags & ~bit);
+}
+
+void Entry::setTombstone(bool _tombstone) {
+	setFlag(ENTRY_TOMBSTONE, _tombstone);
+}
+
+void Entry::setExpiresAt(uint32_t _expiresAt) {
+	expiresAt = _expiresAt;
+}
+
+void Entry::setSpilled(uint64_t offset) {
+	spillOffset = offset;
+	place = VALUE_SPILLED;
+}
+
+void Entry::setBlob(string_view pointer) {
+	setValue(pointer);
+	place = VALUE_BLOB;
+}
+
+void Entry::setShared(string_view _value) {
+	setValue(_value);
+	place = VALUE_SHARED;
+}
+
+void Entry::setReferenced(bool _referenced) {
+	setFlag(ENTRY_REFERENCED, _referenced);
+}
+
+void Entry::setCompressed(bool _compressed) {
+	setFlag(ENTRY_COMPRESSED, _compressed);
+}
+
+void Entry::setTouchedAt(uint32_t _touchedAt) {
+	touchedAt = _touchedAt;
 }
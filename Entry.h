@@ -1,25 +1,125 @@
 /**********************************
- * FILE NAME: Application.h
+ * FILE NAME: Entry.h
  *
  * DESCRIPTION: Header file Entry class
  **********************************/
 
+#ifndef ENTRY_H_
+#define ENTRY_H_
+
 #include "stdincludes.h"
-#include "Message.h"
+#include "common.h"
+#include <stdint.h>
+
+// where the value bytes of an entry live
+enum ValuePlace {VALUE_INLINE, VALUE_SPILLED, VALUE_BLOB, VALUE_SHARED};
+
+// bits of Entry::flags
+#define ENTRY_TOMBSTONE 1
+#define ENTRY_REFERENCED 2
+#define ENTRY_COMPRESSED 4
 
 /**
  * CLASS NAME: Entry
  *
- * DESCRIPTION: This class describes the entry for each key in the DHT
+ * DESCRIPTION: This class describes the entry for each key in the DHT.
+ * 				It is stored in place in the HashTable slot: a view of the
+ * 				value bytes (owned by the table's arena), the 64-bit version
+ * 				used for last-writer-wins, the replica type and the expiry
+ * 				tick, packed into 32 bytes. Fields are read directly; nothing
+ * 				is parsed.
+ * 				A tombstone marks a deleted key in storage that keeps older
+ * 				copies of it around (the LSM memtable and sorted runs).
+ * 				An entry with a time-to-live expires at the tick expiresAt
+ * 				(Params::getcurrtime); 0 means never.
+ * 				A table over its memory budget spills cold values to a file:
+ * 				a spilled entry holds the file offset in place of the value
+ * 				pointer, and its value must be read back before value() is
+ * 				used. The referenced bit is the CLOCK bit of that eviction.
+ * 				A table with a cold tier uses the same bit, and touchedAt is
+ * 				the tick its demotion hand last found the entry referenced.
+ * 				In a persistent table a large value is kept in a ValueLog: the
+ * 				entry is a blob whose value bytes are the pointer to it.
+ * 				A table that deduplicates values points a shared entry at the
+ * 				one copy of its value in the table's ValueDedup.
+ * 				A compressed entry's value bytes, wherever they live, are
+ * 				encoded with the table's ValueDictionary.
  */
 class Entry{
 public:
-	string value;
-	int timestamp;
-	ReplicaType replica;
-	string delimiter;
-
-	Entry(string entry);
-	Entry(string _value, int _timestamp, ReplicaType _replica);
-	string convertToString();
+	Entry();
+	Entry(string_view _value, uint64_t _version, ReplicaType _replica, uint32_t _expiresAt = 0);
+	string_view value() const {
+		return string_view(data, size);
+	}
+	uint64_t getVersion() const {
+		return version;
+	}
+	ReplicaType getReplica() const {
+		return (ReplicaType) replica;
+	}
+	bool isTombstone() const {
+		return (flags & ENTRY_TOMBSTONE) != 0;
+	}
+	uint32_t getExpiresAt() const {
+		return expiresAt;
+	}
+	bool isExpired(uint32_t now) const {
+		return expiresAt != 0 && expiresAt <= now;
+	}
+	// true if this entry should replace one holding storedVersion
+	bool supersedes(uint64_t storedVersion) const {
+		return version >= storedVersion;
+	}
+	bool isSpilled() const {
+		return place == VALUE_SPILLED;
+	}
+	bool isBlob() const {
+		return place == VALUE_BLOB;
+	}
+	bool isShared() const {
+		return place == VALUE_SHARED;
+	}
+	uint64_t getSpillOffset() const {
+		return spillOffset;
+	}
+	bool isReferenced() const {
+		return (flags & ENTRY_REFERENCED) != 0;
+	}
+	bool isCompressed() const {
+		return (flags & ENTRY_COMPRESSED) != 0;
+	}
+	uint32_t getTouchedAt() const {
+		return touchedAt;
+	}
+	void setValue(string_view _value);
+	void setVersion(uint64_t _version);
+	void setReplica(ReplicaType _replica);
+	void setTombstone(bool _tombstone);
+	void setExpiresAt(uint32_t _expiresAt);
+	// the value (of the current size) now lives at offset in the spill file
+	void setSpilled(uint64_t offset);
+	// the value lives in a value log; pointer locates it there
+	void setBlob(string_view pointer);
+	// the value is a reference-counted copy owned by a ValueDedup
+	void setShared(string_view _value);
+	void setReferenced(bool _referenced);
+	// the value bytes are encoded with a ValueDictionary; kept by setValue
+	void setCompressed(bool _compressed);
+	void setTouchedAt(uint32_t _touchedAt);
+private:
+	union {
+		const char *data;
+		uint64_t spillOffset;
+	};
+	uint64_t version;
+	uint32_t size;
+	uint32_t expiresAt;
+	uint8_t replica;
+	uint8_t place;
+	uint8_t flags;
+	uint32_t touchedAt;
+	void setFlag(uint8_t bit, bool on);
 };
+
+#endif /* ENTRY_H_ */
@@ -0,0 +1,196 @@
+/**********************************
+ * FILE NAME: EpochManager.cpp
+ *
+ * DESCRIPTION: EpochManager class definition
+ **********************************/
+
+#include "EpochManager.h"
+#include <mutex>
+
+/**
+ * CLASS NAME: ThreadSlot
+ *
+ * DESCRIPTION: Slot index of the calling thread, shared by every EpochManager.
+ * 				The index goes back to the free pool when the thread exits.
+ */
+class ThreadSlot {
+public:
+	int index;
+	ThreadSlot() {
+		lock_guard<mutex> lock(poolLock);
+		if ( !freeSlots.empty() ) {
+			index = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else {
+			index = nextSlot++;
+		}
+		assert(index < EBR_MAX_THREADS);
+	}
+	~ThreadSlot() {
+		lock_guard<mutex> lock(poolLock);
+		freeSlots.push_back(index);
+	}
+private:
+	static mutex poolLock;
+	static vector<int> freeSlots;
+	static int nextSlot;
+};
+
+mutex ThreadSlot::poolLock;
+vector<int> ThreadSlot::freeSlots;
+int ThreadSlot::nextSlot = 0;
+
+/**
+ * Constructor
+ */
+EpochManager::EpochManager(): globalEpoch(1) {
+	for ( int i = 0; i < EBR_MAX_THREADS; i++ ) {
+		slots[i].pin.store(0, memory_order_relaxed);
+		slots[i].depth = 0;
+	}
+}
+
+/**
+ * Destructor. No thread may be pinned any more.
+ */
+EpochManager::~EpochManager() {
+	for ( int i = 0; i < EBR_MAX_THREADS; i++ ) {
+		reclaim(slots[i], true);
+	}
+}
+
+/**
+ * FUNCTION NAME: threadSlot
+ *
+ * DESCRIPTION: Slot index of the calling thread
+ */
+int EpochManager::threadSlot() {
+	static thread_local ThreadSlot slot;
+	return slot.index;
+}
+
+/**
+ * FUNCTION NAME: enter
+ *
+ * DESCRIPTION: Pin the calling thread to the current epoch
+ */
+void EpochManager::enter() {
+	Slot &slot = slots[threadSlot()];
+	if ( slot.depth++ > 0 ) {
+		return;
+	}
+	// seq_cst: the pin must be visible before any shared pointer is loaded
+	slot.pin.store((globalEpoch.load() << 1) | 1);
+}
+
+/**
+ * FUNCTION NAME: exit
+ *
+ * DESCRIPTION: Unpin the calling thread
+ */
+void EpochManager::exit() {
+	Slot &slot = slots[threadSlot()];
+	if ( --slot.depth > 0 ) {
+		return;
+	}
+	slot.pin.store(0, memory_order_release);
+}
+
+/**
+ * FUNCTION NAME: retire
+ *
+ * DESCRIPTION: Hand an object that is no longer reachable to the manager.
+ * 				reclaim(object) is called once no pinned thread can see it.
+ */
+void EpochManager::retire(void *object, void (*reclaim)(void *)) {
+	Slot &slot = slots[threadSlot()];
+	Retired retired = {object, reclaim, globalEpoch.load()};
+	slot.retired.push_back(retired);
+	if ( slot.retired.size() % EBR_RETIRE_BATCH == 0 ) {
+		collect();
+	}
+}
+
+/**
+ * FUNCTION NAME: collect
+ *
+ * DESCRIPTION: Try to advance the epoch, then free the calling thread's
+ * 				retired objects that have become safe
+ */
+void EpochManager::collect() {
+	tryAdvance();
+	reclaim(slots[threadSlot()], false);
+}
+
+/**
+ * FUNCTION NAME: tryAdvance
+ *
+ * DESCRIPTION: Move the global epoch forward if every pinned thread has seen it
+ *
+ * RETURNS:
+ * true if the epoch was advanced
+ */
+bool EpochManager::tryAdvance() {
+	uint64_t epoch = globalEpoch.load();
+	for ( int i = 0; i < EBR_MAX_THREADS; i++ ) {
+		uint64_t pin = slots[i].pin.load();
+		if ( (pin & 1) && (pin >> 1) != epoch ) {
+			return false;
+		}
+	}
+	return globalEpoch.compare_exchange_strong(epoch, epoch + 1);
+}
+
+/**
+ * FUNCTION NAME: reclaim
+ *
+ * DESCRIPTION: Free the retired objects of a slot that are at least two epochs
+ * 				old, or all of them
+ */
+void EpochManager::reclaim(Slot &slot, bool all) {
+	uint64_t epoch = globalEpoch.load();
+	size_t kept = 0;
+	for ( size_t i = 0; i < slot.retired.size(); i++ ) {
+		Retired &retired = slot.retired[i];
+		if ( all || retired.epoch + 2 <= epoch ) {
+			retired.reclaim(retired.object);
+		}
+		else {
+			slot.retired[kept++] = retired;
+		}
+	}
+	slot.retired.resize(kept);
+}
+
+uint64_t EpochManager::currentEpoch() const {
+	return globalEpoch.load();
+}
+
+/**
+ * FUNCTION NAME: pendingCount
+ *
+ * DESCRIPTION: Number of retired objects not yet freed. Only exact while no
+ * 				other thread is retiring.
+ */
+size_t EpochManager::pendingCount() const {
+	size_t pending = 0;
+	for ( int i = 0; i < EBR_MAX_THREADS; i++ ) {
+		pending += slots[i].retired.size();
+	}
+	return pending;
+}
+
+/**
+ * Guard constructor
+ */
+EpochManager::Guard::Guard(EpochManager &manager): manager(manager) {
+	manager.enter();
+}
+
+/**
+ * Guard destructor
+ */
+EpochManager::Guard::~Guard() {
+	manager.exit();
+}
@@ -0,0 +1,86 @@
+/**********************************
+ * FILE NAME: EpochManager.h
+ *
+ * DESCRIPTION: Header file of the EpochManager class
+ **********************************/
+
+#ifndef EPOCHMANAGER_H_
+#define EPOCHMANAGER_H_
+
+#include "stdincludes.h"
+#include <stdint.h>
+#include <atomic>
+
+/*
+ * Macros
+ */
+// most threads that can use one EpochManager at the same time
+#define EBR_MAX_THREADS 128
+// retired objects a thread collects before it tries to reclaim
+#define EBR_RETIRE_BATCH 64
+
+/**
+ * CLASS NAME: EpochManager
+ *
+ * DESCRIPTION: Epoch based reclamation. Readers pin the current global epoch
+ * 				while they traverse shared objects; writers retire unlinked
+ * 				objects instead of freeing them. An object retired in epoch e
+ * 				is freed once the global epoch reaches e + 2, since by then
+ * 				every reader that could still hold a pointer to it has left.
+ * 				The global epoch only advances when every pinned thread has
+ * 				seen it.
+ *
+ * 				Each thread owns one slot (its pin and its retire list); slots
+ * 				are handed out per process thread and recycled on thread exit.
+ */
+class EpochManager {
+public:
+	/**
+	 * CLASS NAME: Guard
+	 *
+	 * DESCRIPTION: Pins the calling thread for its lifetime. Guards nest.
+	 */
+	class Guard {
+	public:
+		Guard(EpochManager &manager);
+		~Guard();
+	private:
+		EpochManager &manager;
+		Guard(const Guard &anotherGuard);
+		Guard& operator =(const Guard &anotherGuard);
+	};
+
+	EpochManager();
+	virtual ~EpochManager();
+	void enter();
+	void exit();
+	// free object with reclaim once no pinned thread can still see it
+	void retire(void *object, void (*reclaim)(void *));
+	// try to advance the epoch and free what has become safe
+	void collect();
+	uint64_t currentEpoch() const;
+	// objects retired but not yet freed, over all threads
+	size_t pendingCount() const;
+private:
+	struct Retired {
+		void *object;
+		void (*reclaim)(void *);
+		uint64_t epoch;
+	};
+	struct alignas(64) Slot {
+		// (epoch << 1) | 1 while pinned, 0 otherwise
+		std::atomic<uint64_t> pin;
+		// only touched by the owning thread
+		int depth;
+		vector<Retired> retired;
+	};
+	std::atomic<uint64_t> globalEpoch;
+	Slot slots[EBR_MAX_THREADS];
+	EpochManager(const EpochManager &anotherManager);
+	EpochManager& operator =(const EpochManager &anotherManager);
+	bool tryAdvance();
+	void reclaim(Slot &slot, bool all);
+	static int threadSlot();
+};
+
+#endif /* EPOCHMANAGER_H_ */
@@ -0,0 +1,646 @@
+/**********************************
+ * FILE NAME: FlatHashMap.h
+ *
+ * DESCRIPTION: Open-addressing hash map with Swiss table style control bytes
+ **********************************/
+
+#ifndef FLATHASHMAP_H_
+#define FLATHASHMAP_H_
+
+#include "stdincludes.h"
+#include <stdint.h>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <tuple>
+#include <new>
+#include <sys/mman.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Control byte values. A full slot stores the low 7 bits of its hash (H2),
+ * so every special value has the top bit set and sorts below zero.
+ */
+#define FLAT_EMPTY ((int8_t) -128)
+#define FLAT_DELETED ((int8_t) -2)
+#define FLAT_SENTINEL ((int8_t) -1)
+// smallest table ever allocated; must be at least one group wide
+#define FLAT_MIN_CAPACITY 16
+// slots of the old table moved over by each insert while the table grows
+#define FLAT_MIGRATE_SLOTS 16
+// moved old slots are handed back to the OS in chunks of this many bytes
+#define FLAT_RETURN_BYTES (64 << 10)
+
+/**
+ * CLASS NAME: FlatGroup
+ *
+ * DESCRIPTION: A group of control bytes that is matched against in one step.
+ * 				With SSE2 a group is 16 bytes compared by a single instruction,
+ * 				otherwise 8 bytes compared with word-wide bit tricks.
+ * 				Matches are returned as a bit mask; use index() to decode
+ * 				the lowest set position.
+ */
+#ifdef __SSE2__
+class FlatGroup {
+public:
+	static const size_t WIDTH = 16;
+	explicit FlatGroup(const int8_t *pos) {
+		ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos));
+	}
+	uint64_t match(int8_t h2) const {
+		return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl));
+	}
+	uint64_t matchEmpty() const {
+		return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(FLAT_EMPTY), ctrl));
+	}
+	uint64_t matchEmptyOrDeleted() const {
+		return (uint32_t)_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(FLAT_SENTINEL), ctrl));
+	}
+	static size_t index(uint64_t mask) {
+		return (size_t)__builtin_ctzll(mask);
+	}
+private:
+	__m128i ctrl;
+};
+#else
+class FlatGroup {
+public:
+	static const size_t WIDTH = 8;
+	explicit FlatGroup(const int8_t *pos) {
+		memcpy(&ctrl, pos, sizeof(ctrl));
+	}
+	// May report false positives; callers always compare the key afterwards
+	uint64_t match(int8_t h2) const {
+		uint64_t x = ctrl ^ (LSBS * (uint8_t)h2);
+		return (x - LSBS) & ~x & MSBS;
+	}
+	uint64_t matchEmpty() const {
+		return (ctrl & (~ctrl << 6)) & MSBS;
+	}
+	uint64_t matchEmptyOrDeleted() const {
+		return (ctrl & (~ctrl << 7)) & MSBS;
+	}
+	static size_t index(uint64_t mask) {
+		return (size_t)__builtin_ctzll(mask) >> 3;
+	}
+private:
+	static const uint64_t LSBS = 0x0101010101010101ULL;
+	static const uint64_t MSBS = 0x8080808080808080ULL;
+	uint64_t ctrl;
+};
+#endif
+
+/**
+ * CLASS NAME: FlatStringHash
+ *
+ * DESCRIPTION: Hash for string keys that also accepts string_view and
+ * 				C strings. Hashes agree across all three, which lets
+ * 				lookups skip building a temporary string.
+ */
+class FlatStringHash {
+public:
+	size_t operator ()(string_view key) const {
+		return std::hash<string_view>()(key);
+	}
+};
+
+/**
+ * CLASS NAME: FlatHashMap
+ *
+ * DESCRIPTION: Cache friendly replacement for std::map/std::unordered_map.
+ * 				Entries live in one flat slot array next to a parallel array
+ * 				of control bytes, so a lookup touches one group of control
+ * 				bytes and normally a single slot. Erased slots become
+ * 				tombstones which are purged on the next resize.
+ *
+ * 				A resize does not move every entry at once. The new arrays
+ * 				are allocated and the old ones kept, and each following
+ * 				insert moves the next FLAT_MIGRATE_SLOTS old slots over, so
+ * 				no insert pays for more than that. Until the old table is
+ * 				empty, lookups that miss the new table probe the old one.
+ * 				At one insert per FLAT_MIGRATE_SLOTS old slots, the move
+ * 				ends long before the new table fills up.
+ *
+ * 				The interface mirrors the subset of std::map used by the
+ * 				storage layer. Iterators are invalidated by inserts while the
+ * 				table grows (an insert may move entries), but not by erase.
+ */
+template <class K, class V, class Hash = std::hash<K>, class KeyEqual = std::equal_to<K> >
+class FlatHashMap {
+public:
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef std::pair<const K, V> value_type;
+	typedef size_t size_type;
+
+	template <class MapPtr, class Ref, class Ptr>
+	class Iterator {
+	public:
+		Iterator(): map(NULL), pos(0) {}
+		Iterator(MapPtr map, size_t pos): map(map), pos(pos) {}
+		// allow iterator -> const_iterator
+		template <class M, class R, class P>
+		Iterator(const Iterator<M, R, P> &another): map(another.map), pos(another.pos) {}
+		Ref operator *() const {
+			return map->slotAt(pos);
+		}
+		Ptr operator ->() const {
+			return &map->slotAt(pos);
+		}
+		Iterator& operator ++() {
+			pos = map->nextFull(pos + 1);
+			return *this;
+		}
+		Iterator operator ++(int) {
+			Iterator old = *this;
+			++*this;
+			return old;
+		}
+		bool operator ==(const Iterator &another) const {
+			return pos == another.pos;
+		}
+		bool operator !=(const Iterator &another) const {
+			return pos != another.pos;
+		}
+		MapPtr map;
+		size_t pos;
+	};
+	typedef Iterator<FlatHashMap *, value_type &, value_type *> iterator;
+	typedef Iterator<const FlatHashMap *, const value_type &, const value_type *> const_iterator;
+
+	FlatHashMap(): ctrl(NULL), slots(NULL), capacity_(0), size_(0), growthLeft(0), oldCtrl(NULL), oldSlots(NULL),
+			oldCapacity(0), migrated(0), returned(NULL) {}
+	FlatHashMap(const FlatHashMap &another): ctrl(NULL), slots(NULL), capacity_(0), size_(0), growthLeft(0),
+			oldCtrl(NULL), oldSlots(NULL), oldCapacity(0), migrated(0), returned(NULL) {
+		reserve(another.size());
+		for ( const_iterator it = another.begin(); it != another.end(); ++it ) {
+			emplace(it->first, it->second);
+		}
+	}
+	FlatHashMap& operator =(const FlatHashMap &another) {
+		if ( this != &another ) {
+			clear();
+			reserve(another.size());
+			for ( const_iterator it = another.begin(); it != another.end(); ++it ) {
+				emplace(it->first, it->second);
+			}
+		}
+		return *this;
+	}
+	virtual ~FlatHashMap() {
+		destroyAll();
+		release(ctrl, slots);
+		release(oldCtrl, oldSlots);
+	}
+
+	iterator begin() {
+		return iterator(this, nextFull(0));
+	}
+	iterator end() {
+		return iterator(this, endIndex());
+	}
+	const_iterator begin() const {
+		return const_iterator(this, nextFull(0));
+	}
+	const_iterator end() const {
+		return const_iterator(this, endIndex());
+	}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+	size_t size() const {
+		return size_;
+	}
+	size_t capacity() const {
+		return capacity_;
+	}
+
+	/*
+	 * Lookups accept any key type that Hash and KeyEqual accept, so a table
+	 * keyed by string can be probed with a string_view (see FlatStringHash)
+	 */
+	template <class KK>
+	iterator find(const KK &key) {
+		return iterator(this, findIndex(key));
+	}
+	template <class KK>
+	const_iterator find(const KK &key) const {
+		return const_iterator(this, findIndex(key));
+	}
+	// find with the hash returned by prefetch
+	template <class KK>
+	iterator find(const KK &key, size_t hash) {
+		return iterator(this, findIndex(key, hash));
+	}
+	template <class KK>
+	size_t count(const KK &key) const {
+		return findIndex(key) != endIndex() ? 1 : 0;
+	}
+
+	/**
+	 * Batched lookups. prefetch hashes the key and starts loading the control
+	 * bytes of its first probe group; prefetchSlot then starts loading the
+	 * slot of the first control byte matching the hash. Running both over a
+	 * batch of keys before finding any of them overlaps their cache misses.
+	 * Both are hints only and change nothing; they only look at the new
+	 * table while the table grows.
+	 */
+	template <class KK>
+	size_t prefetch(const KK &key) const {
+		size_t hash = hashOf(key);
+		if ( capacity_ != 0 ) {
+			__builtin_prefetch(ctrl + ((hash >> 7) & (capacity_ - 1)));
+		}
+		return hash;
+	}
+	void prefetchSlot(size_t hash) const {
+		if ( capacity_ == 0 ) {
+			return;
+		}
+		size_t mask = capacity_ - 1;
+		size_t pos = (hash >> 7) & mask;
+		uint64_t m = FlatGroup(ctrl + pos).match(h2(hash));
+		if ( m ) {
+			__builtin_prefetch(slots + ((pos + FlatGroup::index(m)) & mask));
+		}
+	}
+	template <class KK>
+	V& at(const KK &key) {
+		size_t pos = findIndex(key);
+		if ( pos == endIndex() ) {
+			throw std::out_of_range("FlatHashMap::at");
+		}
+		return slotAt(pos).second;
+	}
+	V& operator [](const K &key) {
+		return emplace(key, V()).first->second;
+	}
+
+	/**
+	 * Inserts (key, value) unless key is already present.
+	 * Returns the position of the key and whether an insert happened.
+	 */
+	template <class KK, class VV>
+	std::pair<iterator, bool> emplace(KK &&key, VV &&value) {
+		size_t hash = hashOf(key);
+		size_t pos = findIndex(key, hash);
+		if ( pos != endIndex() ) {
+			return std::make_pair(iterator(this, pos), false);
+		}
+		pos = prepareInsert(hash);
+		new (&slots[pos]) value_type(std::forward<KK>(key), std::forward<VV>(value));
+		return std::make_pair(iterator(this, pos), true);
+	}
+	// the hint is accepted for std::map compatibility and ignored
+	template <class KK, class VV>
+	iterator emplace_hint(const_iterator hint, KK &&key, VV &&value) {
+		return emplace(std::forward<KK>(key), std::forward<VV>(value)).first;
+	}
+	std::pair<iterator, bool> insert(const value_type &value) {
+		return emplace(value.first, value.second);
+	}
+
+	/**
+	 * Single probe find-or-insert. When key is absent the entry is built
+	 * as (K(key), V(args...)); otherwise nothing is constructed.
+	 */
+	template <class KK, class... Args>
+	std::pair<iterator, bool> try_emplace(const KK &key, Args&&... args) {
+		size_t hash = hashOf(key);
+		size_t pos = findIndex(key, hash);
+		if ( pos != endIndex() ) {
+			return std::make_pair(iterator(this, pos), false);
+		}
+		pos = prepareInsert(hash);
+		new (&slots[pos]) value_type(std::piecewise_construct, std::forward_as_tuple(key),
+				std::forward_as_tuple(std::forward<Args>(args)...));
+		return std::make_pair(iterator(this, pos), true);
+	}
+
+	/**
+	 * Like try_emplace, but the stored key is produced by makeKey() and only
+	 * when an insert happens. Used when the key has to be copied into storage
+	 * owned by the caller (e.g. an arena) before it can be kept.
+	 */
+	template <class KK, class MakeKey>
+	std::pair<iterator, bool> lazy_emplace(const KK &key, MakeKey makeKey) {
+		size_t hash = hashOf(key);
+		size_t pos = findIndex(key, hash);
+		if ( pos != endIndex() ) {
+			return std::make_pair(iterator(this, pos), false);
+		}
+		pos = prepareInsert(hash);
+		new (&slots[pos]) value_type(makeKey(), V());
+		return std::make_pair(iterator(this, pos), true);
+	}
+
+	void erase(iterator it) {
+		eraseAt(it.pos);
+	}
+	template <class KK>
+	size_t erase(const KK &key) {
+		size_t pos = findIndex(key);
+		if ( pos == endIndex() ) {
+			return 0;
+		}
+		eraseAt(pos);
+		return 1;
+	}
+
+	void clear() {
+		destroyAll();
+		release(oldCtrl, oldSlots);
+		oldCtrl = NULL;
+		oldSlots = NULL;
+		oldCapacity = 0;
+		migrated = 0;
+		returned = NULL;
+		if ( capacity_ ) {
+			memset(ctrl, FLAT_EMPTY, capacity_ + FlatGroup::WIDTH);
+		}
+		size_ = 0;
+		growthLeft = maxLoad(capacity_);
+	}
+
+	void swap(FlatHashMap &another) {
+		std::swap(ctrl, another.ctrl);
+		std::swap(slots, another.slots);
+		std::swap(capacity_, another.capacity_);
+		std::swap(size_, another.size_);
+		std::swap(growthLeft, another.growthLeft);
+		std::swap(oldCtrl, another.oldCtrl);
+		std::swap(oldSlots, another.oldSlots);
+		std::swap(oldCapacity, another.oldCapacity);
+		std::swap(migrated, another.migrated);
+		std::swap(returned, another.returned);
+	}
+
+	/**
+	 * Grow the table so that n entries fit without a resize. Unlike growth
+	 * by inserts, the entries are all moved before this returns.
+	 */
+	void reserve(size_t n) {
+		size_t cap = FLAT_MIN_CAPACITY;
+		while ( maxLoad(cap) < n ) {
+			cap <<= 1;
+		}
+		if ( cap > capacity_ ) {
+			resize(cap);
+			migrate(oldCapacity);
+		}
+	}
+
+private:
+	int8_t *ctrl;
+	value_type *slots;
+	size_t capacity_;
+	size_t size_;
+	// number of EMPTY slots that may still be filled before growing
+	size_t growthLeft;
+	// table being moved into ctrl and slots by a resize; NULL otherwise
+	int8_t *oldCtrl;
+	value_type *oldSlots;
+	size_t oldCapacity;
+	// old slots below this one have been moved
+	size_t migrated;
+	// the pages of the old slot array below this have been handed back
+	char *returned;
+
+	// load factor is capped at 7/8
+	static size_t maxLoad(size_t cap) {
+		return cap - cap / 8;
+	}
+
+	template <class KK>
+	static size_t hashOf(const KK &key) {
+		// Mix the user hash so that identity hashes spread over both H1 and H2
+		uint64_t x = (uint64_t)Hash()(key) * 0x9E3779B97F4A7C15ULL;
+		return (size_t)(x ^ (x >> 32));
+	}
+	static int8_t h2(size_t hash) {
+		return (int8_t)(hash & 0x7F);
+	}
+
+	static void setCtrl(int8_t *ctrl, size_t capacity, size_t pos, int8_t value) {
+		ctrl[pos] = value;
+		// mirror the first group past the end so unaligned loads wrap around
+		if ( pos < FlatGroup::WIDTH ) {
+			ctrl[capacity + pos] = value;
+		}
+	}
+
+	// iterator positions run over the new table, then over the old one
+	size_t endIndex() const {
+		return capacity_ + oldCapacity;
+	}
+	value_type &slotAt(size_t pos) const {
+		return pos < capacity_ ? slots[pos] : oldSlots[pos - capacity_];
+	}
+
+	template <class KK>
+	size_t findIndex(const KK &key) const {
+		return findIndex(key, hashOf(key));
+	}
+
+	/**
+	 * Position of key in the new table or else the old one, or endIndex()
+	 * if key is absent
+	 */
+	template <class KK>
+	size_t findIndex(const KK &key, size_t hash) const {
+		size_t pos = probe(ctrl, slots, capacity_, key, hash);
+		if ( pos < capacity_ ) {
+			return pos;
+		}
+		if ( oldCapacity != 0 ) {
+			pos = probe(oldCtrl, oldSlots, oldCapacity, key, hash);
+			if ( pos < oldCapacity ) {
+				return capacity_ + pos;
+			}
+		}
+		return endIndex();
+	}
+
+	/**
+	 * Probe groups in triangular order. Returns capacity if key is absent.
+	 */
+	template <class KK>
+	static size_t probe(const int8_t *ctrl, const value_type *slots, size_t capacity, const KK &key, size_t hash) {
+		if ( capacity == 0 ) {
+			return 0;
+		}
+		size_t mask = capacity - 1;
+		size_t pos = (hash >> 7) & mask;
+		size_t step = 0;
+		KeyEqual eq;
+		while ( true ) {
+			FlatGroup group(ctrl + pos);
+			for ( uint64_t m = group.match(h2(hash)); m; m &= m - 1 ) {
+				size_t idx = (pos + FlatGroup::index(m)) & mask;
+				if ( eq(slots[idx].first, key) ) {
+					return idx;
+				}
+			}
+			if ( group.matchEmpty() ) {
+				return capacity;
+			}
+			step += FlatGroup::WIDTH;
+			pos = (pos + step) & mask;
+		}
+	}
+
+	size_t findFirstNonFull(size_t hash) const {
+		size_t mask = capacity_ - 1;
+		size_t pos = (hash >> 7) & mask;
+		size_t step = 0;
+		while ( true ) {
+			uint64_t m = FlatGroup(ctrl + pos).matchEmptyOrDeleted();
+			if ( m ) {
+				return (pos + FlatGroup::index(m)) & mask;
+			}
+			step += FlatGroup::WIDTH;
+			pos = (pos + step) & mask;
+		}
+	}
+
+	/**
+	 * Claim a slot for a key known to be absent. The slot is left unconstructed.
+	 */
+	size_t prepareInsert(size_t hash) {
+		if ( capacity_ == 0 ) {
+			resize(FLAT_MIN_CAPACITY);
+		}
+		if ( oldCapacity != 0 ) {
+			migrate(FLAT_MIGRATE_SLOTS);
+		}
+		size_t pos = findFirstNonFull(hash);
+		if ( growthLeft == 0 && ctrl[pos] == FLAT_EMPTY ) {
+			// Purge tombstones into a table of the same size when they are
+			// most of the load, otherwise double
+			resize(size_ * 2 < maxLoad(capacity_) ? capacity_ : capacity_ * 2);
+			pos = findFirstNonFull(hash);
+		}
+		if ( ctrl[pos] == FLAT_EMPTY ) {
+			growthLeft--;
+		}
+		setCtrl(ctrl, capacity_, pos, h2(hash));
+		size_++;
+		return pos;
+	}
+
+	void eraseAt(size_t pos) {
+		slotAt(pos).~value_type();
+		if ( pos < capacity_ ) {
+			setCtrl(ctrl, capacity_, pos, FLAT_DELETED);
+		}
+		else {
+			setCtrl(oldCtrl, oldCapacity, pos - capacity_, FLAT_DELETED);
+		}
+		size_--;
+	}
+
+	size_t nextFull(size_t pos) const {
+		while ( pos < capacity_ && ctrl[pos] < 0 ) {
+			pos++;
+		}
+		while ( pos >= capacity_ && pos < endIndex() && oldCtrl[pos - capacity_] < 0 ) {
+			pos++;
+		}
+		return pos;
+	}
+
+	void destroyAll() {
+		for ( size_t i = 0; i < endIndex(); i++ ) {
+			if ( (i < capacity_ ? ctrl[i] : oldCtrl[i - capacity_]) >= 0 ) {
+				slotAt(i).~value_type();
+			}
+		}
+	}
+
+	static void release(int8_t *oldCtrl, value_type *oldSlots) {
+		delete[] oldCtrl;
+		::operator delete(oldSlots);
+	}
+
+	/**
+	 * Start moving the entries into new arrays of newCapacity slots. The
+	 * current arrays become the old table, which inserts then empty a few
+	 * slots at a time (see migrate). A resize still in progress is finished
+	 * first.
+	 */
+	void resize(size_t newCapacity) {
+		if ( oldCapacity != 0 ) {
+			migrate(oldCapacity);
+		}
+		oldCtrl = ctrl;
+		oldSlots = slots;
+		oldCapacity = capacity_;
+		migrated = 0;
+		returned = (char *) oldSlots;
+
+		ctrl = new int8_t[newCapacity + FlatGroup::WIDTH];
+		memset(ctrl, FLAT_EMPTY, newCapacity + FlatGroup::WIDTH);
+		slots = static_cast<value_type *>(::operator new(newCapacity * sizeof(value_type)));
+		capacity_ = newCapacity;
+		growthLeft = maxLoad(newCapacity);
+		migrate(0);
+	}
+
+	/**
+	 * Move the entries of the next budget old slots into the new table, and
+	 * free the old table once every slot has been moved. A moved slot is
+	 * marked deleted so that probes of the old table still pass over it.
+	 * The pages of moved slots are handed back as the move goes on: freeing
+	 * a large slot array in one go would stall for as long as a rehash.
+	 */
+	void migrate(size_t budget) {
+		size_t last = std::min(oldCapacity, migrated + budget);
+		for ( ; migrated < last; migrated++ ) {
+			if ( oldCtrl[migrated] < 0 ) {
+				continue;
+			}
+			value_type &old = oldSlots[migrated];
+			size_t hash = hashOf(old.first);
+			size_t pos = findFirstNonFull(hash);
+			if ( ctrl[pos] == FLAT_EMPTY ) {
+				growthLeft--;
+			}
+			setCtrl(ctrl, capacity_, pos, h2(hash));
+			// the old slot is destroyed right after, so moving the key out is safe
+			new (&slots[pos]) value_type(std::move(const_cast<K &>(old.first)), std::move(old.second));
+			old.~value_type();
+			setCtrl(oldCtrl, oldCapacity, migrated, FLAT_DELETED);
+		}
+		if ( migrated == oldCapacity ) {
+			release(oldCtrl, oldSlots);
+			oldCtrl = NULL;
+			oldSlots = NULL;
+			oldCapacity = 0;
+			migrated = 0;
+			returned = NULL;
+		}
+		else if ( (char *) (oldSlots + migrated) - returned >= FLAT_RETURN_BYTES ) {
+			returnPages((char *) (oldSlots + migrated));
+		}
+	}
+
+	/**
+	 * Hand back the whole pages of the old slot array between returned and
+	 * end. Their slots are never read again, so the OS can drop them now and
+	 * freeing the array later only unmaps what is left.
+	 */
+	void returnPages(char *end) {
+		static const uintptr_t pageMask = (uintptr_t) sysconf(_SC_PAGESIZE) - 1;
+		uintptr_t from = ((uintptr_t) returned + pageMask) & ~pageMask;
+		uintptr_t to = (uintptr_t) end & ~pageMask;
+		if ( from < to ) {
+			madvise((void *) from, to - from, MADV_DONTNEED);
+			returned = (char *) to;
+		}
+	}
+};
+
+#endif /* FLATHASHMAP_H_ */
@@ -0,0 +1,102 @@
+/**********************************
+ * FILE NAME: GrowthBench.cpp
+ *
+ * DESCRIPTION: Latency of single writes while a HashTable grows. Every key
+ * 				is written with putIfNewer, as createKeyValue does, and timed
+ * 				on its own; the percentiles are reported per decade of table
+ * 				size, so a stall that grows with the table shows up in the
+ * 				tail of the larger decades.
+ * 				HashTable runs on the backend picked by HASHTABLE at build time.
+ *
+ * RUN PROCEDURE:
+ * $ make bench
+ * $ ./GrowthBench [numKeys]     e.g. ./GrowthBench 100000000
+ **********************************/
+
+#include "stdincludes.h"
+#include "HashTable.h"
+#include <chrono>
+
+/*
+ * Macros
+ */
+#define DEFAULT_KEYS 10000000
+#define FIRST_DECADE 1000
+#define BENCH_KEY_LENGTH 8
+
+static const char alphanum[] =
+"0123456789"
+"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+"abcdefghijklmnopqrstuvwxyz";
+
+/**
+ * FUNCTION NAME: makeKey
+ *
+ * DESCRIPTION: Deterministic, unique key for index i
+ */
+static void makeKey(uint64_t i, string &key) {
+	uint64_t x = i * 0x9E3779B97F4A7C15ULL;
+	key.assign(BENCH_KEY_LENGTH, '0');
+	for ( int c = 0; c < BENCH_KEY_LENGTH; c++ ) {
+		key[c] = alphanum[x % 62];
+		x /= 62;
+	}
+}
+
+/**
+ * FUNCTION NAME: percentile
+ *
+ * DESCRIPTION: The p-th percentile of latencies, which is sorted
+ */
+static double percentile(const vector<float> &latencies, double p) {
+	size_t i = (size_t)(p / 100 * (latencies.size() - 1));
+	return latencies[i];
+}
+
+/**
+ * FUNCTION NAME: report
+ *
+ * DESCRIPTION: Print the percentiles of the writes into [from, to) keys
+ */
+static void report(vector<float> &latencies, uint64_t from, uint64_t to) {
+	sort(latencies.begin(), latencies.end());
+	printf("%10llu %10llu %10.0f %10.0f %10.0f %10.0f %12.0f\n", (unsigned long long)from,
+			(unsigned long long)to, percentile(latencies, 50), percentile(latencies, 99),
+			percentile(latencies, 99.9), percentile(latencies, 99.99), latencies.back());
+	latencies.clear();
+}
+
+/**
+ * Main function
+ */
+int main(int argc, char *argv[]) {
+	uint64_t numKeys = DEFAULT_KEYS;
+	if ( argc > 1 ) {
+		numKeys = strtoull(argv[1], NULL, 10);
+	}
+
+	HashTable table;
+	string key;
+	string value = "value";
+	Entry entry;
+	entry.setVersion(1);
+	vector<float> latencies;
+	printf("%10s %10s %10s %10s %10s %10s %12s   (ns per write)\n", "from", "to", "p50", "p99", "p99.9", "p99.99",
+			"max");
+	uint64_t from = 0;
+	uint64_t to = FIRST_DECADE;
+	for ( uint64_t i = 0; i < numKeys; i++ ) {
+		makeKey(i, key);
+		entry.setValue(value);
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		table.putIfNewer(key, entry);
+		chrono::steady_clock::time_point end = chrono::steady_clock::now();
+		latencies.push_back((float)chrono::duration_cast<chrono::nanoseconds>(end - start).count());
+		if ( i + 1 == to || i + 1 == numKeys ) {
+			report(latencies, from, i + 1);
+			from = i + 1;
+			to *= 10;
+		}
+	}
+	return SUCCESS;
+}
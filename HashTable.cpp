@@ -6,9 +6,49 @@
 
 #include "HashTable.h"
 
-HashTable::HashTable() {}
+HashTable::HashTable(): lsm(NULL), liveKeys(0), blobs(NULL), blobThreshold(VLOG_MIN_BYTES), snapshot(NULL), nextToMove(0), snapshotKeys(0), spill(NULL),
+		memoryBudget(0), hits(0), misses(0), evictions(0), cold(NULL), coldAfter(0), promotions(0), demotions(0), dedup(NULL), dictionary(NULL) {}
 
-HashTable::~HashTable() {}
+/**
+ * Constructor: persistent table in directory. If the store cannot be opened
+ * the table stays in memory.
+ */
+HashTable::HashTable(const string &directory): lsm(new LsmTree(directory)), liveKeys(0), blobs(NULL),
+		blobThreshold(VLOG_MIN_BYTES), snapshot(NULL),
+		nextToMove(0), snapshotKeys(0), spill(NULL), memoryBudget(0), hits(0), misses(0), evictions(0), cold(NULL),
+		coldAfter(0), promotions(0), demotions(0), dedup(NULL), dictionary(NULL) {
+	if ( !lsm->isOpen() ) {
+		fprintf(stderr, "%s: cannot open the store, keeping the table in memory\n", directory.c_str());
+		delete lsm;
+		lsm = NULL;
+		return;
+	}
+	liveKeys = lsm->getLiveKeys();
+	blobs = new ValueLog(directory);
+	if ( !blobs->isOpen() ) {
+		// large values stay in the runs
+		delete blobs;
+		blobs = NULL;
+	}
+}
+
+/**
+ * Destructor: a persistent table writes its memtable out first
+ */
+HashTable::~HashTable() {
+	if ( lsm != NULL ) {
+		if ( !hashTable.empty() ) {
+			flush();
+		}
+		delete lsm;
+	}
+	delete blobs;
+	dropSnapshot();
+	delete spill;
+	delete cold;
+	delete dedup;
+	delete dictionary;
+}
 
 /**
  * FUNCTION NAME: create
@@ -20,7 +60,18 @@ HashTable::~HashTable() {}
  * false in FAILURE
  */
 bool HashTable::create(string key, string value) {
-	hashTable.emplace(key, value);
+	if ( lsm != NULL ) {
+		if ( lookupForWrite(key) == NULL ) {
+			store(key, Entry(value, 0, PRIMARY));
+			liveKeys++;
+		}
+		return true;
+	}
+	claim(key);
+	pair<HashTableMap::iterator, bool> slot = findOrInsert(key);
+	if ( slot.second ) {
+		writeValue(slot.first->second, value);
+	}
 	return true;
 }
 
@@ -34,12 +85,10 @@ bool HashTable::create(string key, string value) {
  * else it returns a NULL
  */
 string HashTable::read(string key) {
-	map<string, string>::iterator search;
-
-	search = hashTable.find(key);
-	if ( search != hashTable.end() ) {
+	const Entry *entry = lookupLive(key);
+	if ( entry != NULL ) {
 		// Value found
-		return search->second;
+		return string(entry->value());
 	}
 	else {
 		// Value not found
@@ -58,17 +107,7 @@ string HashTable::read(string key) {
  * false on FAILURE
  */
 bool HashTable::update(string key, string newValue) {
-	map<string, string>::iterator update;
-
-	if (read(key).empty()) {
-		// Key not found
-		return false;
-	}
-	// Key found
-	//update = hashTable.at(key) = newValue;
-	hashTable.at(key) = newValue;
-	// Update successful
-	return true;
+	return updateIfPresent(key, newValue);
 }
 
 /**
@@ -81,64 +120,1587 @@ bool HashTable::update(string key, string newValue) {
  * false on FAILURE
  */
 bool HashTable::deleteKey(string key) {
-	uint eraseCount = 0;
+	return erase(key);
+}
+
+/**
+ * FUNCTION NAME: findOrInsert
+ *
+ * DESCRIPTION: Find the key, or insert it with an empty value, in a single probe.
+ * 				On insert the key bytes are copied into the arena and indexed.
+ */
+pair<HashTableMap::iterator, bool> HashTable::findOrInsert(string_view key) {
+#if defined(HASHTABLE_FLAT) || defined(HASHTABLE_ART)
+	pair<HashTableMap::iterator, bool> slot = hashTable.lazy_emplace(key, [&]() { return arena.copy(key); });
+#else
+	pair<HashTableMap::iterator, bool> slot;
+	HashTableMap::iterator search = hashTable.lower_bound(key);
+	if ( search != hashTable.end() && search->first == key ) {
+		return make_pair(search, false);
+	}
+	slot = make_pair(hashTable.emplace_hint(search, arena.copy(key), Entry()), true);
+#endif
+#ifdef HASHTABLE_INDEXED
+	if ( slot.second ) {
+		index.insert(slot.first->first);
+	}
+#endif
+	return slot;
+}
+
+/**
+ * FUNCTION NAME: assign
+ *
+ * DESCRIPTION: Overwrite a stored entry, copying the value bytes into the arena
+ */
+void HashTable::assign(Entry &stored, const Entry &entry) {
+	if ( entry.isBlob() ) {
+		stored.setBlob(arena.replace(stored.value(), entry.value()));
+	}
+	else {
+		writeValue(stored, entry.value());
+	}
+	stored.setVersion(entry.getVersion());
+	stored.setReplica(entry.getReplica());
+	stored.setTombstone(entry.isTombstone());
+	stored.setExpiresAt(entry.getExpiresAt());
+}
+
+/**
+ * FUNCTION NAME: writeValue
+ *
+ * DESCRIPTION: Give a stored entry new value bytes, compressed if the table
+ * 				has a trained dictionary and that makes them shorter: a copy
+ * 				in the arena, or the shared copy if the table deduplicates
+ * 				values
+ */
+void HashTable::writeValue(Entry &stored, string_view value) {
+	bool compressed = dictionary != NULL && dictionary->compress(value, packedValue);
+	if ( compressed ) {
+		value = packedValue;
+	}
+	if ( dedup == NULL ) {
+		stored.setValue(arena.replace(stored.value(), value));
+	}
+	else {
+		// acquired first: value may be the shared copy stored already holds
+		string_view shared = dedup->acquire(value);
+		releaseValue(stored);
+		stored.setShared(shared);
+	}
+	stored.setCompressed(compressed);
+}
+
+/**
+ * FUNCTION NAME: releaseValue
+ *
+ * DESCRIPTION: Free the value bytes of an entry leaving the map
+ */
+void HashTable::releaseValue(const Entry &stored) {
+	if ( stored.isShared() ) {
+		dedup->release(stored.value());
+	}
+	else if ( !stored.isSpilled() ) {
+		arena.release(stored.value());
+	}
+}
+
+/**
+ * FUNCTION NAME: lookup
+ *
+ * DESCRIPTION: Live entry of the key in the memtable or, on a persistent
+ * 				table, in the newest sorted run holding it, or in the snapshot
+ * 				if the key has not been moved out of it yet. A cold key is
+ * 				promoted into the memtable.
+ *
+ * RETURNS:
+ * the entry, or NULL if the key is absent or deleted
+ */
+const Entry *HashTable::lookup(string_view key) {
+	HashTableMap::iterator search = hashTable.find(key);
+	if ( search != hashTable.end() ) {
+		return search->second.isTombstone() ? NULL : &search->second;
+	}
+	if ( snapshot != NULL ) {
+		size_t position = snapshot->find(key);
+		string_view stored;
+		if ( position < snapshot->size() && !moved[position] ) {
+			return snapshot->record(position, stored, found) ? &found : NULL;
+		}
+	}
+	if ( cold != NULL ) {
+		return promote(key);
+	}
+	if ( lsm == NULL || !lsm->get(key, found, foundBlock) || found.isTombstone() ) {
+		return NULL;
+	}
+	return &found;
+}
+
+/**
+ * FUNCTION NAME: lookupLive
+ *
+ * DESCRIPTION: lookup, hiding an entry that has expired but is not reclaimed yet.
+ * 				Under a memory budget the value is faulted in if it was spilled,
+ * 				a value in the value log is read back and a compressed one is
+ * 				decoded.
+ */
+const Entry *HashTable::lookupLive(string_view key) {
+	if ( spill != NULL || cold != NULL ) {
+		HashTableMap::iterator search = hashTable.find(key);
+		if ( search != hashTable.end() ) {
+			return search->second.isExpired(wheel.getTime()) ? NULL : resolve(&fetch(search->second));
+		}
+	}
+	const Entry *stored = lookup(key);
+	return stored != NULL && stored->isExpired(wheel.getTime()) ? NULL : resolve(stored);
+}
+
+/**
+ * FUNCTION NAME: lookupForWrite
+ *
+ * DESCRIPTION: lookup on a persistent table before a write, reclaiming the
+ * 				key first if it has expired
+ */
+const Entry *HashTable::lookupForWrite(string_view key) {
+	const Entry *stored = lookup(key);
+	if ( stored == NULL || !stored->isExpired(wheel.getTime()) ) {
+		return stored;
+	}
+	remove(key, *stored, NULL);
+	return NULL;
+}
+
+/**
+ * FUNCTION NAME: resolve
+ *
+ * DESCRIPTION: The entry with its value, read back from the value log if the
+ * 				stored entry is a blob, or decoded if it is compressed. The
+ * 				copy lives until the next resolve.
+ */
+const Entry *HashTable::resolve(const Entry *stored) {
+	if ( stored == NULL || !(stored->isBlob() || stored->isCompressed()) ) {
+		return stored;
+	}
+	if ( stored->isCompressed() ) {
+		dictionary->decompress(stored->value(), blobValue);
+	}
+	else if ( !blobs->read(stored->value(), blobValue) ) {
+		blobValue.clear();
+	}
+	resolved = *stored;
+	resolved.setValue(blobValue);
+	resolved.setCompressed(false);
+	return &resolved;
+}
+
+/**
+ * FUNCTION NAME: releaseBlob
+ *
+ * DESCRIPTION: A write is about to replace stored: if it is a blob, its value
+ * 				becomes garbage of the value log
+ */
+void HashTable::releaseBlob(const Entry *stored) {
+	if ( stored != NULL && stored->isBlob() ) {
+		blobs->release(stored->value());
+	}
+}
+
+/**
+ * FUNCTION NAME: store
+ *
+ * DESCRIPTION: Write an entry (or tombstone) into the memtable of a persistent
+ * 				table, flushing the memtable once it is full
+ */
+void HashTable::store(string_view key, const Entry &entry) {
+	pair<HashTableMap::iterator, bool> slot = findOrInsert(key);
+	assign(slot.first->second, entry);
+	if ( arena.bytesInUse() >= LSM_MEMTABLE_BYTES ) {
+		flush();
+	}
+	else {
+		lsm->maintain();
+	}
+}
+
+/**
+ * FUNCTION NAME: flush
+ *
+ * DESCRIPTION: Write the memtable, tombstones included, out as the newest
+ * 				sorted run and empty it. On an I/O error the memtable is kept
+ * 				and the flush is retried by the next write.
+ *
+ * RETURNS:
+ * true if the memtable was written out
+ */
+bool HashTable::flush() {
+	SortedRunWriter writer;
+	bool written = lsm->beginRun(writer, hashTable.size());
+#ifdef HASHTABLE_INDEXED
+	for ( BPlusTree::Cursor it = index.begin(); written && it.valid(); it.next() ) {
+		written = writeRecord(writer, it.key(), hashTable.find(it.key())->second);
+	}
+#else
+	for ( HashTableMap::iterator it = hashTable.begin(); written && it != hashTable.end(); ++it ) {
+		written = writeRecord(writer, it->first, it->second);
+	}
+#endif
+	// the run may only point at values that are on disk
+	written = written && (blobs == NULL || blobs->sync());
+	if ( !written || !lsm->addRun(writer, liveKeys) ) {
+		return false;
+	}
+	if ( blobs != NULL ) {
+		blobs->flushed();
+	}
+	hashTable.clear();
+#ifdef HASHTABLE_INDEXED
+	index.clear();
+#endif
+	arena.clear();
+	return true;
+}
+
+/**
+ * FUNCTION NAME: writeRecord
+ *
+ * DESCRIPTION: Add a memtable entry to the run being written, appending its
+ * 				value to the value log instead if it is large enough
+ */
+bool HashTable::writeRecord(SortedRunWriter &writer, string_view key, const Entry &entry) {
+	if ( blobs == NULL || entry.isBlob() || entry.isTombstone() || entry.value().size() < blobThreshold ) {
+		return writer.add(key, entry);
+	}
+	Entry separated = entry;
+	blobs->append(key, entry.value(), blobValue);
+	separated.setBlob(blobValue);
+	return writer.add(key, separated);
+}
+
+/**
+ * FUNCTION NAME: checkpoint
+ *
+ * DESCRIPTION: Flush the memtable so that every write made so far is in a
+ * 				synced sorted run; a write-ahead log up to here can then go
+ *
+ * RETURNS:
+ * true if every write is durable
+ * false for an in-memory table or on an I/O error
+ */
+bool HashTable::checkpoint() {
+	if ( lsm == NULL ) {
+		return false;
+	}
+	return hashTable.empty() || flush();
+}
+
+/**
+ * FUNCTION NAME: insertOrAssign
+ *
+ * DESCRIPTION: This function stores the value under the key, replacing any previous value
+ *
+ * RETURNS:
+ * true if the key was inserted
+ * false if an existing value was replaced
+ */
+bool HashTable::insertOrAssign(string_view key, string_view value) {
+	if ( lsm != NULL ) {
+		const Entry *stored = lookupForWrite(key);
+		bool inserted = stored == NULL;
+		releaseBlob(stored);
+		Entry entry = inserted ? Entry() : *stored;
+		entry.setValue(value);
+		liveKeys += inserted;
+		store(key, entry);
+		return inserted;
+	}
+	claim(key);
+	pair<HashTableMap::iterator, bool> slot = findOrInsert(key);
+	writeValue(slot.first->second, value);
+	return slot.second;
+}
 
-	if (read(key).empty()) {
+/**
+ * FUNCTION NAME: updateIfPresent
+ *
+ * DESCRIPTION: This function replaces the value of the key only if the key is found
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false if the key was not found
+ */
+bool HashTable::updateIfPresent(string_view key, string_view newValue) {
+	if ( lsm != NULL ) {
+		const Entry *stored = lookupForWrite(key);
+		if ( stored == NULL ) {
+			return false;
+		}
+		releaseBlob(stored);
+		Entry entry = *stored;
+		entry.setValue(newValue);
+		store(key, entry);
+		return true;
+	}
+	claim(key);
+	HashTableMap::iterator search = hashTable.find(key);
+	if ( search == hashTable.end() ) {
 		// Key not found
 		return false;
 	}
-	eraseCount = hashTable.erase(key);
-	if ( eraseCount < 1 ) {
-		// Could not erase
+	writeValue(search->second, newValue);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: erase
+ *
+ * DESCRIPTION: This function deletes the key. If oldValue is given the erased
+ * 				value is copied out into it before its bytes are freed.
+ * 				A persistent table stores a tombstone unless no sorted run
+ * 				can hold the key, in which case it is dropped outright.
+ * 				An expired key counts as not found.
+ *
+ * RETURNS:
+ * true on SUCCESS
+ * false if the key was not found
+ */
+bool HashTable::erase(string_view key, string *oldValue) {
+	if ( lsm != NULL ) {
+		const Entry *stored = lookupForWrite(key);
+		return stored != NULL && remove(key, *stored, oldValue);
+	}
+	claim(key);
+	return removeFromMemtable(key, oldValue);
+}
+
+/**
+ * FUNCTION NAME: remove
+ *
+ * DESCRIPTION: Delete the live key of a persistent table, stored: a tombstone
+ * 				while a sorted run may hold it, otherwise out of the memtable
+ */
+bool HashTable::remove(string_view key, const Entry &stored, string *oldValue) {
+	liveKeys--;
+	if ( oldValue != NULL ) {
+		oldValue->assign(resolve(&stored)->value());
+	}
+	releaseBlob(&stored);
+	if ( !lsm->mayContain(key) ) {
+		return removeFromMemtable(key, NULL);
+	}
+	Entry tombstone;
+	tombstone.setVersion(stored.getVersion());
+	tombstone.setReplica(stored.getReplica());
+	tombstone.setTombstone(true);
+	store(key, tombstone);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: removeFromMemtable
+ *
+ * DESCRIPTION: Drop the key from the map and free its bytes
+ */
+bool HashTable::removeFromMemtable(string_view key, string *oldValue) {
+	HashTableMap::iterator search = hashTable.find(key);
+	if ( search == hashTable.end() ) {
+		// Key not found
 		return false;
 	}
-	// Delete was successful
+	string_view storedKey = search->first;
+	Entry stored = search->second;
+	if ( stored.isSpilled() ) {
+		if ( oldValue != NULL ) {
+			spill->read(stored.getSpillOffset(), stored.value().size(), *oldValue);
+		}
+		spill->release(stored.value().size());
+	}
+	else if ( oldValue != NULL ) {
+		oldValue->assign(stored.value());
+	}
+	if ( oldValue != NULL && stored.isCompressed() ) {
+		packedValue.swap(*oldValue);
+		dictionary->decompress(packedValue, *oldValue);
+	}
+	hashTable.erase(search);
+#ifdef HASHTABLE_INDEXED
+	index.erase(storedKey);
+#endif
+	arena.release(storedKey);
+	releaseValue(stored);
+	if ( arena.shouldCompact() ) {
+		compact();
+	}
 	return true;
 }
 
 /**
- * FUNCTION NAME: isEmpty
+ * FUNCTION NAME: compareAndSet
  *
- * DESCRIPTION: Returns if the hash table is empty
+ * DESCRIPTION: This function replaces the value of the key with desired only if
+ * 				the key is found and its current value equals expected
  *
  * RETURNS:
- * true if hash table is empty
+ * true if the value was replaced
  * false otherwise
  */
-bool HashTable::isEmpty() {
-	return hashTable.empty();
+bool HashTable::compareAndSet(string_view key, string_view expected, string_view desired) {
+	if ( lsm != NULL ) {
+		const Entry *stored = lookupForWrite(key);
+		if ( stored == NULL || resolve(stored)->value() != expected ) {
+			return false;
+		}
+		releaseBlob(stored);
+		Entry entry = *stored;
+		entry.setValue(desired);
+		store(key, entry);
+		return true;
+	}
+	claim(key);
+	HashTableMap::iterator search = hashTable.find(key);
+	if ( search == hashTable.end() || resolve(&search->second)->value() != expected ) {
+		return false;
+	}
+	writeValue(search->second, desired);
+	return true;
 }
 
 /**
- * FUNCTION NAME: currentSize
+ * FUNCTION NAME: putIfNewer
  *
- * DESCRIPTION: Returns the current size of the hash table
+ * DESCRIPTION: This function stores the entry under the key unless the stored
+ * 				entry has a higher version (last writer wins)
  *
  * RETURNS:
- * size of the table as unit
+ * WRITE_APPLIED if the entry was inserted or replaced the stored one
+ * WRITE_STALE if a newer version is already stored
  */
-unsigned long HashTable::currentSize() {
-	return (unsigned  long)hashTable.size();
+WriteResult HashTable::putIfNewer(string_view key, const Entry &entry) {
+	if ( lsm != NULL ) {
+		const Entry *stored = lookupForWrite(key);
+		if ( stored != NULL && !entry.supersedes(stored->getVersion()) ) {
+			return WRITE_STALE;
+		}
+		releaseBlob(stored);
+		liveKeys += stored == NULL;
+		store(key, entry);
+		track(key, entry);
+		return WRITE_APPLIED;
+	}
+	claim(key);
+	pair<HashTableMap::iterator, bool> slot = findOrInsert(key);
+	if ( !slot.second && !entry.supersedes(slot.first->second.getVersion()) ) {
+		return WRITE_STALE;
+	}
+	assign(slot.first->second, entry);
+	track(key, entry);
+	return WRITE_APPLIED;
 }
 
 /**
- * FUNCTION NAME: clear
+ * FUNCTION NAME: updateIfNewer
  *
- * DESCRIPTION: Clear all contents from the hash table
+ * DESCRIPTION: Like putIfNewer, but only for a key that is already stored
+ *
+ * RETURNS:
+ * WRITE_APPLIED, WRITE_STALE or WRITE_NOT_FOUND
  */
-void HashTable::clear() {
-	hashTable.clear();
+WriteResult HashTable::updateIfNewer(string_view key, const Entry &entry) {
+	if ( lsm != NULL ) {
+		const Entry *stored = lookupForWrite(key);
+		if ( stored == NULL ) {
+			return WRITE_NOT_FOUND;
+		}
+		if ( !entry.supersedes(stored->getVersion()) ) {
+			return WRITE_STALE;
+		}
+		releaseBlob(stored);
+		store(key, entry);
+		track(key, entry);
+		return WRITE_APPLIED;
+	}
+	claim(key);
+	HashTableMap::iterator search = hashTable.find(key);
+	if ( search == hashTable.end() ) {
+		return WRITE_NOT_FOUND;
+	}
+	if ( !entry.supersedes(search->second.getVersion()) ) {
+		return WRITE_STALE;
+	}
+	assign(search->second, entry);
+	track(key, entry);
+	return WRITE_APPLIED;
 }
 
 /**
- * FUNCTION NAME: count
+ * FUNCTION NAME: find
  *
- * DESCRIPTION: Returns the count of the number of values for the passed in key
+ * DESCRIPTION: Returns the stored entry of the key, or NULL if not found.
+ * 				The entry stays valid until the key is next written or erased
+ * 				(or, if it was read back from a sorted run or the snapshot or
+ * 				decompressed, until the next lookup or rehydration step).
+ */
+const Entry *HashTable::find(string_view key) {
+	return lookupLive(key);
+}
+
+/**
+ * FUNCTION NAME: prefetch
+ *
+ * DESCRIPTION: Start loading the buckets of keys[first, last) into the cache:
+ * 				first the control bytes of every key, then the slot each
+ * 				key's control bytes point at. The hashes are left in hashes.
+ * 				The ordered backends have no bucket to load and skip this.
+ */
+void HashTable::prefetch(const vector<string_view> &keys, size_t first, size_t last, size_t *hashes) {
+#ifdef HASHTABLE_FLAT
+	for ( size_t i = first; i < last; i++ ) {
+		hashes[i - first] = hashTable.prefetch(keys[i]);
+	}
+	for ( size_t i = first; i < last; i++ ) {
+		hashTable.prefetchSlot(hashes[i - first]);
+	}
+#endif
+}
+
+/**
+ * FUNCTION NAME: lookupHashed
+ *
+ * DESCRIPTION: lookupLive of a key hashed by prefetch. A plain in-memory flat
+ * 				table probes with the hash; anything else takes lookupLive.
+ */
+const Entry *HashTable::lookupHashed(string_view key, size_t hash) {
+#ifdef HASHTABLE_FLAT
+	if ( lsm == NULL && snapshot == NULL && spill == NULL && cold == NULL ) {
+		HashTableMap::iterator search = hashTable.find(key, hash);
+		if ( search == hashTable.end() || search->second.isTombstone()
+				|| search->second.isExpired(wheel.getTime()) ) {
+			return NULL;
+		}
+		return resolve(&search->second);
+	}
+#endif
+	return lookupLive(key);
+}
+
+/**
+ * FUNCTION NAME: multiGet
+ *
+ * DESCRIPTION: find for every key of a batch: entries[i] is the entry of
+ * 				keys[i], or NULL. The entries stay valid until the next write
+ * 				or multiGet; those read back from a sorted run or the snapshot,
+ * 				or decompressed, are copied, as found (or resolved) would be
+ * 				overwritten by the next key.
+ * 				With a cold tier every entry is copied, as promoting a later
+ * 				key may move the earlier ones (their values stay in the arena).
  *
  * RETURNS:
- * unsigned long count (Should be always 1)
+ * the number of keys found
  */
-unsigned long HashTable::count(string key) {
-	return (unsigned long) hashTable.count(key);
+size_t HashTable::multiGet(const vector<string_view> &keys, vector<const Entry *> &entries) {
+	size_t hashes[HASHTABLE_BATCH_KEYS] = {0};
+	size_t present = 0;
+	entries.resize(keys.size());
+	batchFound.clear();
+	batchValues.clear();
+	if ( lsm != NULL || snapshot != NULL || cold != NULL || dictionary != NULL ) {
+		// reserved up front so that the copies never move
+		batchFound.reserve(keys.size());
+		batchValues.reserve(keys.size());
+	}
+	for ( size_t first = 0; first < keys.size(); first += HASHTABLE_BATCH_KEYS ) {
+		size_t last = min(keys.size(), first + HASHTABLE_BATCH_KEYS);
+		prefetch(keys, first, last, hashes);
+		for ( size_t i = first; i < last; i++ ) {
+			const Entry *stored = lookupHashed(keys[i], hashes[i - first]);
+			if ( stored == &found || stored == &resolved ) {
+				batchValues.push_back(string(stored->value()));
+				batchFound.push_back(*stored);
+				batchFound.back().setValue(batchValues.back());
+				stored = &batchFound.back();
+			}
+			else if ( stored != NULL && cold != NULL ) {
+				batchFound.push_back(*stored);
+				stored = &batchFound.back();
+			}
+			entries[i] = stored;
+			present += stored != NULL;
+		}
+	}
+	return present;
+}
+
+/**
+ * FUNCTION NAME: multiPut
+ *
+ * DESCRIPTION: putIfNewer of entries[i] under keys[i] for every key of a
+ * 				batch, in order; results[i] is the outcome of keys[i]
+ */
+void HashTable::multiPut(const vector<string_view> &keys, const vector<Entry> &entries,
+		vector<WriteResult> &results) {
+	size_t hashes[HASHTABLE_BATCH_KEYS];
+	results.resize(keys.size());
+	for ( size_t first = 0; first < keys.size(); first += HASHTABLE_BATCH_KEYS ) {
+		size_t last = min(keys.size(), first + HASHTABLE_BATCH_KEYS);
+		prefetch(keys, first, last, hashes);
+		for ( size_t i = first; i < last; i++ ) {
+			results[i] = putIfNewer(keys[i], entries[i]);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: multiDelete
+ *
+ * DESCRIPTION: erase every key of a batch, in order
+ *
+ * RETURNS:
+ * the number of keys erased
+ */
+size_t HashTable::multiDelete(const vector<string_view> &keys) {
+	size_t hashes[HASHTABLE_BATCH_KEYS];
+	size_t erased = 0;
+	for ( size_t first = 0; first < keys.size(); first += HASHTABLE_BATCH_KEYS ) {
+		size_t last = min(keys.size(), first + HASHTABLE_BATCH_KEYS);
+		prefetch(keys, first, last, hashes);
+		for ( size_t i = first; i < last; i++ ) {
+			erased += erase(keys[i]);
+		}
+	}
+	return erased;
+}
+
+/**
+ * FUNCTION NAME: seek
+ *
+ * DESCRIPTION: Cursor over the keys in [start, end) in order, in O(log n) plus
+ * 				one probe per key visited. An empty end means no upper bound.
+ * 				A table still rehydrating from a snapshot finishes first, and
+ * 				cold keys are promoted.
+ */
+HashTable::Cursor HashTable::seek(string_view start, string_view end) {
+	rehydrate(SIZE_MAX);
+	promoteAll();
+	return Cursor(this, start, end.empty() ? Cursor::BOUND_NONE : Cursor::BOUND_END, end);
+}
+
+/**
+ * FUNCTION NAME: seekPrefix
+ *
+ * DESCRIPTION: Cursor over the keys starting with prefix, in order
+ */
+HashTable::Cursor HashTable::seekPrefix(string_view prefix) {
+	rehydrate(SIZE_MAX);
+	promoteAll();
+	return Cursor(this, prefix, Cursor::BOUND_PREFIX, prefix);
+}
+
+/**
+ * FUNCTION NAME: scan
+ *
+ * DESCRIPTION: Copy out at most limit (key, value) pairs with keys in [start, end)
+ *
+ * RETURNS:
+ * the pairs in key order
+ */
+vector<pair<string, string> > HashTable::scan(string_view start, string_view end, size_t limit) {
+	vector<pair<string, string> > results;
+	for ( Cursor cursor = seek(start, end); cursor.valid() && results.size() < limit; cursor.next() ) {
+		results.emplace_back(string(cursor.key()), string(cursor.entry().value()));
+	}
+	return results;
+}
+
+/**
+ * FUNCTION NAME: collectKeys
+ *
+ * DESCRIPTION: Append every live key to keys, in no particular order. Unlike
+ * 				seek it leaves the table as it is: the keys still served from
+ * 				a snapshot are read in place from the mapping instead of
+ * 				being moved into the table, and cold keys are read from the
+ * 				cold tier without being promoted.
+ */
+void HashTable::collectKeys(vector<string> &keys) {
+	for ( Cursor cursor(this, string_view(), Cursor::BOUND_NONE, string_view()); cursor.valid(); cursor.next() ) {
+		keys.emplace_back(cursor.key());
+	}
+	if ( cold != NULL ) {
+		cold->collectKeys(keys);
+	}
+	if ( snapshot == NULL ) {
+		return;
+	}
+	string_view key;
+	Entry entry;
+	for ( size_t position = 0; position < snapshot->size(); position++ ) {
+		if ( !moved[position] && snapshot->record(position, key, entry) && !entry.isExpired(wheel.getTime()) ) {
+			keys.emplace_back(key);
+		}
+	}
 }
 
+/**
+ * FUNCTION NAME: isEmpty
+ *
+ * DESCRIPTION: Returns if the hash table is empty
+ *
+ * RETURNS:
+ * true if hash table is empty
+ * false otherwise
+ */
+bool HashTable::isEmpty() {
+	return currentSize() == 0;
+}
+
+/**
+ * FUNCTION NAME: currentSize
+ *
+ * DESCRIPTION: Returns the current size of the hash table
+ *
+ * RETURNS:
+ * size of the table as unit
+ */
+unsigned long HashTable::currentSize() {
+	if ( lsm != NULL ) {
+		return liveKeys;
+	}
+	return (unsigned  long)(hashTable.size() + snapshotKeys + getColdKeys());
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Clear all contents from the hash table, and the sorted runs
+ * 				of a persistent table
+ */
+void HashTable::clear() {
+	dropSnapshot();
+	wheel.clear();
+	hashTable.clear();
+#ifdef HASHTABLE_INDEXED
+	index.clear();
+#endif
+	arena.clear();
+	if ( lsm != NULL ) {
+		lsm->clear();
+		liveKeys = 0;
+	}
+	if ( blobs != NULL ) {
+		blobs->clear();
+	}
+	if ( spill != NULL ) {
+		compactSpill();
+	}
+	if ( cold != NULL ) {
+		cold->clear();
+	}
+	if ( dedup != NULL ) {
+		dedup->clear();
+	}
+}
+
+/**
+ * FUNCTION NAME: count
+ *
+ * DESCRIPTION: Returns the count of the number of values for the passed in key
+ *
+ * RETURNS:
+ * unsigned long count (Should be always 1)
+ */
+unsigned long HashTable::count(string key) {
+	return lookupLive(key) != NULL ? 1 : 0;
+}
+
+/**
+ * FUNCTION NAME: compact
+ *
+ * DESCRIPTION: Copy every live key and resident value into a fresh arena and
+ * 				drop the old one, giving the slabs fragmented by deletes back to
+ * 				the system. Shared values stay where the ValueDedup keeps them.
+ */
+void HashTable::compact() {
+	SlabArena fresh;
+	HashTableMap compacted;
+#ifdef HASHTABLE_INDEXED
+	BPlusTree freshIndex;
+	compacted.reserve(hashTable.size());
+#endif
+	for ( HashTableMap::iterator it = hashTable.begin(); it != hashTable.end(); ++it ) {
+		Entry entry = it->second;
+		string_view key = fresh.copy(it->first);
+		if ( entry.isBlob() ) {
+			entry.setBlob(fresh.copy(entry.value()));
+		}
+		else if ( !entry.isSpilled() && !entry.isShared() ) {
+			entry.setValue(fresh.copy(entry.value()));
+		}
+		compacted.emplace_hint(compacted.end(), key, entry);
+#ifdef HASHTABLE_INDEXED
+		freshIndex.insert(key);
+#endif
+	}
+	hashTable.swap(compacted);
+#ifdef HASHTABLE_INDEXED
+	index.swap(freshIndex);
+#endif
+	arena.swap(fresh);
+}
+
+/**
+ * FUNCTION NAME: getArena
+ *
+ * DESCRIPTION: Returns the arena holding the key and value bytes (for memory statistics)
+ */
+const SlabArena& HashTable::getArena() {
+	return arena;
+}
+
+const LsmTree *HashTable::getLsmTree() {
+	return lsm;
+}
+
+const ValueLog *HashTable::getValueLog() {
+	return blobs;
+}
+
+/**
+ * FUNCTION NAME: setValueLogThreshold
+ *
+ * DESCRIPTION: Values of at least bytes are kept in the value log from the
+ * 				next flush on; values already written out stay where they are
+ *
+ * RETURNS:
+ * false for an in-memory table
+ */
+bool HashTable::setValueLogThreshold(size_t bytes) {
+	if ( blobs == NULL ) {
+		return false;
+	}
+	blobThreshold = bytes;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: collectValueLog
+ *
+ * DESCRIPTION: Take the records of a value log segment the background thread
+ * 				has read (or let it start on the next one). A record is live if
+ * 				the key still points at it: its value is copied to the head of
+ * 				the log and the key is pointed at the copy. The segment goes
+ * 				once those pointers are flushed; if the copies cannot be
+ * 				written it stays, to be collected again.
+ *
+ * RETURNS:
+ * the number of values moved
+ */
+size_t HashTable::collectValueLog() {
+	uint32_t segment;
+	vector<ValueLog::Record> records;
+	if ( blobs == NULL || !blobs->collected(segment, records) ) {
+		return 0;
+	}
+	vector<pair<size_t, Entry> > moves;
+	for ( size_t i = 0; i < records.size(); i++ ) {
+		const Entry *stored = lookup(records[i].key);
+		if ( stored == NULL || !stored->isBlob() || stored->value() != records[i].pointer ) {
+			continue;
+		}
+		moves.emplace_back(i, *stored);
+		blobs->append(records[i].key, records[i].value, records[i].pointer);
+	}
+	if ( !blobs->sync() ) {
+		return 0;
+	}
+	for ( size_t i = 0; i < moves.size(); i++ ) {
+		ValueLog::Record &record = records[moves[i].first];
+		moves[i].second.setBlob(record.pointer);
+		store(record.key, moves[i].second);
+	}
+	blobs->retire(segment, !moves.empty());
+	return moves.size();
+}
+
+/**
+ * FUNCTION NAME: saveSnapshot
+ *
+ * DESCRIPTION: Write every key of an in-memory table, in order, to a snapshot
+ * 				file at path, replacing any previous one
+ *
+ * RETURNS:
+ * true if the snapshot was written
+ */
+bool HashTable::saveSnapshot(const string &path) {
+	if ( lsm != NULL ) {
+		return false;
+	}
+	SnapshotWriter writer;
+	bool written = writer.open(path);
+	for ( Cursor cursor = seek(string_view()); written && cursor.valid(); cursor.next() ) {
+		written = writer.add(cursor.key(), cursor.entry());
+	}
+	return written && writer.finish();
+}
+
+/**
+ * FUNCTION NAME: loadSnapshot
+ *
+ * DESCRIPTION: Start an empty in-memory table from the snapshot at path.
+ * 				Only the header is read: the keys are served from the mapping
+ * 				until rehydrate moves them into the table.
+ *
+ * RETURNS:
+ * false if the table is persistent or not empty, or the file is no snapshot
+ */
+bool HashTable::loadSnapshot(const string &path) {
+	if ( lsm != NULL || snapshot != NULL || currentSize() > 0 ) {
+		return false;
+	}
+	snapshot = new Snapshot();
+	if ( !snapshot->open(path) ) {
+		dropSnapshot();
+		return false;
+	}
+	snapshotKeys = snapshot->size();
+	moved.assign(snapshotKeys, false);
+	if ( snapshotKeys == 0 ) {
+		dropSnapshot();
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: rehydrate
+ *
+ * DESCRIPTION: Move the next budget snapshot positions into the table, in key
+ * 				order, skipping keys a write already moved. The snapshot is
+ * 				unmapped after its last key.
+ *
+ * RETURNS:
+ * the number of keys still served from the snapshot
+ */
+size_t HashTable::rehydrate(size_t budget) {
+	if ( snapshot == NULL ) {
+		return 0;
+	}
+	for ( ; budget > 0 && nextToMove < snapshot->size(); nextToMove++, budget-- ) {
+		if ( !moved[nextToMove] ) {
+			moveFromSnapshot(nextToMove);
+		}
+	}
+	if ( nextToMove == snapshot->size() ) {
+		dropSnapshot();
+	}
+	return snapshotKeys;
+}
+
+/**
+ * FUNCTION NAME: claim
+ *
+ * DESCRIPTION: Before a write to an in-memory table, move the key out of the
+ * 				snapshot if it is still served from there or promote it if it
+ * 				is cold, reclaim it if it has expired, and fault its value in
+ * 				if it was spilled
+ */
+void HashTable::claim(string_view key) {
+	if ( snapshot != NULL ) {
+		size_t position = snapshot->find(key);
+		if ( position < snapshot->size() && !moved[position] ) {
+			moveFromSnapshot(position);
+		}
+	}
+	if ( wheel.size() > 0 || spill != NULL || cold != NULL ) {
+		HashTableMap::iterator search = hashTable.find(key);
+		if ( search == hashTable.end() ) {
+			if ( cold != NULL ) {
+				promote(key);
+			}
+			return;
+		}
+		if ( search->second.isExpired(wheel.getTime()) ) {
+			removeFromMemtable(key, NULL);
+		}
+		else if ( spill != NULL || cold != NULL ) {
+			fetch(search->second);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: track
+ *
+ * DESCRIPTION: Schedule the expiry of an entry just written with a time-to-live
+ */
+void HashTable::track(string_view key, const Entry &entry) {
+	if ( entry.getExpiresAt() != 0 ) {
+		wheel.schedule(key, entry.getExpiresAt());
+	}
+}
+
+/**
+ * FUNCTION NAME: expire
+ *
+ * DESCRIPTION: Move the expiry clock to now and reclaim at most budget of the
+ * 				keys that are due. The rest stay hidden from reads and are
+ * 				reclaimed by later calls (or by the next write to the key).
+ *
+ * RETURNS:
+ * the number of keys reclaimed
+ */
+size_t HashTable::expire(uint32_t now, size_t budget) {
+	wheel.advance(now);
+	size_t reclaimed = 0;
+	TimingWheel::Timer timer;
+	for ( ; budget > 0 && wheel.pop(timer); budget-- ) {
+		const Entry *stored = lookup(timer.key);
+		// stale timer: the key was deleted or rewritten since
+		if ( stored == NULL || stored->getExpiresAt() != timer.expiresAt ) {
+			continue;
+		}
+		if ( lsm != NULL ) {
+			remove(timer.key, *stored, NULL);
+		}
+		else {
+			removeFromMemtable(timer.key, NULL);
+		}
+		reclaimed++;
+	}
+	return reclaimed;
+}
+
+/**
+ * FUNCTION NAME: setMemoryBudget
+ *
+ * DESCRIPTION: Bound the key and value bytes an in-memory table keeps in its
+ * 				arena; evict spills values over the bound to a file in directory
+ *
+ * RETURNS:
+ * false for a persistent table, a table with a cold tier or deduplicated
+ * values, or if the spill file cannot be created
+ */
+bool HashTable::setMemoryBudget(size_t bytes, const string &directory) {
+	if ( lsm != NULL || cold != NULL || dedup != NULL ) {
+		return false;
+	}
+	if ( spill == NULL ) {
+		spill = new SpillFile();
+		spillDirectory = directory;
+		if ( !spill->open(directory) ) {
+			delete spill;
+			spill = NULL;
+			return false;
+		}
+	}
+	memoryBudget = bytes;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: evict
+ *
+ * DESCRIPTION: Sweep the CLOCK hand from where it stopped, clearing the
+ * 				reference bit of recently used values and spilling the others,
+ * 				until enough bytes are spilled to bring the arena within the
+ * 				budget or two full sweeps found nothing more. The spilled values
+ * 				are written with one flush, and only then freed.
+ *
+ * RETURNS:
+ * the number of values spilled
+ */
+size_t HashTable::evict() {
+	if ( spill == NULL || arena.bytesInUse() <= memoryBudget ) {
+		return 0;
+	}
+	size_t excess = arena.bytesInUse() - memoryBudget;
+	size_t freed = 0;
+	vector<pair<Entry *, string_view> > victims;
+	Cursor hand(this, clockHand, Cursor::BOUND_NONE, string_view());
+	for ( size_t steps = 2 * hashTable.size(); freed < excess && steps > 0; steps-- ) {
+		if ( !hand.valid() ) {
+			hand = Cursor(this, string_view(), Cursor::BOUND_NONE, string_view());
+			if ( !hand.valid() ) {
+				break;
+			}
+		}
+		Entry &entry = hashTable.find(hand.key())->second;
+		hand.next();
+		if ( entry.isSpilled() || entry.value().empty() ) {
+			continue;
+		}
+		if ( entry.isReferenced() ) {
+			entry.setReferenced(false);
+			continue;
+		}
+		victims.emplace_back(&entry, entry.value());
+		entry.setSpilled(spill->append(entry.value()));
+		freed += entry.value().size();
+	}
+	clockHand = hand.valid() ? string(hand.key()) : string();
+	if ( !spill->flush() ) {
+		// keep the values in memory
+		for ( size_t i = 0; i < victims.size(); i++ ) {
+			victims[i].first->setValue(victims[i].second);
+		}
+		return 0;
+	}
+	for ( size_t i = 0; i < victims.size(); i++ ) {
+		arena.release(victims[i].second);
+	}
+	evictions += victims.size();
+	if ( arena.shouldCompact() ) {
+		compact();
+	}
+	if ( spill->shouldCompact() ) {
+		compactSpill();
+	}
+	return victims.size();
+}
+
+/**
+ * FUNCTION NAME: fetch
+ *
+ * DESCRIPTION: Access to a stored entry under a memory budget or with a cold
+ * 				tier: set its reference bit and fault its value back in if it
+ * 				was spilled
+ */
+Entry &HashTable::fetch(Entry &stored) {
+	stored.setReferenced(true);
+	if ( !stored.isSpilled() ) {
+		hits++;
+		return stored;
+	}
+	misses++;
+	size_t size = stored.value().size();
+	if ( !spill->read(stored.getSpillOffset(), size, spilledValue) ) {
+		spilledValue.clear();
+	}
+	spill->release(size);
+	stored.setValue(arena.copy(spilledValue));
+	return stored;
+}
+
+/**
+ * FUNCTION NAME: compactSpill
+ *
+ * DESCRIPTION: Copy the values still spilled into a fresh spill file, leaving
+ * 				the dead bytes behind. On an I/O error the old file is kept.
+ */
+void HashTable::compactSpill() {
+	SpillFile fresh;
+	if ( !fresh.open(spillDirectory) ) {
+		return;
+	}
+	vector<pair<Entry *, uint64_t> > moves;
+	string value;
+	for ( HashTableMap::iterator it = hashTable.begin(); it != hashTable.end(); ++it ) {
+		Entry &entry = it->second;
+		if ( !entry.isSpilled() ) {
+			continue;
+		}
+		if ( !spill->read(entry.getSpillOffset(), entry.value().size(), value) ) {
+			return;
+		}
+		moves.emplace_back(&entry, fresh.append(value));
+		if ( fresh.pendingBytes() >= SPILL_FLUSH_BYTES && !fresh.flush() ) {
+			return;
+		}
+	}
+	if ( !fresh.flush() ) {
+		return;
+	}
+	for ( size_t i = 0; i < moves.size(); i++ ) {
+		moves[i].first->setSpilled(moves[i].second);
+	}
+	spill->swap(fresh);
+}
+
+unsigned long HashTable::getHits() {
+	return hits;
+}
+
+unsigned long HashTable::getMisses() {
+	return misses;
+}
+
+unsigned long HashTable::getEvictions() {
+	return evictions;
+}
+
+/**
+ * FUNCTION NAME: setColdTier
+ *
+ * DESCRIPTION: Give an in-memory table a cold tier in directory; demote
+ * 				moves keys to it once they have gone unused for ticks
+ *
+ * RETURNS:
+ * false for a persistent table, a table with a memory budget, or if the
+ * cold file cannot be created
+ */
+bool HashTable::setColdTier(uint32_t ticks, const string &directory) {
+	if ( lsm != NULL || spill != NULL ) {
+		return false;
+	}
+	if ( cold == NULL ) {
+		cold = new ColdStore();
+		if ( !cold->open(directory) ) {
+			delete cold;
+			cold = NULL;
+			return false;
+		}
+	}
+	coldAfter = ticks;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: demote
+ *
+ * DESCRIPTION: Sweep the demotion hand over the next budget keys from where
+ * 				it stopped. A key used since the hand last passed has its
+ * 				reference bit cleared and its idle time restarted; a key idle
+ * 				for coldAfter ticks of the expiry clock is put in the cold
+ * 				tier. The records are written with one flush, and only then
+ * 				are the keys dropped from memory.
+ *
+ * RETURNS:
+ * the number of keys demoted
+ */
+size_t HashTable::demote(size_t budget) {
+	if ( cold == NULL || snapshot != NULL ) {
+		return 0;
+	}
+	uint32_t now = wheel.getTime();
+	vector<string> victims;
+	Cursor hand(this, coldHand, Cursor::BOUND_NONE, string_view());
+	for ( size_t steps = min(budget, hashTable.size()); steps > 0; steps-- ) {
+		if ( !hand.valid() ) {
+			hand = Cursor(this, string_view(), Cursor::BOUND_NONE, string_view());
+			if ( !hand.valid() ) {
+				break;
+			}
+		}
+		Entry &entry = hashTable.find(hand.key())->second;
+		if ( entry.isReferenced() ) {
+			entry.setReferenced(false);
+			entry.setTouchedAt(now);
+		}
+		else if ( now - entry.getTouchedAt() >= coldAfter && entry.getExpiresAt() == 0
+				&& cold->put(hand.key(), *resolve(&entry)) ) {
+			victims.push_back(string(hand.key()));
+		}
+		hand.next();
+	}
+	coldHand = hand.valid() ? string(hand.key()) : string();
+	if ( !cold->flush() ) {
+		return 0;
+	}
+	for ( size_t i = 0; i < victims.size(); i++ ) {
+		removeFromMemtable(victims[i], NULL);
+	}
+	demotions += victims.size();
+	if ( cold->shouldCompact() ) {
+		cold->compact();
+	}
+	return victims.size();
+}
+
+/**
+ * FUNCTION NAME: promote
+ *
+ * DESCRIPTION: Move a cold key back into the map
+ *
+ * RETURNS:
+ * its entry, or NULL if the key is not cold
+ */
+const Entry *HashTable::promote(string_view key) {
+	if ( !cold->get(key, found, foundBlock) ) {
+		return NULL;
+	}
+	pair<HashTableMap::iterator, bool> slot = findOrInsert(key);
+	assign(slot.first->second, found);
+	cold->remove(key);
+	promotions++;
+	misses++;
+	return &slot.first->second;
+}
+
+/**
+ * FUNCTION NAME: promoteAll
+ *
+ * DESCRIPTION: Move every cold key back into the map, for ordered access
+ */
+void HashTable::promoteAll() {
+	if ( cold == NULL ) {
+		return;
+	}
+	string key;
+	while ( cold->takeAny(key, found, foundBlock) ) {
+		pair<HashTableMap::iterator, bool> slot = findOrInsert(key);
+		assign(slot.first->second, found);
+		promotions++;
+	}
+}
+
+size_t HashTable::getColdKeys() {
+	return cold != NULL ? cold->size() : 0;
+}
+
+unsigned long HashTable::getPromotions() {
+	return promotions;
+}
+
+unsigned long HashTable::getDemotions() {
+	return demotions;
+}
+
+/**
+ * FUNCTION NAME: enableDedup
+ *
+ * DESCRIPTION: Keep each distinct value of an in-memory table once. Values
+ * 				already stored are shared as they are next written.
+ *
+ * RETURNS:
+ * false for a persistent table or a table with a memory budget
+ */
+bool HashTable::enableDedup() {
+	if ( lsm != NULL || spill != NULL ) {
+		return false;
+	}
+	if ( dedup == NULL ) {
+		dedup = new ValueDedup();
+	}
+	return true;
+}
+
+const ValueDedup *HashTable::getDedup() {
+	return dedup;
+}
+
+/**
+ * FUNCTION NAME: enableCompression
+ *
+ * DESCRIPTION: Compress the values of an in-memory table with a dictionary,
+ * 				once trainDictionary has trained one. Values already stored are
+ * 				compressed as they are next written.
+ *
+ * RETURNS:
+ * false for a persistent table
+ */
+bool HashTable::enableCompression() {
+	if ( lsm != NULL ) {
+		return false;
+	}
+	if ( dictionary == NULL ) {
+		dictionary = new ValueDictionary();
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: trainDictionary
+ *
+ * DESCRIPTION: Train the dictionary on up to DICT_SAMPLE_BYTES of the values
+ * 				stored, once the table holds minValues of them. Cheap when
+ * 				there is nothing to do, so it can run every tick.
+ *
+ * RETURNS:
+ * true if a dictionary was trained
+ */
+bool HashTable::trainDictionary(size_t minValues) {
+	if ( dictionary == NULL || dictionary->isTrained() || hashTable.size() < minValues ) {
+		return false;
+	}
+	vector<string_view> sample;
+	size_t bytes = 0;
+	for ( HashTableMap::iterator it = hashTable.begin(); it != hashTable.end() && bytes < DICT_SAMPLE_BYTES; ++it ) {
+		const Entry &entry = it->second;
+		// nothing is compressed before the first training
+		if ( entry.isTombstone() || entry.isSpilled() ) {
+			continue;
+		}
+		sample.push_back(entry.value());
+		bytes += entry.value().size();
+	}
+	dictionary->train(sample);
+	return true;
+}
+
+const ValueDictionary *HashTable::getDictionary() {
+	return dictionary;
+}
+
+/**
+ * FUNCTION NAME: moveFromSnapshot
+ *
+ * DESCRIPTION: Copy the snapshot record at position into the table
+ */
+void HashTable::moveFromSnapshot(size_t position) {
+	string_view key;
+	Entry entry;
+	if ( snapshot->record(position, key, entry) ) {
+		pair<HashTableMap::iterator, bool> slot = findOrInsert(key);
+		assign(slot.first->second, entry);
+		track(key, entry);
+	}
+	moved[position] = true;
+	snapshotKeys--;
+}
+
+void HashTable::dropSnapshot() {
+	delete snapshot;
+	snapshot = NULL;
+	vector<bool>().swap(moved);
+	nextToMove = 0;
+	snapshotKeys = 0;
+}
+
+/**
+ * Cursor constructor
+ */
+HashTable::Cursor::Cursor(HashTable *table, string_view start, Bound bound, string_view limit):
+		table(table), fromRuns(false), bound(bound), limit(limit) {
+#ifdef HASHTABLE_INDEXED
+	position = table->index.lowerBound(start);
+#else
+	position = table->hashTable.lower_bound(start);
+#endif
+	if ( table->lsm != NULL ) {
+		runs = table->lsm->lowerBound(start);
+	}
+	if ( table->lsm != NULL || table->wheel.size() > 0 ) {
+		settle();
+	}
+}
+
+bool HashTable::Cursor::inMemtable() const {
+#ifdef HASHTABLE_INDEXED
+	return position.valid();
+#else
+	return position != table->hashTable.end();
+#endif
+}
+
+string_view HashTable::Cursor::memtableKey() const {
+#ifdef HASHTABLE_INDEXED
+	return position.key();
+#else
+	return position->first;
+#endif
+}
+
+void HashTable::Cursor::advanceMemtable() {
+#ifdef HASHTABLE_INDEXED
+	position.next();
+#else
+	++position;
+#endif
+}
+
+/**
+ * FUNCTION NAME: step
+ *
+ * DESCRIPTION: Move the memtable and the runs past the current key
+ */
+void HashTable::Cursor::step() {
+	if ( !runs.valid() ) {
+		advanceMemtable();
+		return;
+	}
+	string current(key());
+	if ( inMemtable() && memtableKey() == current ) {
+		advanceMemtable();
+	}
+	if ( runs.valid() && runs.key() == current ) {
+		runs.next();
+	}
+}
+
+/**
+ * FUNCTION NAME: settle
+ *
+ * DESCRIPTION: Take the smaller of the memtable and run keys (the memtable,
+ * 				being newer, wins a tie) and skip over tombstones and expired
+ * 				entries. Only the metadata is checked: no value is read.
+ */
+void HashTable::Cursor::settle() {
+	while ( true ) {
+		bool memtable = inMemtable();
+		fromRuns = runs.valid() && (!memtable || runs.key() < memtableKey());
+		if ( !(fromRuns || memtable) ) {
+			return;
+		}
+		const Entry &metadata = stored();
+		if ( !metadata.isTombstone() && !metadata.isExpired(table->wheel.getTime()) ) {
+			return;
+		}
+		step();
+	}
+}
+
+/**
+ * FUNCTION NAME: valid
+ *
+ * DESCRIPTION: Returns false once the cursor has left its range
+ */
+bool HashTable::Cursor::valid() const {
+	if ( !fromRuns && !inMemtable() ) {
+		return false;
+	}
+	switch ( bound ) {
+		case BOUND_END:
+			return key() < limit;
+		case BOUND_PREFIX:
+			return key().substr(0, limit.size()) == limit;
+		default:
+			return true;
+	}
+}
+
+string_view HashTable::Cursor::key() const {
+	return fromRuns ? runs.key() : memtableKey();
+}
+
+const Entry &HashTable::Cursor::stored() const {
+	if ( fromRuns ) {
+		current = runs.entry();
+		return current;
+	}
+#ifdef HASHTABLE_INDEXED
+	return table->hashTable.find(position.key())->second;
+#else
+	return position->second;
+#endif
+}
+
+const Entry &HashTable::Cursor::entry() const {
+	const Entry &metadata = stored();
+	if ( !metadata.isSpilled() && !metadata.isBlob() && !metadata.isCompressed() ) {
+		return metadata;
+	}
+	current = metadata;
+	if ( current.isSpilled() ) {
+		// read the spilled value aside: a scan does not fault it in
+		table->spill->read(current.getSpillOffset(), current.value().size(), spilledValue);
+		current.setValue(spilledValue);
+	}
+	else if ( current.isBlob() ) {
+		if ( !table->blobs->read(current.value(), spilledValue) ) {
+			spilledValue.clear();
+		}
+		current.setValue(spilledValue);
+	}
+	if ( current.isCompressed() ) {
+		table->dictionary->decompress(current.value(), decodedValue);
+		current.setValue(decodedValue);
+		current.setCompressed(false);
+	}
+	return current;
+}
+
+void HashTable::Cursor::next() {
+	if ( table->lsm == NULL && table->wheel.size() == 0 ) {
+		advanceMemtable();
+		return;
+	}
+	step();
+	settle();
+}
@@ -13,27 +13,261 @@
 #include "stdincludes.h"
 #include "common.h"
 #include "Entry.h"
+#include "SlabArena.h"
+#include "LsmTree.h"
+#include "Snapshot.h"
+#include "TimingWheel.h"
+#include "SpillFile.h"
+#include "ColdStore.h"
+#include "ValueLog.h"
+#include "ValueDedup.h"
+#include "ValueDictionary.h"
+#ifdef HASHTABLE_FLAT
+#include "FlatHashMap.h"
+#include "BPlusTree.h"
+#include "InlineKey.h"
+#endif
+#ifdef HASHTABLE_ART
+#include "AdaptiveRadixTree.h"
+#endif
+
+/*
+ * Macros
+ */
+// keys a batched operation prefetches before it resolves them
+#define HASHTABLE_BATCH_KEYS 64
+
+/*
+ * Storage backend, selected at build time (see HASHTABLE in the Makefile).
+ * Keys and entry values are views of bytes owned by the table's SlabArena.
+ * The map and ART backends are ordered; the flat backend keeps its keys in a
+ * separate BPlusTree for ordered access (HASHTABLE_INDEXED). Its slots hold
+ * InlineKeys, so probing a short key compares words in the slot instead of
+ * following the view into the arena.
+ */
+#if defined(HASHTABLE_FLAT)
+typedef FlatHashMap<InlineKey<KEY_INLINE_BYTES>, Entry, InlineKeyHash<KEY_INLINE_BYTES>, equal_to<> > HashTableMap;
+#define HASHTABLE_INDEXED
+#elif defined(HASHTABLE_ART)
+typedef AdaptiveRadixTree<string_view, Entry> HashTableMap;
+#else
+typedef map<string_view, Entry> HashTableMap;
+#endif
+
+// outcome of a versioned write
+enum WriteResult {WRITE_APPLIED, WRITE_STALE, WRITE_NOT_FOUND};
 
 /**
  * CLASS NAME: HashTable
  *
- * DESCRIPTION: This class is a wrapper to the map provided by C++ STL.
- *
+ * DESCRIPTION: This class is a wrapper to the key-value map (see HashTableMap
+ * 				above). Each key maps to a versioned Entry whose bytes live in
+ * 				a SlabArena. Given a directory the table is persistent, the map
+ * 				being the memtable of an LsmTree. An in-memory table can also
+ * 				restart from a Snapshot, and keep its values under a memory
+ * 				budget, in a cold tier, deduplicated or compressed; the README
+ * 				and the header of each of those classes describe them.
  */
 class HashTable {
 public:
-	map<string, string> hashTable;
-//public:
+	/**
+	 * CLASS NAME: Cursor
+	 *
+	 * DESCRIPTION: Walks keys in order within a range or under a prefix.
+	 * 				Any write to the table invalidates it. On a persistent
+	 * 				table it merges the memtable with the sorted runs.
+	 */
+	class Cursor {
+	public:
+		bool valid() const;
+		string_view key() const;
+		const Entry &entry() const;
+		void next();
+	private:
+		friend class HashTable;
+		enum Bound {BOUND_NONE, BOUND_END, BOUND_PREFIX};
+#ifdef HASHTABLE_INDEXED
+		typedef BPlusTree::Cursor Position;
+#else
+		typedef HashTableMap::const_iterator Position;
+#endif
+		HashTable *table;
+		Position position;
+		LsmTree::Iterator runs;
+		// the current key comes from runs rather than the memtable
+		bool fromRuns;
+		mutable Entry current;
+		// value of a spilled entry or a blob read for entry()
+		mutable string spilledValue;
+		// decoded value of a compressed entry
+		mutable string decodedValue;
+		Bound bound;
+		string limit;
+		Cursor(HashTable *table, string_view start, Bound bound, string_view limit);
+		bool inMemtable() const;
+		string_view memtableKey() const;
+		void advanceMemtable();
+		// the entry as stored, its value possibly spilled, a blob or compressed
+		const Entry &stored() const;
+		void step();
+		void settle();
+	};
+
 	HashTable();
+	// persistent table stored in directory, reopening what is already there
+	explicit HashTable(const string &directory);
 	bool create(string key, string value);
 	string read(string key);
 	bool update(string key, string newValue);
 	bool deleteKey(string key);
+	// single probe mutations; value bytes are written straight into the arena
+	bool insertOrAssign(string_view key, string_view value);
+	bool updateIfPresent(string_view key, string_view newValue);
+	bool erase(string_view key, string *oldValue = NULL);
+	bool compareAndSet(string_view key, string_view expected, string_view desired);
+	// versioned writes; the entry's value bytes are copied into the arena
+	WriteResult putIfNewer(string_view key, const Entry &entry);
+	WriteResult updateIfNewer(string_view key, const Entry &entry);
+	const Entry *find(string_view key);
+	// batched point operations: the buckets of a batch of keys are prefetched
+	// before the first key is resolved, so their cache misses overlap
+	size_t multiGet(const vector<string_view> &keys, vector<const Entry *> &entries);
+	void multiPut(const vector<string_view> &keys, const vector<Entry> &entries, vector<WriteResult> &results);
+	size_t multiDelete(const vector<string_view> &keys);
+	// ordered access: keys in [start, end), an empty end meaning no upper bound
+	Cursor seek(string_view start, string_view end = string_view());
+	Cursor seekPrefix(string_view prefix);
+	vector<pair<string, string> > scan(string_view start, string_view end, size_t limit);
+	// copy out every live key in no particular order, leaving a snapshot mapped
+	// and cold keys cold
+	void collectKeys(vector<string> &keys);
 	bool isEmpty();
 	unsigned long currentSize();
 	void clear();
 	unsigned long count(string key);
+	void compact();
+	const SlabArena& getArena();
+	// NULL for an in-memory table
+	const LsmTree *getLsmTree();
+	// make every write so far durable in the sorted runs; false for an in-memory table
+	bool checkpoint();
+	// persistent tables: values of at least bytes go to the value log when written out
+	bool setValueLogThreshold(size_t bytes);
+	// move the live values of a collected value log segment; returns the values moved
+	size_t collectValueLog();
+	// NULL for an in-memory table
+	const ValueLog *getValueLog();
+	// in-memory tables: write the table out as a snapshot, or start an empty table from one
+	bool saveSnapshot(const string &path);
+	bool loadSnapshot(const string &path);
+	// move up to budget snapshot keys into the table; returns the keys still to move
+	size_t rehydrate(size_t budget);
+	// advance the expiry clock to now and reclaim up to budget expired keys
+	size_t expire(uint32_t now, size_t budget);
+	// in-memory tables: bound the arena to bytes, spilling values to a file in directory
+	bool setMemoryBudget(size_t bytes, const string &directory = P_tmpdir);
+	// spill cold values until the arena is within the budget; returns the values spilled
+	size_t evict();
+	// reads and writes of resident values, of spilled or cold ones, and values spilled
+	unsigned long getHits();
+	unsigned long getMisses();
+	unsigned long getEvictions();
+	// in-memory tables: move keys idle for ticks to a cold file in directory
+	bool setColdTier(uint32_t ticks, const string &directory = P_tmpdir);
+	// visit up to budget keys, demoting the idle ones; returns the keys demoted
+	size_t demote(size_t budget);
+	size_t getColdKeys();
+	unsigned long getPromotions();
+	unsigned long getDemotions();
+	// in-memory tables: keep each distinct value once
+	bool enableDedup();
+	// NULL unless values are deduplicated
+	const ValueDedup *getDedup();
+	// in-memory tables: compress values with a dictionary trained on them
+	bool enableCompression();
+	// train the dictionary once the table holds minValues values
+	bool trainDictionary(size_t minValues = DICT_TRAIN_VALUES);
+	// NULL unless values are compressed
+	const ValueDictionary *getDictionary();
 	virtual ~HashTable();
+private:
+	HashTableMap hashTable;
+#ifdef HASHTABLE_INDEXED
+	BPlusTree index;
+#endif
+	SlabArena arena;
+	LsmTree *lsm;
+	// live keys over the memtable and the runs (persistent tables only)
+	unsigned long liveKeys;
+	// large values of a persistent table, NULL for an in-memory one
+	ValueLog *blobs;
+	size_t blobThreshold;
+	// copy of the last blob read back, with its value in blobValue
+	Entry resolved;
+	string blobValue;
+	// last entry read back from a run or the snapshot
+	Entry found;
+	string foundBlock;
+	// entries read back from runs or the snapshot by the last multiGet
+	vector<Entry> batchFound;
+	vector<string> batchValues;
+	// snapshot being rehydrated, NULL once done
+	Snapshot *snapshot;
+	// snapshot positions already moved into the map
+	vector<bool> moved;
+	size_t nextToMove;
+	size_t snapshotKeys;
+	// expiry timers of the entries written with a time-to-live
+	TimingWheel wheel;
+	// NULL unless the table has a memory budget
+	SpillFile *spill;
+	size_t memoryBudget;
+	string spillDirectory;
+	// key the CLOCK hand stops at
+	string clockHand;
+	string spilledValue;
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long evictions;
+	// NULL unless the table has a cold tier
+	ColdStore *cold;
+	uint32_t coldAfter;
+	// key the demotion hand stops at
+	string coldHand;
+	unsigned long promotions;
+	unsigned long demotions;
+	// NULL unless values are deduplicated
+	ValueDedup *dedup;
+	// NULL unless values are compressed
+	ValueDictionary *dictionary;
+	// encoding of the value being written
+	string packedValue;
+	HashTable(const HashTable &anotherTable);
+	HashTable& operator =(const HashTable &anotherTable);
+	pair<HashTableMap::iterator, bool> findOrInsert(string_view key);
+	void assign(Entry &stored, const Entry &entry);
+	void writeValue(Entry &stored, string_view value);
+	void releaseValue(const Entry &stored);
+	const Entry *lookup(string_view key);
+	const Entry *lookupLive(string_view key);
+	const Entry *lookupForWrite(string_view key);
+	const Entry *resolve(const Entry *stored);
+	void releaseBlob(const Entry *stored);
+	void prefetch(const vector<string_view> &keys, size_t first, size_t last, size_t *hashes);
+	const Entry *lookupHashed(string_view key, size_t hash);
+	bool remove(string_view key, const Entry &stored, string *oldValue);
+	bool removeFromMemtable(string_view key, string *oldValue);
+	void store(string_view key, const Entry &entry);
+	void claim(string_view key);
+	void track(string_view key, const Entry &entry);
+	Entry &fetch(Entry &stored);
+	void compactSpill();
+	const Entry *promote(string_view key);
+	void promoteAll();
+	void moveFromSnapshot(size_t position);
+	void dropSnapshot();
+	bool flush();
+	bool writeRecord(SortedRunWriter &writer, string_view key, const Entry &entry);
 };
 
 #endif /* HASHTABLE_H_ */
@@ -0,0 +1,200 @@
+/**********************************
+ * FILE NAME: HashTableBench.cpp
+ *
+ * DESCRIPTION: Microbenchmark of the HashTable storage backends
+ * 				(std::map vs FlatHashMap vs AdaptiveRadixTree) and of HashTable
+ * 				itself, which keeps key and value bytes in a SlabArena.
+ * 				Keys and values have the shape of the Application test data
+ * 				(short alphanumeric keys, "value<n>" values).
+ * 				HashTable runs on the backend picked by HASHTABLE at build time.
+ *
+ * RUN PROCEDURE:
+ * $ make bench
+ * $ ./HashTableBench [numKeys ...]     e.g. ./HashTableBench 1000000 10000000 50000000
+ **********************************/
+
+#include "stdincludes.h"
+#include "FlatHashMap.h"
+#include "AdaptiveRadixTree.h"
+#include "HashTable.h"
+#include <chrono>
+#include <sys/wait.h>
+
+/*
+ * Macros
+ */
+#define DEFAULT_SIZES {1000000, 10000000}
+#define LOOKUPS_PER_RUN 5000000
+#define BENCH_KEY_LENGTH 6
+
+static const char alphanum[] =
+"0123456789"
+"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+"abcdefghijklmnopqrstuvwxyz";
+
+/**
+ * CLASS NAME: HashTableAdapter
+ *
+ * DESCRIPTION: Gives HashTable the map calls used by runBackend
+ */
+class HashTableAdapter {
+public:
+	void emplace(const string &key, const string &value) {
+		table.insertOrAssign(key, value);
+	}
+	size_t count(const string &key) {
+		return table.count(key);
+	}
+	void erase(const string &key) {
+		table.erase(key);
+	}
+private:
+	HashTable table;
+};
+
+/**
+ * FUNCTION NAME: makeKey
+ *
+ * DESCRIPTION: Deterministic, unique key for index i. The index is scrambled
+ * 				first so that consecutive keys do not share prefixes.
+ * 				Keys with miss set are never inserted.
+ */
+static void makeKey(uint64_t i, bool miss, string &key) {
+	uint32_t x = (uint32_t)(i * 2654435761ULL);
+	key.assign(BENCH_KEY_LENGTH, '0');
+	for ( int c = 0; c < BENCH_KEY_LENGTH; c++ ) {
+		key[c] = alphanum[x % 62];
+		x /= 62;
+	}
+	if ( miss ) {
+		key.push_back('#');
+	}
+}
+
+/**
+ * FUNCTION NAME: residentBytes
+ *
+ * DESCRIPTION: Resident set size of this process
+ */
+static long residentBytes() {
+	long pages = 0, resident = 0;
+	FILE *fp = fopen("/proc/self/statm", "r");
+	if ( fp == NULL ) {
+		return 0;
+	}
+	if ( fscanf(fp, "%ld %ld", &pages, &resident) != 2 ) {
+		resident = 0;
+	}
+	fclose(fp);
+	return resident * sysconf(_SC_PAGESIZE);
+}
+
+static double elapsedNs(chrono::steady_clock::time_point start) {
+	return (double)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * FUNCTION NAME: runBackend
+ *
+ * DESCRIPTION: Insert n keys, look up hits and misses, then erase every key
+ */
+template <class Map>
+static void runBackend(const char *name, uint64_t n) {
+	Map table;
+	string key;
+	string value;
+	uint64_t found = 0;
+	uint64_t lookups = LOOKUPS_PER_RUN;
+	long rssBefore = residentBytes();
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for ( uint64_t i = 0; i < n; i++ ) {
+		makeKey(i, false, key);
+		value = "value" + to_string(i % 100);
+		table.emplace(key, value);
+	}
+	double insertNs = elapsedNs(start) / n;
+	long rss = residentBytes() - rssBefore;
+
+	uint64_t r = 88172645463325252ULL;
+	start = chrono::steady_clock::now();
+	for ( uint64_t i = 0; i < lookups; i++ ) {
+		r ^= r << 13; r ^= r >> 7; r ^= r << 17;
+		makeKey(r % n, false, key);
+		found += table.count(key);
+	}
+	double hitNs = elapsedNs(start) / lookups;
+
+	start = chrono::steady_clock::now();
+	for ( uint64_t i = 0; i < lookups; i++ ) {
+		r ^= r << 13; r ^= r >> 7; r ^= r << 17;
+		makeKey(r % n, true, key);
+		found += table.count(key);
+	}
+	double missNs = elapsedNs(start) / lookups;
+
+	start = chrono::steady_clock::now();
+	for ( uint64_t i = 0; i < n; i++ ) {
+		makeKey(i, false, key);
+		table.erase(key);
+	}
+	double eraseNs = elapsedNs(start) / n;
+
+	if ( found != lookups ) {
+		printf("%-10s %10llu  lookup mismatch: found %llu of %llu\n", name, (unsigned long long)n,
+				(unsigned long long)found, (unsigned long long)lookups);
+		return;
+	}
+	printf("%-10s %10llu %10.1f %10.1f %10.1f %10.1f %12.1f\n", name, (unsigned long long)n,
+			insertNs, hitNs, missNs, eraseNs, (double)rss / n);
+}
+
+/**
+ * FUNCTION NAME: runIsolated
+ *
+ * DESCRIPTION: Run one backend in a child process so that its memory
+ * 				footprint is not skewed by allocations of earlier runs
+ */
+template <class Map>
+static void runIsolated(const char *name, uint64_t n) {
+	fflush(stdout);
+	pid_t pid = fork();
+	if ( pid == 0 ) {
+		runBackend<Map>(name, n);
+		fflush(stdout);
+		_exit(0);
+	}
+	int status;
+	waitpid(pid, &status, 0);
+	if ( !WIFEXITED(status) || WEXITSTATUS(status) != 0 ) {
+		printf("%-10s %10llu  run failed (out of memory?)\n", name, (unsigned long long)n);
+	}
+}
+
+/**********************************
+ * FUNCTION NAME: main
+ *
+ * DESCRIPTION: main function. Start from here
+ **********************************/
+int main(int argc, char *argv[]) {
+	vector<uint64_t> sizes = DEFAULT_SIZES;
+	if ( argc > 1 ) {
+		sizes.clear();
+		for ( int i = 1; i < argc; i++ ) {
+			sizes.push_back(strtoull(argv[i], NULL, 10));
+		}
+	}
+
+	printf("%-10s %10s %10s %10s %10s %10s %12s\n", "backend", "keys", "insert", "hit", "miss", "erase", "bytes/key");
+	printf("%-10s %10s %10s %10s %10s %10s %12s\n", "", "", "ns/op", "ns/op", "ns/op", "ns/op", "");
+	for ( size_t i = 0; i < sizes.size(); i++ ) {
+		if ( sizes[i] == 0 ) {
+			continue;
+		}
+		runIsolated< map<string, string> >("map", sizes[i]);
+		runIsolated< FlatHashMap<string, string> >("flat", sizes[i]);
+		runIsolated< AdaptiveRadixTree<string, string> >("art", sizes[i]);
+		runIsolated<HashTableAdapter>("HashTable", sizes[i]);
+	}
+	return SUCCESS;
+}
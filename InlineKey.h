@@ -0,0 +1,254 @@
+/**********************************
+ * FILE NAME: InlineKey.h
+ *
+ * DESCRIPTION: Fixed-width key types with the key bytes kept inline
+ **********************************/
+
+#ifndef INLINEKEY_H_
+#define INLINEKEY_H_
+
+#include "stdincludes.h"
+#include <stdint.h>
+#include <utility>
+
+/*
+ * Macros
+ */
+// key bytes kept inline; Application's keys are KEY_LENGTH (5) bytes
+#define KEY_INLINE_BYTES 16
+
+/**
+ * CLASS NAME: InlineWords
+ *
+ * DESCRIPTION: The first N bytes of a key, zero padded, as N/8 words.
+ * 				Keys of the same length are equal when their words are, and
+ * 				the words hash without touching the key bytes again.
+ */
+template <size_t N>
+struct InlineWords {
+	static_assert(N % 8 == 0 && N > 0, "inline keys are whole words");
+	uint64_t words[N / 8];
+
+	void load(string_view key) {
+		memset(words, 0, N);
+		if ( !key.empty() ) {
+			memcpy(words, key.data(), key.size() < N ? key.size() : N);
+		}
+	}
+	bool operator ==(const InlineWords &other) const {
+		for ( size_t i = 0; i < N / 8; i++ ) {
+			if ( words[i] != other.words[i] ) {
+				return false;
+			}
+		}
+		return true;
+	}
+	const char *bytes() const {
+		return (const char *) words;
+	}
+	// same as std::hash<string_view> for keys longer than N
+	size_t hash(string_view key) const {
+		if ( key.size() > N ) {
+			return std::hash<string_view>()(key);
+		}
+		uint64_t h = key.size() * 0x9E3779B97F4A7C15ULL;
+		for ( size_t i = 0; i < N / 8; i++ ) {
+			h = (h ^ words[i]) * 0xBF58476D1CE4E5B9ULL;
+			h ^= h >> 31;
+		}
+		return (size_t) h;
+	}
+};
+
+/**
+ * CLASS NAME: InlineKey
+ *
+ * DESCRIPTION: Key of the flat HashTable backend. It is a view of key bytes
+ * 				owned elsewhere (the table's arena), with the first N bytes
+ * 				copied inline. A probe compares the length and the inline
+ * 				words, and only looks at the bytes behind the view for a key
+ * 				longer than N, so a lookup of a short key reads its slot and
+ * 				nothing else. The view stays valid when the slot moves.
+ */
+template <size_t N>
+class InlineKey {
+public:
+	InlineKey(): data(""), length(0) {
+		prefix.load(string_view());
+	}
+	InlineKey(string_view key): data(key.data()), length((uint32_t) key.size()) {
+		prefix.load(key);
+	}
+	string_view view() const {
+		return string_view(data, length);
+	}
+	operator string_view() const {
+		return view();
+	}
+	size_t size() const {
+		return length;
+	}
+	size_t hash() const {
+		return prefix.hash(view());
+	}
+	bool operator ==(const InlineKey &other) const {
+		return length == other.length && prefix == other.prefix
+				&& (length <= N || memcmp(data + N, other.data + N, length - N) == 0);
+	}
+	bool operator ==(string_view other) const {
+		if ( length != other.size() ) {
+			return false;
+		}
+		return length <= N ? memcmp(prefix.bytes(), other.data(), length) == 0 : view() == other;
+	}
+	bool operator <(const InlineKey &other) const {
+		return view() < other.view();
+	}
+private:
+	InlineWords<N> prefix;
+	const char *data;
+	uint32_t length;
+};
+
+template <size_t N>
+inline bool operator ==(string_view key, const InlineKey<N> &other) {
+	return other == key;
+}
+
+/**
+ * CLASS NAME: InlineString
+ *
+ * DESCRIPTION: Owning key of up to N bytes stored inline, falling back to a
+ * 				heap copy for longer keys. Used for keys carried by messages.
+ * 				Equality of two short keys is a length and N/8 word compare.
+ */
+template <size_t N>
+class InlineString {
+public:
+	InlineString(): length(0) {
+		inline_.load(string_view());
+	}
+	InlineString(string_view key) {
+		assign(key);
+	}
+	InlineString(const string &key) {
+		assign(key);
+	}
+	InlineString(const char *key) {
+		assign(string_view(key));
+	}
+	InlineString(const InlineString &other) {
+		assign(other.view());
+	}
+	InlineString(InlineString &&other): length(other.length) {
+		inline_ = other.inline_;
+		other.length = 0;
+	}
+	~InlineString() {
+		release();
+	}
+	InlineString &operator =(const InlineString &other) {
+		if ( this != &other ) {
+			release();
+			assign(other.view());
+		}
+		return *this;
+	}
+	InlineString &operator =(InlineString &&other) {
+		if ( this != &other ) {
+			release();
+			length = other.length;
+			inline_ = other.inline_;
+			other.length = 0;
+		}
+		return *this;
+	}
+	InlineString &operator =(string_view key) {
+		release();
+		assign(key);
+		return *this;
+	}
+	InlineString &operator =(const string &key) {
+		return *this = string_view(key);
+	}
+	string_view view() const {
+		return length <= N ? string_view(inline_.bytes(), length) : string_view(heap(), length);
+	}
+	operator string_view() const {
+		return view();
+	}
+	operator string() const {
+		return string(view());
+	}
+	size_t size() const {
+		return length;
+	}
+	bool empty() const {
+		return length == 0;
+	}
+	size_t hash() const {
+		return inline_.hash(view());
+	}
+	bool operator ==(const InlineString &other) const {
+		return length == other.length && (length <= N ? inline_ == other.inline_ : view() == other.view());
+	}
+	bool operator !=(const InlineString &other) const {
+		return !(*this == other);
+	}
+	bool operator <(const InlineString &other) const {
+		return view() < other.view();
+	}
+private:
+	// the inline words, or for a long key the heap pointer in the first word
+	InlineWords<N> inline_;
+	uint32_t length;
+
+	char *heap() const {
+		char *bytes;
+		memcpy(&bytes, inline_.words, sizeof(bytes));
+		return bytes;
+	}
+	void assign(string_view key) {
+		length = (uint32_t) key.size();
+		if ( length <= N ) {
+			inline_.load(key);
+			return;
+		}
+		char *bytes = new char[length];
+		memcpy(bytes, key.data(), length);
+		memcpy(inline_.words, &bytes, sizeof(bytes));
+	}
+	void release() {
+		if ( length > N ) {
+			delete[] heap();
+		}
+		length = 0;
+	}
+};
+
+/**
+ * CLASS NAME: InlineKeyHash
+ *
+ * DESCRIPTION: Hash agreeing across string_view, InlineKey and InlineString,
+ * 				so either can probe a table keyed by the others
+ */
+template <size_t N>
+class InlineKeyHash {
+public:
+	size_t operator ()(string_view key) const {
+		InlineWords<N> prefix;
+		prefix.load(key);
+		return prefix.hash(key);
+	}
+	size_t operator ()(const InlineKey<N> &key) const {
+		return key.hash();
+	}
+	size_t operator ()(const InlineString<N> &key) const {
+		return key.hash();
+	}
+};
+
+// key type of the message layer
+typedef InlineString<KEY_INLINE_BYTES> Key;
+
+#endif /* INLINEKEY_H_ */
@@ -0,0 +1,491 @@
+/**********************************
+ * FILE NAME: LsmTree.cpp
+ *
+ * DESCRIPTION: LsmTree class definition
+ **********************************/
+
+#include "LsmTree.h"
+#include <sys/stat.h>
+#include <dirent.h>
+#include <errno.h>
+
+/**
+ * FUNCTION NAME: makeDirectories
+ *
+ * DESCRIPTION: mkdir -p
+ */
+static bool makeDirectories(const string &path) {
+	for ( size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1) ) {
+		string prefix = path.substr(0, slash);
+		if ( mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST ) {
+			perror(prefix.c_str());
+			return false;
+		}
+		if ( slash == string::npos ) {
+			return true;
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: syncDirectory
+ *
+ * DESCRIPTION: fsync a directory so that a rename in it is durable
+ */
+static bool syncDirectory(const string &path) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if ( fd < 0 ) {
+		return false;
+	}
+	bool synced = fsync(fd) == 0;
+	close(fd);
+	return synced;
+}
+
+/**
+ * Constructor: open the store in directory, creating it if needed, and load
+ * the runs listed in its manifest
+ */
+LsmTree::LsmTree(const string &directory): directory(directory), opened(false), nextRun(1), liveKeys(0),
+		compactions(0), levels(LSM_MAX_LEVELS, (SortedRun *) NULL), compactionDone(false), compacting(false) {
+	if ( !makeDirectories(directory) || !loadManifest() ) {
+		return;
+	}
+	opened = true;
+}
+
+/**
+ * Destructor
+ */
+LsmTree::~LsmTree() {
+	waitForCompaction();
+	for ( size_t i = 0; i < level0.size(); i++ ) {
+		delete level0[i];
+	}
+	for ( size_t i = 0; i < levels.size(); i++ ) {
+		delete levels[i];
+	}
+}
+
+bool LsmTree::isOpen() const {
+	return opened;
+}
+
+string LsmTree::runPath(uint64_t number) const {
+	char name[32];
+	sprintf(name, "/%06llu.run", (unsigned long long) number);
+	return directory + name;
+}
+
+unsigned long long LsmTree::runNumber(const SortedRun *run) const {
+	return strtoull(run->getPath().c_str() + directory.size() + 1, NULL, 10);
+}
+
+uint64_t LsmTree::levelCapacity(int level) {
+	uint64_t capacity = LSM_L1_BYTES;
+	for ( int i = 1; i < level; i++ ) {
+		capacity *= LSM_LEVEL_RATIO;
+	}
+	return capacity;
+}
+
+/**
+ * FUNCTION NAME: loadManifest
+ *
+ * DESCRIPTION: Open the runs listed in the manifest and delete run files it
+ * 				does not list (left behind by a flush or compaction that
+ * 				never completed). A missing manifest means an empty store.
+ *
+ * RETURNS:
+ * false if a listed run cannot be opened
+ */
+bool LsmTree::loadManifest() {
+	FILE *fp = fopen((directory + "/" LSM_MANIFEST).c_str(), "r");
+	vector<string> live;
+	if ( fp != NULL ) {
+		char kind[16];
+		unsigned long long first, second;
+		while ( fscanf(fp, "%15s %llu", kind, &first) == 2 ) {
+			if ( 0 == strcmp(kind, "next") ) {
+				nextRun = first;
+			}
+			else if ( 0 == strcmp(kind, "keys") ) {
+				liveKeys = (unsigned long) first;
+			}
+			else if ( 0 == strcmp(kind, "run") && fscanf(fp, "%llu", &second) == 1 ) {
+				SortedRun *run = new SortedRun();
+				if ( !run->open(runPath(second)) || first > LSM_MAX_LEVELS ) {
+					delete run;
+					fclose(fp);
+					return false;
+				}
+				live.push_back(run->getPath());
+				if ( first == 0 ) {
+					level0.push_back(run);
+				}
+				else {
+					levels[first - 1] = run;
+				}
+			}
+		}
+		fclose(fp);
+	}
+
+	DIR *dir = opendir(directory.c_str());
+	if ( dir != NULL ) {
+		for ( struct dirent *file = readdir(dir); file != NULL; file = readdir(dir) ) {
+			string name = file->d_name;
+			bool isRun = name.size() > 4 && name.compare(name.size() - 4, 4, ".run") == 0;
+			string path = directory + "/" + name;
+			if ( (isRun && find(live.begin(), live.end(), path) == live.end()) || name == LSM_MANIFEST ".tmp" ) {
+				unlink(path.c_str());
+			}
+		}
+		closedir(dir);
+	}
+	return fp != NULL || writeManifest();
+}
+
+/**
+ * FUNCTION NAME: writeManifest
+ *
+ * DESCRIPTION: Replace the manifest with the current run list
+ */
+bool LsmTree::writeManifest() {
+	string path = directory + "/" LSM_MANIFEST;
+	string temporary = path + ".tmp";
+	FILE *fp = fopen(temporary.c_str(), "w");
+	if ( fp == NULL ) {
+		perror(temporary.c_str());
+		return false;
+	}
+	fprintf(fp, "next %llu\nkeys %lu\n", (unsigned long long) nextRun, liveKeys);
+	for ( size_t i = 0; i < level0.size(); i++ ) {
+		fprintf(fp, "run 0 %llu\n", runNumber(level0[i]));
+	}
+	for ( size_t i = 0; i < levels.size(); i++ ) {
+		if ( levels[i] != NULL ) {
+			fprintf(fp, "run %zu %llu\n", i + 1, runNumber(levels[i]));
+		}
+	}
+	bool written = fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+	fclose(fp);
+	if ( !written || rename(temporary.c_str(), path.c_str()) != 0 ) {
+		perror(path.c_str());
+		unlink(temporary.c_str());
+		return false;
+	}
+	syncDirectory(directory);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: get
+ *
+ * DESCRIPTION: Look key up from the newest run to the oldest. On success the
+ * 				entry's value is a view of buffer.
+ *
+ * RETURNS:
+ * true if some run holds a record (possibly a tombstone) for key
+ */
+bool LsmTree::get(string_view key, Entry &entry, string &buffer) const {
+	for ( size_t i = 0; i < level0.size(); i++ ) {
+		if ( level0[i]->get(key, entry, buffer) ) {
+			return true;
+		}
+	}
+	for ( size_t i = 0; i < levels.size(); i++ ) {
+		if ( levels[i] != NULL && levels[i]->get(key, entry, buffer) ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool LsmTree::mayContain(string_view key) const {
+	for ( size_t i = 0; i < level0.size(); i++ ) {
+		if ( level0[i]->mayContain(key) ) {
+			return true;
+		}
+	}
+	for ( size_t i = 0; i < levels.size(); i++ ) {
+		if ( levels[i] != NULL && levels[i]->mayContain(key) ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: lowerBound
+ *
+ * DESCRIPTION: Merged iterator at the first key not less than key
+ */
+LsmTree::Iterator LsmTree::lowerBound(string_view key) const {
+	Iterator it;
+	for ( size_t i = 0; i < level0.size(); i++ ) {
+		it.sources.push_back(level0[i]->lowerBound(key));
+	}
+	for ( size_t i = 0; i < levels.size(); i++ ) {
+		if ( levels[i] != NULL ) {
+			it.sources.push_back(levels[i]->lowerBound(key));
+		}
+	}
+	it.settle();
+	return it;
+}
+
+/**
+ * FUNCTION NAME: beginRun
+ *
+ * DESCRIPTION: Create the file of the next level 0 run
+ */
+bool LsmTree::beginRun(SortedRunWriter &writer, size_t expectedKeys) {
+	return writer.open(runPath(nextRun++), expectedKeys);
+}
+
+/**
+ * FUNCTION NAME: addRun
+ *
+ * DESCRIPTION: Finish a run started by beginRun and publish it as the newest
+ * 				level 0 run
+ *
+ * RETURNS:
+ * true once the run and the new manifest are on disk
+ */
+bool LsmTree::addRun(SortedRunWriter &writer, unsigned long liveKeys) {
+	if ( !writer.finish() ) {
+		return false;
+	}
+	SortedRun *run = new SortedRun();
+	if ( !run->open(writer.getPath()) ) {
+		delete run;
+		unlink(writer.getPath().c_str());
+		return false;
+	}
+	unsigned long previousKeys = this->liveKeys;
+	level0.insert(level0.begin(), run);
+	this->liveKeys = liveKeys;
+	if ( !writeManifest() ) {
+		level0.erase(level0.begin());
+		this->liveKeys = previousKeys;
+		delete run;
+		unlink(writer.getPath().c_str());
+		return false;
+	}
+	maintain();
+	return true;
+}
+
+/**
+ * FUNCTION NAME: maintain
+ *
+ * DESCRIPTION: Install a compaction the background thread has finished and
+ * 				start the next one if a level is over its limit. Cheap when
+ * 				there is nothing to do, so it is called after every write.
+ */
+void LsmTree::maintain() {
+	if ( compacting && compactionDone.load(std::memory_order_acquire) ) {
+		installCompaction();
+	}
+	if ( !compacting ) {
+		startCompaction();
+	}
+}
+
+/**
+ * FUNCTION NAME: startCompaction
+ *
+ * DESCRIPTION: Pick the inputs of the next compaction, if any, and merge them
+ * 				on the background thread
+ */
+void LsmTree::startCompaction() {
+	job = Compaction();
+	if ( level0.size() >= LSM_L0_RUNS ) {
+		job.inputs = level0;
+		if ( levels[0] != NULL ) {
+			job.inputs.push_back(levels[0]);
+		}
+		job.outputLevel = 1;
+	}
+	else {
+		for ( int level = 1; level < LSM_MAX_LEVELS; level++ ) {
+			if ( levels[level - 1] != NULL && levels[level - 1]->fileSize() > levelCapacity(level) ) {
+				job.inputs.push_back(levels[level - 1]);
+				if ( levels[level] != NULL ) {
+					job.inputs.push_back(levels[level]);
+				}
+				job.outputLevel = level + 1;
+				break;
+			}
+		}
+	}
+	if ( job.inputs.empty() ) {
+		return;
+	}
+	// a tombstone can go once nothing older lies below the output
+	job.dropTombstones = true;
+	for ( int level = job.outputLevel + 1; level <= LSM_MAX_LEVELS; level++ ) {
+		if ( levels[level - 1] != NULL ) {
+			job.dropTombstones = false;
+		}
+	}
+	job.outputPath = runPath(nextRun++);
+	job.output = NULL;
+	job.succeeded = false;
+	compacting = true;
+	compactionDone.store(false, std::memory_order_relaxed);
+	compactor = std::thread(runCompaction, &job, &compactionDone);
+}
+
+/**
+ * FUNCTION NAME: runCompaction
+ *
+ * DESCRIPTION: Background thread body: merge the inputs into one run. Only
+ * 				touches job and immutable runs.
+ */
+void LsmTree::runCompaction(Compaction *job, std::atomic<bool> *done) {
+	Iterator it;
+	size_t expectedKeys = 0;
+	for ( size_t i = 0; i < job->inputs.size(); i++ ) {
+		it.sources.push_back(job->inputs[i]->begin());
+		expectedKeys += job->inputs[i]->keyCount();
+	}
+	it.settle();
+
+	SortedRunWriter writer;
+	bool written = writer.open(job->outputPath, expectedKeys);
+	for ( ; written && it.valid(); it.next() ) {
+		Entry entry = it.entry();
+		if ( !(entry.isTombstone() && job->dropTombstones) ) {
+			written = writer.add(it.key(), entry);
+		}
+	}
+	size_t outputKeys = writer.keyCount();
+	written = written && writer.finish();
+	if ( written && outputKeys == 0 ) {
+		// everything was deleted: the output level is left empty
+		unlink(job->outputPath.c_str());
+		job->succeeded = true;
+	}
+	else if ( written ) {
+		job->output = new SortedRun();
+		job->succeeded = job->output->open(job->outputPath);
+		if ( !job->succeeded ) {
+			delete job->output;
+			job->output = NULL;
+			unlink(job->outputPath.c_str());
+		}
+	}
+	done->store(true, std::memory_order_release);
+}
+
+/**
+ * FUNCTION NAME: installCompaction
+ *
+ * DESCRIPTION: Swap the inputs of the finished compaction for its output and
+ * 				delete the input files once the new manifest is on disk
+ */
+void LsmTree::installCompaction() {
+	compactor.join();
+	compacting = false;
+	if ( !job.succeeded ) {
+		return;
+	}
+	for ( size_t i = 0; i < job.inputs.size(); i++ ) {
+		level0.erase(remove(level0.begin(), level0.end(), job.inputs[i]), level0.end());
+		replace(levels.begin(), levels.end(), job.inputs[i], (SortedRun *) NULL);
+	}
+	levels[job.outputLevel - 1] = job.output;
+	// if the manifest cannot be replaced the old one still lists the inputs, so keep their files
+	bool durable = writeManifest();
+	for ( size_t i = 0; i < job.inputs.size(); i++ ) {
+		if ( durable ) {
+			unlink(job.inputs[i]->getPath().c_str());
+		}
+		delete job.inputs[i];
+	}
+	compactions++;
+}
+
+void LsmTree::waitForCompaction() {
+	if ( compacting ) {
+		installCompaction();
+	}
+}
+
+unsigned long LsmTree::getLiveKeys() const {
+	return liveKeys;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Delete every run
+ */
+void LsmTree::clear() {
+	waitForCompaction();
+	for ( size_t i = 0; i < level0.size(); i++ ) {
+		unlink(level0[i]->getPath().c_str());
+		delete level0[i];
+	}
+	level0.clear();
+	for ( size_t i = 0; i < levels.size(); i++ ) {
+		if ( levels[i] != NULL ) {
+			unlink(levels[i]->getPath().c_str());
+			delete levels[i];
+			levels[i] = NULL;
+		}
+	}
+	liveKeys = 0;
+	writeManifest();
+}
+
+size_t LsmTree::runCount() const {
+	return level0.size() + levels.size() - count(levels.begin(), levels.end(), (SortedRun *) NULL);
+}
+
+unsigned long LsmTree::getCompactions() const {
+	return compactions;
+}
+
+/**
+ * FUNCTION NAME: settle
+ *
+ * DESCRIPTION: Point current at the smallest key; on a tie the newest run wins
+ */
+void LsmTree::Iterator::settle() {
+	current = sources.size();
+	for ( size_t i = 0; i < sources.size(); i++ ) {
+		if ( sources[i].valid() && (current == sources.size() || sources[i].key() < sources[current].key()) ) {
+			current = i;
+		}
+	}
+}
+
+bool LsmTree::Iterator::valid() const {
+	return current < sources.size();
+}
+
+string_view LsmTree::Iterator::key() const {
+	return sources[current].key();
+}
+
+Entry LsmTree::Iterator::entry() const {
+	return sources[current].entry();
+}
+
+/**
+ * FUNCTION NAME: next
+ *
+ * DESCRIPTION: Step every run past the current key
+ */
+void LsmTree::Iterator::next() {
+	string key(sources[current].key());
+	for ( size_t i = 0; i < sources.size(); i++ ) {
+		if ( sources[i].valid() && sources[i].key() == key ) {
+			sources[i].next();
+		}
+	}
+	settle();
+}
@@ -0,0 +1,134 @@
+/**********************************
+ * FILE NAME: LsmTree.h
+ *
+ * DESCRIPTION: Header file of the LsmTree class
+ **********************************/
+
+#ifndef LSMTREE_H_
+#define LSMTREE_H_
+
+#include "stdincludes.h"
+#include "SortedRun.h"
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+
+/*
+ * Macros
+ */
+// the memtable is written out as a new sorted run once its arena holds this many bytes
+#ifndef LSM_MEMTABLE_BYTES
+#define LSM_MEMTABLE_BYTES (4 << 20)
+#endif
+// level 0 runs (straight from the memtable, overlapping) that trigger a compaction into level 1
+#define LSM_L0_RUNS 4
+// level 1 capacity; every deeper level holds LSM_LEVEL_RATIO times more
+#ifndef LSM_L1_BYTES
+#define LSM_L1_BYTES (16 << 20)
+#endif
+#define LSM_LEVEL_RATIO 10
+#define LSM_MAX_LEVELS 6
+#define LSM_MANIFEST "MANIFEST"
+
+/**
+ * CLASS NAME: LsmTree
+ *
+ * DESCRIPTION: On-disk part of a log-structured merge store: the sorted runs
+ * 				below a HashTable memtable, kept in one directory.
+ *
+ * 				Level 0 holds the runs flushed from the memtable, newest first;
+ * 				their key ranges overlap. Every deeper level is a single run
+ * 				covering all keys, LSM_LEVEL_RATIO times larger than the one
+ * 				above. A lookup checks level 0 newest first, then each level in
+ * 				turn, and stops at the first record found (tombstones included).
+ *
+ * 				Compaction merges all of level 0 into level 1, or an
+ * 				oversized level into the next one, on a background thread.
+ * 				Runs are immutable, so the thread reads them while the owner
+ * 				keeps serving lookups; the owner installs the result from its
+ * 				own thread (maintain), the only place runs are dropped.
+ * 				Tombstones are dropped once they reach the deepest level.
+ *
+ * 				The MANIFEST file lists the live runs and is replaced
+ * 				atomically (write, sync, rename) on every flush and install.
+ */
+class LsmTree {
+public:
+	/**
+	 * CLASS NAME: Iterator
+	 *
+	 * DESCRIPTION: Merged walk over every run in key order. Each key is
+	 * 				seen once, with the record of the newest run holding it.
+	 * 				Any flush or compaction install invalidates it.
+	 */
+	class Iterator {
+	public:
+		bool valid() const;
+		string_view key() const;
+		Entry entry() const;
+		void next();
+	private:
+		friend class LsmTree;
+		// newest run first
+		vector<SortedRun::Iterator> sources;
+		// index of the source holding the current key, or sources.size() at the end
+		size_t current = 0;
+		void settle();
+	};
+
+	explicit LsmTree(const string &directory);
+	virtual ~LsmTree();
+	bool isOpen() const;
+	// newest record of key in any run, tombstones included
+	bool get(string_view key, Entry &entry, string &buffer) const;
+	// false if no run can hold key
+	bool mayContain(string_view key) const;
+	Iterator lowerBound(string_view key) const;
+	// create the file for the next level 0 run
+	bool beginRun(SortedRunWriter &writer, size_t expectedKeys);
+	// finish the file and publish it as the newest level 0 run; liveKeys is recorded in the manifest
+	bool addRun(SortedRunWriter &writer, unsigned long liveKeys);
+	// install a finished compaction and start the next one if needed
+	void maintain();
+	// live key count as of the last flush
+	unsigned long getLiveKeys() const;
+	void clear();
+	size_t runCount() const;
+	unsigned long getCompactions() const;
+private:
+	struct Compaction {
+		// newest first
+		vector<SortedRun *> inputs;
+		int outputLevel;
+		bool dropTombstones;
+		string outputPath;
+		SortedRun *output;
+		bool succeeded;
+	};
+	string directory;
+	bool opened;
+	uint64_t nextRun;
+	unsigned long liveKeys;
+	unsigned long compactions;
+	// newest first
+	vector<SortedRun *> level0;
+	// levels[i] is level i + 1, NULL while empty
+	vector<SortedRun *> levels;
+	Compaction job;
+	std::thread compactor;
+	std::atomic<bool> compactionDone;
+	bool compacting;
+	LsmTree(const LsmTree &anotherTree);
+	LsmTree& operator =(const LsmTree &anotherTree);
+	string runPath(uint64_t number) const;
+	unsigned long long runNumber(const SortedRun *run) const;
+	bool loadManifest();
+	bool writeManifest();
+	void startCompaction();
+	void installCompaction();
+	void waitForCompaction();
+	static void runCompaction(Compaction *job, std::atomic<bool> *done);
+	static uint64_t levelCapacity(int level);
+};
+
+#endif /* LSMTREE_H_ */
@@ -195,6 +195,7 @@ void MP1Node::checkMessages() {
       size = memberNode->mp1q.front().size;
       memberNode->mp1q.pop();
       recvCallBack((void *)memberNode, (char *)ptr, size);
+      emulNet->ENrelease((char *)ptr);
     }
     return;
 }
@@ -4,6 +4,7 @@
  * DESCRIPTION: MP2Node class definition
  **********************************/
 #include "MP2Node.h"
+#include <sys/stat.h>
 
 /**
  * constructor
@@ -13,14 +14,97 @@ MP2Node::MP2Node(Member *memberNode, Params *par, EmulNet * emulNet, Log * log,
   this->par = par;
   this->emulNet = emulNet;
   this->log = log;
-  ht = new HashTable();
+  wal = NULL;
+  if (par->STORAGE_DIR.empty()) {
+    ht = new HashTable();
+    if (!par->SNAPSHOT_DIR.empty()) {
+      // restart from the last snapshot: served at once, rehydrated tick by tick
+      snapshotPath = par->SNAPSHOT_DIR + "/" + address->getAddress() + ".snap";
+      if (access(snapshotPath.c_str(), F_OK) == 0) {
+        ht->loadSnapshot(snapshotPath);
+      }
+    }
+    if (par->MEMORY_BUDGET > 0) {
+      ht->setMemoryBudget(par->MEMORY_BUDGET);
+    } else if (par->COLD_AFTER > 0) {
+      ht->setColdTier((uint32_t)par->COLD_AFTER);
+    }
+    if (par->DEDUP) {
+      ht->enableDedup();
+    }
+    if (par->COMPRESS) {
+      ht->enableCompression();
+    }
+  } else {
+    // persistent store, one directory per node
+    string directory = par->STORAGE_DIR + "/" + address->getAddress();
+    ht = new HashTable(directory);
+    if (par->VALUE_LOG_MIN > 0) {
+      ht->setValueLogThreshold(par->VALUE_LOG_MIN);
+    }
+    // recovery: redo the writes made since the last checkpoint
+    wal = new WriteAheadLog();
+    if (wal->open(directory + "/" WAL_FILE)) {
+      wal->replay(*ht);
+    } else {
+      delete wal;
+      wal = NULL;
+    }
+  }
   this->memberNode->addr = *address;
+  if (ht->currentSize() > 0) {
+    log->LOG(address, "restarted with %lu keys", ht->currentSize());
+  }
 }
 
 /**
  * Destructor
  */
 MP2Node::~MP2Node() {
+  if (wal != NULL) {
+    // a clean shutdown leaves everything in the sorted runs and an empty log
+    if (ht->checkpoint()) {
+      wal->reset();
+    }
+    delete wal;
+  }
+  if (par->MEMORY_BUDGET > 0) {
+    log->LOG(&memberNode->addr, "memory budget: %lu hits, %lu misses, %lu evictions",
+        ht->getHits(), ht->getMisses(), ht->getEvictions());
+  }
+  if (ht->getValueLog() != NULL) {
+    log->LOG(&memberNode->addr, "value log: %llu bytes, %llu garbage, %lu collections",
+        (unsigned long long)ht->getValueLog()->diskBytes(), (unsigned long long)ht->getValueLog()->garbageBytes(),
+        ht->getValueLog()->getCollections());
+  }
+  if (par->COLD_AFTER > 0 && par->STORAGE_DIR.empty()) {
+    log->LOG(&memberNode->addr, "cold tier: %lu cold keys, %lu promotions, %lu demotions",
+        (unsigned long)ht->getColdKeys(), ht->getPromotions(), ht->getDemotions());
+  }
+  if (ht->getDedup() != NULL) {
+    const ValueDedup *dedup = ht->getDedup();
+    log->LOG(&memberNode->addr, "dedup: %lu values stored once for %lu references, %lu bytes saved",
+        (unsigned long)dedup->uniqueValues(), dedup->references(),
+        (unsigned long)(dedup->bytesReferenced() - min(dedup->bytesReferenced(), dedup->bytesStored())));
+  }
+  if (ht->getDictionary() != NULL) {
+    const ValueDictionary *dictionary = ht->getDictionary();
+    log->LOG(&memberNode->addr, "compression: %lu symbols, %lu values compressed from %llu to %llu bytes",
+        (unsigned long)dictionary->symbols(), dictionary->getCompressions(),
+        (unsigned long long)dictionary->getBytesIn(), (unsigned long long)dictionary->getBytesOut());
+  }
+  if (keyAccesses.total() > 0) {
+    vector<HotKey> hot = getHotKeys(HOT_KEYS_LOGGED);
+    string keys;
+    for (size_t i = 0; i < hot.size(); i++) {
+      keys += " " + hot[i].key + " (" + to_string(hot[i].count) + ")";
+    }
+    log->LOG(&memberNode->addr, "hot keys of %lu accesses:%s", (unsigned long)keyAccesses.total(), keys.c_str());
+  }
+  if (!snapshotPath.empty()) {
+    mkdir(par->SNAPSHOT_DIR.c_str(), 0755);
+    ht->saveSnapshot(snapshotPath);
+  }
   delete ht;
   delete memberNode;
 }
@@ -55,12 +139,16 @@ void MP2Node::updateRing() {
 
   oldRing = ring;
   ring = checkRing(curMemList);
+  change = ring.size() != oldRing.size();
+  for (size_t i = 0; !change && i < ring.size(); i++) {
+    change = !(ring[i].nodeAddress == oldRing[i].nodeAddress);
+  }
   
   /*
    * Step 3: Run the stabilization protocol IF REQUIRED
    */
   // Run stabilization protocol if the hash table size is greater than zero and if there has been a changed in the ring
-  if(ht->hashTable.size() > 0){
+  if(change && ht->currentSize() > 0){
     stabilizationProtocol();
   }
 }
@@ -113,11 +201,13 @@ size_t MP2Node::hashFunction(string key) {
  *        2) Finds the replicas of this key
  *        3) Sends a message to the replica
  */
-void MP2Node::clientCreate(string key, string value) {
+void MP2Node::clientCreate(string key, string value, int ttl) {
   g_transID++;
   
   // Constructs the message
   Mp2Message msg = Mp2Message(g_transID, memberNode->addr, CREATE, key, value);
+  msg.version = nextVersion();
+  msg.expiresAt = expiryOf(ttl);
   
   // Sends a message to the replica
   sendMessage(msg);
@@ -152,11 +242,13 @@ void MP2Node::clientRead(string key){
  *        2) Finds the replicas of this key
  *        3) Sends a message to the replica
  */
-void MP2Node::clientUpdate(string key, string value){
+void MP2Node::clientUpdate(string key, string value, int ttl){
   g_transID++;
   
   // Constructs the message
   Mp2Message msg = Mp2Message(g_transID, memberNode->addr, UPDATE, key, value);
+  msg.version = nextVersion();
+  msg.expiresAt = expiryOf(ttl);
   
   // Sends a message to the replica
   sendMessage(msg);
@@ -181,16 +273,44 @@ void MP2Node::clientDelete(string key){
   sendMessage(msg);
 }
 
+/**
+ * FUNCTION NAME: nextVersion
+ *
+ * DESCRIPTION: Version stamped on a client write: the current time in the high
+ *        32 bits and the transaction ID in the low 32 bits, so that a later
+ *        write always carries a higher version (last writer wins)
+ */
+uint64_t MP2Node::nextVersion() {
+  return ((uint64_t)par->getcurrtime() << 32) | (uint32_t)g_transID;
+}
+
+/**
+ * FUNCTION NAME: expiryOf
+ *
+ * DESCRIPTION: Tick a value written now with a time-to-live of ttl ticks
+ *        expires at, or 0 if it never does
+ */
+uint32_t MP2Node::expiryOf(int ttl) {
+  return ttl > 0 ? (uint32_t)(par->getcurrtime() + ttl) : 0;
+}
+
 /**
  * FUNCTION NAME: createKeyValue
  *
  * DESCRIPTION: Server side CREATE API
  *          The function does the following:
- *          1) Inserts key value into the local hash table
- *          2) Return true or false based on success or failure
+ *          1) Inserts the versioned entry into the local hash table in one probe,
+ *             unless a newer version of the key is already stored
+ *          2) Logs the write if it took effect
+ *          3) Return true or false based on success or failure
  */
-bool MP2Node::createKeyValue(string key, string value, ReplicaType replica) {
-  return ht->create(key, value);
+bool MP2Node::createKeyValue(string_view key, string_view value, ReplicaType replica, uint64_t version, uint32_t expiresAt) {
+  Entry entry(value, version, replica, expiresAt);
+  // a stale write is still a success: the replica already holds a newer value
+  if (ht->putIfNewer(key, entry) == WRITE_APPLIED && wal != NULL) {
+    wal->appendPut(key, entry);
+  }
+  return true;
 }
 
 /**
@@ -199,10 +319,10 @@ bool MP2Node::createKeyValue(string key, string value, ReplicaType replica) {
  * DESCRIPTION: Server side READ API
  *          This function does the following:
  *          1) Read key from local hash table
- *          2) Return value
+ *          2) Return the stored entry, or NULL if not found
  */
-string MP2Node::readKey(string key) {
-  return ht->read(key);
+const Entry *MP2Node::readKey(string_view key) {
+  return ht->find(key);
 }
 
 /**
@@ -210,11 +330,18 @@ string MP2Node::readKey(string key) {
  *
  * DESCRIPTION: Server side UPDATE API
  *        This function does the following:
- *        1) Update the key to the new value in the local hash table
- *        2) Return true or false based on success or failure
+ *        1) Update the key to the new versioned value in the local hash table,
+ *           unless a newer version is already stored
+ *        2) Logs the write if it took effect
+ *        3) Return true or false based on success or failure
  */
-bool MP2Node::updateKeyValue(string key, string value, ReplicaType replica) {
-  return ht->update(key,value);
+bool MP2Node::updateKeyValue(string_view key, string_view value, ReplicaType replica, uint64_t version, uint32_t expiresAt) {
+  Entry entry(value, version, replica, expiresAt);
+  WriteResult result = ht->updateIfNewer(key, entry);
+  if (result == WRITE_APPLIED && wal != NULL) {
+    wal->appendPut(key, entry);
+  }
+  return result != WRITE_NOT_FOUND;
 }
 
 /**
@@ -223,11 +350,17 @@ bool MP2Node::updateKeyValue(string key, string value, ReplicaType replica) {
  * DESCRIPTION: Server side DELETE API
  *        This function does the following:
  *        1) Delete the key from the local hash table
- *        2) Return true or false based on success or failure
+ *        2) Logs the delete if the key was there
+ *        3) Return true or false based on success or failure
  */
-bool MP2Node::deletekey(string key) {
-  bool success = ht->deleteKey(key);
-  return success;
+bool MP2Node::deletekey(string_view key) {
+  if (!ht->erase(key)) {
+    return false;
+  }
+  if (wal != NULL) {
+    wal->appendDelete(key);
+  }
+  return true;
 }
 
 /**
@@ -235,8 +368,14 @@ bool MP2Node::deletekey(string key) {
  *
  * DESCRIPTION: This function is the message handler of this node.
  *        This function does the following:
- *        1) Pops messages from the queue
- *        2) Handles the messages according to message types
+ *        1) Pops frames from the queue and decodes their messages in place
+ *        2) Handles the messages according to message types, counting an
+ *           access to the key of every request
+ *        3) Commits the writes to the log and sends the replies, batched
+ *           into one frame per destination
+ *        4) Moves the next batch of keys out of a snapshot being rehydrated
+ *        5) Reclaims a bounded batch of expired keys
+ *        6) Spills cold values if the store is over its memory budget
  */
 void MP2Node::checkMessages() {
   /*
@@ -252,127 +391,187 @@ void MP2Node::checkMessages() {
   // dequeue all messages and handle them
   while ( !memberNode->mp2q.empty() ) {
     /*
-     * Pop a message from the queue
+     * Pop a frame from the queue
      */
     data = (char *)memberNode->mp2q.front().elt;
     size = memberNode->mp2q.front().size;
     memberNode->mp2q.pop();
-    string message(data, data + size);
-    Mp2Message msg = Mp2Message(message);
-    bool success = false;
-    // Mp2Message replyMessage = Mp2Message(msg.transID, msg.fromAddr, REPLY, success);
-    Mp2Message replyMessage = Mp2Message(msg);
-    replyMessage.type = REPLY;
-    string keyValue;
-    switch(msg.type){
-      case CREATE:
-        success = createKeyValue(msg.key, msg.value, msg.replica);
-        if(success){
-          log->logCreateSuccess(&memberNode->addr, false, msg.transID, msg.key, msg.value);
-        }else{
-          log->logCreateFail(&memberNode->addr, false, msg.transID, msg.key, msg.value);
-        }
-        replyMessage.key = msg.key;
-        replyMessage.value = msg.value;
-        replyMessage.fromMessageType = CREATE;
-        replyMessage.success = success;
-        sendReplyMessage(replyMessage, CREATE);
-        break;
-      case READ:
-        keyValue = readKey(msg.key);
-        if(keyValue != ""){
-          log->logReadSuccess(&memberNode->addr, false, msg.transID, msg.key, keyValue);
-          success = true;
-        }else{
-          log->logReadFail(&memberNode->addr, false, msg.transID, msg.key);
-        }
-        replyMessage.key = msg.key;
-        replyMessage.value = keyValue;
-        replyMessage.success = success;
-        sendReplyMessage(replyMessage, READ);
-        break;
-      case UPDATE:
-        success = updateKeyValue(msg.key, msg.value, msg.replica);
-        if(success){
-          log->logUpdateSuccess(&memberNode->addr, false, msg.transID, msg.key, msg.value);
-        }else{
-          log->logUpdateFail(&memberNode->addr, false, msg.transID, msg.key, msg.value);
-        }
-        replyMessage.key = msg.key;
-        replyMessage.value = msg.value;
-        replyMessage.success = success;
-        sendReplyMessage(replyMessage, UPDATE);
-        break;
-      case DELETE:
-        success = deletekey(msg.key);
-        if(success){
-          log->logDeleteSuccess(&memberNode->addr, false, msg.transID, msg.key);
-        }else{
-          log->logDeleteFail(&memberNode->addr, false, msg.transID, msg.key);
-        }
-        replyMessage.fromMessageType = DELETE;
-        replyMessage.key = msg.key;
-        replyMessage.success = success;
-        sendReplyMessage(replyMessage, DELETE);
-        break;
-      case REPLY:
-      case READREPLY:
-        quorum[msg.transID].repliesCount++;
-        int successCount = quorum[msg.transID].successCount;
-        int failsCount = quorum[msg.transID].failCount;
-        if(msg.success){
-            successCount++;
-            quorum[msg.transID].successCount = successCount;
-        }else{
-            failsCount++;
-            quorum[msg.transID].failCount = failsCount;
-        }
-        int count = max(successCount,failsCount);
-        if(count < 2 || quorum[msg.transID].quorumReached ==  true)
+    // a frame batches the messages of one sender; the key and value of each are views into data,
+    // a pooled buffer the network handed over and that goes back once the frame is handled
+    const char *next = data;
+    const char *end = data + size;
+    Mp2MessageView msg;
+    while (next < end && msg.decodeRecord(next, end)) {
+      bool success = false;
+      if (msg.type != REPLY && msg.type != READREPLY) {
+        recordAccess(msg.key);
+      }
+      // a reply carries the fields of its type in MP2_SCHEMA: the coordinator knows the key and value
+      Mp2MessageView replyMessage = msg;
+      replyMessage.type = REPLY;
+      replyMessage.key = string_view();
+      replyMessage.value = string_view();
+      const Entry *entry;
+      switch(msg.type){
+        case CREATE:
+          success = createKeyValue(msg.key, msg.value, msg.replica, msg.version, msg.expiresAt);
+          if(success){
+            log->logCreateSuccess(&memberNode->addr, false, msg.transID, string(msg.key), string(msg.value));
+          }else{
+            log->logCreateFail(&memberNode->addr, false, msg.transID, string(msg.key), string(msg.value));
+          }
+          replyMessage.fromMessageType = CREATE;
+          replyMessage.success = success;
+          sendReplyMessage(replyMessage, CREATE);
           break;
-        quorum[msg.transID].quorumReached = true;
-        switch(msg.fromMessageType){
-            case CREATE:
-              if(successCount >= 2){
-                log->logCreateSuccess(&memberNode->addr, true, msg.transID, msg.key, msg.value);
-              }else{
-                log->logCreateFail(&memberNode->addr, true, msg.transID, msg.key, msg.value);
-              }
-              quorum[msg.transID].commited = true;
-              break;
-            case DELETE:
-              if(successCount >= 2){
-                log->logDeleteSuccess(&memberNode->addr, true, msg.transID, msg.key);
-              }else{
-                log->logDeleteFail(&memberNode->addr, true, msg.transID, msg.key);
-              }
-              quorum[msg.transID].commited = true;
-              break;
-            case READ:
-              if(successCount >= 2){
-                log->logReadSuccess(&memberNode->addr, true, msg.transID, msg.key, msg.value);
-              }else{
-                log->logReadFail(&memberNode->addr, true, msg.transID, msg.key);
-              }
-              quorum[msg.transID].commited = true;
-              break;
-            case UPDATE:
-              if(successCount >= 2){
-                log->logUpdateSuccess(&memberNode->addr, true, msg.transID, msg.key, msg.value);
-              }else{
-                log->logUpdateFail(&memberNode->addr, true, msg.transID, msg.key, msg.value);
+        case READ:
+          replyMessage.type = READREPLY;
+          entry = readKey(msg.key);
+          if(entry != NULL && !entry->value().empty()){
+            // sent before the table is used again, so the entry's value can be viewed
+            replyMessage.value = entry->value();
+            replyMessage.version = entry->getVersion();
+            log->logReadSuccess(&memberNode->addr, false, msg.transID, string(msg.key), string(replyMessage.value));
+            success = true;
+          }else{
+            log->logReadFail(&memberNode->addr, false, msg.transID, string(msg.key));
+          }
+          replyMessage.success = success;
+          sendReplyMessage(replyMessage, READ);
+          break;
+        case UPDATE:
+          success = updateKeyValue(msg.key, msg.value, msg.replica, msg.version, msg.expiresAt);
+          if(success){
+            log->logUpdateSuccess(&memberNode->addr, false, msg.transID, string(msg.key), string(msg.value));
+          }else{
+            log->logUpdateFail(&memberNode->addr, false, msg.transID, string(msg.key), string(msg.value));
+          }
+          replyMessage.success = success;
+          sendReplyMessage(replyMessage, UPDATE);
+          break;
+        case DELETE:
+          success = deletekey(msg.key);
+          if(success){
+            log->logDeleteSuccess(&memberNode->addr, false, msg.transID, string(msg.key));
+          }else{
+            log->logDeleteFail(&memberNode->addr, false, msg.transID, string(msg.key));
+          }
+          replyMessage.fromMessageType = DELETE;
+          replyMessage.success = success;
+          sendReplyMessage(replyMessage, DELETE);
+          break;
+        case REPLY:
+        case READREPLY:
+          quorum[msg.transID].repliesCount++;
+          int successCount = quorum[msg.transID].successCount;
+          int failsCount = quorum[msg.transID].failCount;
+          if(msg.success){
+              successCount++;
+              quorum[msg.transID].successCount = successCount;
+              // a read returns the newest version any replica has replied with
+              if(msg.fromMessageType == READ && msg.version >= quorum[msg.transID].version){
+                quorum[msg.transID].version = msg.version;
+                quorum[msg.transID].value = msg.value;
               }
-              quorum[msg.transID].commited = true;
-              break;
-        }
-        break;
+          }else{
+              failsCount++;
+              quorum[msg.transID].failCount = failsCount;
+          }
+          int count = max(successCount,failsCount);
+          if(count < 2 || quorum[msg.transID].quorumReached ==  true)
+            break;
+          quorum[msg.transID].quorumReached = true;
+          switch(msg.fromMessageType){
+              case CREATE:
+                if(successCount >= 2){
+                  log->logCreateSuccess(&memberNode->addr, true, msg.transID, string(quorum[msg.transID].key), quorum[msg.transID].value);
+                }else{
+                  log->logCreateFail(&memberNode->addr, true, msg.transID, string(quorum[msg.transID].key), quorum[msg.transID].value);
+                }
+                quorum[msg.transID].commited = true;
+                break;
+              case DELETE:
+                if(successCount >= 2){
+                  log->logDeleteSuccess(&memberNode->addr, true, msg.transID, string(quorum[msg.transID].key));
+                }else{
+                  log->logDeleteFail(&memberNode->addr, true, msg.transID, string(quorum[msg.transID].key));
+                }
+                quorum[msg.transID].commited = true;
+                break;
+              case READ:
+                if(successCount >= 2){
+                  log->logReadSuccess(&memberNode->addr, true, msg.transID, string(quorum[msg.transID].key), quorum[msg.transID].value);
+                }else{
+                  log->logReadFail(&memberNode->addr, true, msg.transID, string(quorum[msg.transID].key));
+                }
+                quorum[msg.transID].commited = true;
+                break;
+              case UPDATE:
+                if(successCount >= 2){
+                  log->logUpdateSuccess(&memberNode->addr, true, msg.transID, string(quorum[msg.transID].key), quorum[msg.transID].value);
+                }else{
+                  log->logUpdateFail(&memberNode->addr, true, msg.transID, string(quorum[msg.transID].key), quorum[msg.transID].value);
+                }
+                quorum[msg.transID].commited = true;
+                break;
+          }
+          break;
+      }
     }
+    emulNet->ENrelease(data);
   }
   /*
    * This function should also ensure all READ and UPDATE operation
    * get QUORUM replies
    */
+  commitWrites();
+  flushMessages();
   checkFailedNodes();
+  ht->rehydrate(SNAPSHOT_REHYDRATE_KEYS);
+  ht->expire(par->getcurrtime(), EXPIRE_KEYS_PER_TICK);
+  ht->evict();
+  ht->demote(COLD_SWEEP_KEYS);
+  ht->collectValueLog();
+  ht->trainDictionary();
+}
+
+/**
+ * FUNCTION NAME: recordAccess
+ *
+ * DESCRIPTION: Count an access to the key in the sketch and the top-k keys.
+ *        Both take constant time and memory whatever the number of keys.
+ */
+void MP2Node::recordAccess(string_view key) {
+  keyAccesses.add(key);
+  hotKeys.offer(key);
+}
+
+/**
+ * FUNCTION NAME: getHotKeys
+ *
+ * DESCRIPTION: The n most accessed keys, most accessed first. The top-k and
+ *        the sketch can both only overcount, so each key gets the lower of
+ *        its two counts.
+ */
+vector<HotKey> MP2Node::getHotKeys(size_t n) {
+  vector<HotKey> hot = hotKeys.top(n);
+  for (size_t i = 0; i < hot.size(); i++) {
+    uint64_t atLeast = hot[i].count - hot[i].error;
+    hot[i].count = min(hot[i].count, keyAccesses.estimate(hot[i].key));
+    hot[i].error = hot[i].count > atLeast ? hot[i].count - atLeast : 0;
+  }
+  stable_sort(hot.begin(), hot.end(), [](const HotKey &a, const HotKey &b) { return a.count > b.count; });
+  return hot;
+}
+
+/**
+ * FUNCTION NAME: estimateAccesses
+ *
+ * RETURNS:
+ * an upper bound of the accesses to the key this node has served
+ */
+uint64_t MP2Node::estimateAccesses(string_view key) {
+  return keyAccesses.estimate(key);
 }
 
 /**
@@ -479,11 +678,20 @@ void MP2Node::stabilizationProtocol() {
   /*
    * Implement this
    */
+    // findNodes has no replicas for a ring of fewer than 3 nodes, e.g. on the
+    // first update after a restart with keys already in the table
+    if (oldRing.size() < 3 || ring.size() < 3) {
+      return;
+    }
     //iterator on all keys in my hash table
     //move the keys to another nodes where key belongs
-    for (auto e = ht->hashTable.begin(); e != ht->hashTable.end();++e) {
-      string key = e->first;
-      string value = e->second;
+    // the walk reads keys only, so it neither rehydrates a snapshot nor
+    // reads values: an entry is looked up once a replica needs it
+    vector<string> keys;
+    ht->collectKeys(keys);
+    vector<pair<Address, ReplicaType> > targets;
+    for (size_t k = 0; k < keys.size(); k++) {
+      const string &key = keys[k];
       vector<Node> replicas = findNodes(key, oldRing);
       vector<Node> newReplicas = findNodes(key);
       int myPos = -1;
@@ -491,49 +699,65 @@ void MP2Node::stabilizationProtocol() {
         if(replicas[i].nodeAddress == memberNode->addr)
           myPos = i;
       }
+      targets.clear();
       if (myPos != -1) {
         switch (myPos) {
         case 0:
           {
             if (!isNodeAlive(replicas[1].nodeAddress)) {
-              sendReplicationMessage(newReplicas[1].nodeAddress, key, value, SECONDARY);
+              targets.emplace_back(newReplicas[1].nodeAddress, SECONDARY);
             }
             if (!isNodeAlive(replicas[2].nodeAddress)) {
-              sendReplicationMessage(newReplicas[2].nodeAddress, key, value, TERTIARY);
+              targets.emplace_back(newReplicas[2].nodeAddress, TERTIARY);
             }
             break;
           }
         case 1:
           {
             if (!isNodeAlive(replicas[0].nodeAddress)) {
-              sendReplicationMessage(newReplicas[0].nodeAddress, key, value, PRIMARY);
+              targets.emplace_back(newReplicas[0].nodeAddress, PRIMARY);
             }
             if (!isNodeAlive(replicas[2].nodeAddress)) {
-              sendReplicationMessage(newReplicas[2].nodeAddress, key, value, TERTIARY);
+              targets.emplace_back(newReplicas[2].nodeAddress, TERTIARY);
             }
             break;
           }
         case 2:
           {
             if (!isNodeAlive(replicas[0].nodeAddress)) {
-              sendReplicationMessage(newReplicas[0].nodeAddress, key, value, PRIMARY);
+              targets.emplace_back(newReplicas[0].nodeAddress, PRIMARY);
             }
             if (!isNodeAlive(replicas[1].nodeAddress)) {
-              sendReplicationMessage(newReplicas[1].nodeAddress, key, value, SECONDARY);
+              targets.emplace_back(newReplicas[1].nodeAddress, SECONDARY);
             }
             break;
           }
         }
       } else {
-        sendReplicationMessage(newReplicas[0].nodeAddress, key, value, PRIMARY);
-        sendReplicationMessage(newReplicas[1].nodeAddress, key, value, SECONDARY);
-        sendReplicationMessage(newReplicas[2].nodeAddress, key, value, TERTIARY);
-        ht->hashTable.erase(e);
+        targets.emplace_back(newReplicas[0].nodeAddress, PRIMARY);
+        targets.emplace_back(newReplicas[1].nodeAddress, SECONDARY);
+        targets.emplace_back(newReplicas[2].nodeAddress, TERTIARY);
+      }
+      if (targets.empty()) {
+        continue;
+      }
+      const Entry *entry = ht->find(key);
+      if (entry == NULL) {
+        continue;
+      }
+      string value(entry->value());
+      uint64_t version = entry->getVersion();
+      uint32_t expiresAt = entry->getExpiresAt();
+      for (size_t i = 0; i < targets.size(); i++) {
+        sendReplicationMessage(targets[i].first, key, value, targets[i].second, version, expiresAt);
+      }
+      if (myPos == -1) {
+        deletekey(key);
       }
     }
 }
 
-void MP2Node::sendReplicationMessage(Address addr, string key, string value, ReplicaType replica) {
+void MP2Node::sendReplicationMessage(Address addr, string key, string value, ReplicaType replica, uint64_t version, uint32_t expiresAt) {
     g_transID++;
     //Send replication message
     quorum[g_transID].key = key;
@@ -546,12 +770,11 @@ void MP2Node::sendReplicationMessage(Address addr, string key, string value, Rep
     msg.key = key;
     msg.value = value;
     msg.replica = replica;
+    msg.version = version;
+    msg.expiresAt = expiresAt;
     msg.fromAddr = memberNode->addr;
 
-    string msg_content = msg.toString();
-    const char *a = msg_content.c_str();
-    size_t msgsize = sizeof(char) * msg_content.length();
-    emulNet->ENsend(&memberNode->addr, &addr, (char *) a, msgsize);
+    queueMessage(addr, msg.view());
 }
 
 bool MP2Node::isNodeAlive(Address adr)
@@ -600,16 +823,97 @@ void MP2Node::sendMessage(Mp2Message msg){
     quorum[msg.transID].addresses[i] = replicas[i].nodeAddress;
     quorum[msg.transID].got_reply[i] = false;
     msg.replica = (enum ReplicaType)i;
-    string msg_content = msg.toString();
-    const char *a = msg_content.c_str();
-    size_t msgsize = sizeof(char) * msg_content.length();
-    emulNet->ENsend(&memberNode->addr, &replicas[i].nodeAddress, (char *) a, msgsize);
+    queueMessage(replicas[i].nodeAddress, msg.view());
   }
 }
-void MP2Node::sendReplyMessage(Mp2Message reply_msg, MessageType reply_type){
+void MP2Node::sendReplyMessage(Mp2MessageView reply_msg, MessageType reply_type){
   reply_msg.fromMessageType = reply_type;
-  string msg_content = reply_msg.toString();
-  const char *a = msg_content.c_str();
-  size_t msgsize = sizeof(char) * msg_content.length();
-  emulNet->ENsend(&memberNode->addr, &reply_msg.fromAddr, (char *) a, msgsize);
+  if (wal != NULL) {
+    // nothing is acknowledged before the writes it may depend on are durable;
+    // the held copy owns its key and value
+    heldReplies.push_back(Mp2Message(reply_msg));
+    return;
+  }
+  queueMessage(reply_msg.fromAddr, reply_msg);
+}
+
+/**
+ * FUNCTION NAME: commitWrites
+ *
+ * DESCRIPTION: Group commit once per tick: sync every write logged since the
+ *        last call with a single fdatasync, then send the replies held back
+ *        meanwhile. If the log cannot be synced the records and the replies
+ *        are kept for the next tick to retry: the writes are already in the
+ *        table, so they cannot be reported as failed. A large log is
+ *        checkpointed into the sorted runs and emptied.
+ */
+void MP2Node::commitWrites() {
+  if (wal == NULL || !wal->commit()) {
+    return;
+  }
+  vector<Mp2Message> replies;
+  replies.swap(heldReplies);
+  for (size_t i = 0; i < replies.size(); i++) {
+    queueMessage(replies[i].fromAddr, replies[i].view());
+  }
+  if (wal->size() >= WAL_CHECKPOINT_BYTES && ht->checkpoint()) {
+    wal->reset();
+  }
+}
+
+/**
+ * FUNCTION NAME: queueMessage
+ *
+ * DESCRIPTION: Encode the message straight into the pooled buffer of the
+ *        frame batched for its destination. A frame the message does not
+ *        fit in is sent first, and the message starts the next one.
+ */
+void MP2Node::queueMessage(Address &to, const Mp2MessageView &msg) {
+  // EmulNet refuses a payload of MAX_MSG_SIZE - sizeof(en_msg) bytes or more
+  int capacity = par->MAX_MSG_SIZE - (int)sizeof(en_msg) - 1;
+  int size = (int)msg.recordSize();
+  if (size > capacity) {
+    // no frame can carry it
+    return;
+  }
+  Outbox *outbox = NULL;
+  for (size_t i = 0; i < outboxes.size(); i++) {
+    if (outboxes[i].to == to) {
+      outbox = &outboxes[i];
+      break;
+    }
+  }
+  if (outbox == NULL) {
+    outboxes.emplace_back();
+    outbox = &outboxes.back();
+    outbox->to = to;
+  }
+  if (outbox->frame != NULL && outbox->size + size > capacity) {
+    emulNet->ENsendBuffer(&memberNode->addr, &outbox->to, outbox->frame, outbox->size);
+    outbox->frame = NULL;
+  }
+  if (outbox->frame == NULL) {
+    outbox->frame = emulNet->ENalloc(capacity);
+    outbox->size = 0;
+  }
+  msg.encodeRecord(outbox->frame + outbox->size);
+  outbox->size += size;
+}
+
+/**
+ * FUNCTION NAME: flushMessages
+ *
+ * DESCRIPTION: Send each destination the frame batched for it, handing its
+ *        buffer to the network. Called once the node has handled its
+ *        messages, and again once the clients have issued their requests of
+ *        the tick, so no message waits for the next tick. Messages batched
+ *        before a node failed were already on the wire and are still sent.
+ */
+void MP2Node::flushMessages() {
+  for (size_t i = 0; i < outboxes.size(); i++) {
+    if (outboxes[i].frame != NULL) {
+      emulNet->ENsendBuffer(&memberNode->addr, &outboxes[i].to, outboxes[i].frame, outboxes[i].size);
+      outboxes[i].frame = NULL;
+    }
+  }
 }
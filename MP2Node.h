@@ -14,9 +14,12 @@
 #include "EmulNet.h"
 #include "Node.h"
 #include "HashTable.h"
+#include "WriteAheadLog.h"
+#include "CountMinSketch.h"
+#include "SpaceSaving.h"
 #include "Log.h"
 #include "Params.h"
-// #include "Message.h"
+#include "Message.h"
 #include "Queue.h"
 
 /**
@@ -38,8 +41,10 @@ public:
     int failCount = 0;
     bool quorumReached = false;
     MessageType type;
-    string key;
+    Key key;
     string value;
+    // newest version seen in the READ replies
+    uint64_t version = 0;
     bool got_reply[3];
     int repliesCount =0;
     bool commited = false;
@@ -48,6 +53,14 @@ public:
     // Mp2Message reply_messages[3];
 };
 
+// the frame of the messages batched for one destination, a buffer from EmulNet::ENalloc
+class Outbox {
+public:
+    Address to;
+    char *frame = NULL;
+    int size = 0;
+};
+
 class MP2Node {
 private:
 	// Vector holding the next two neighbors in the ring who have my replicas
@@ -59,6 +72,17 @@ private:
   vector<Node> ring;
 	// Hash Table
 	HashTable * ht;
+	// Write-ahead log of the persistent store, NULL without STORAGE_DIR
+	WriteAheadLog * wal;
+	// Replies held back until the writes of this tick are committed to the log
+	vector<Mp2Message> heldReplies;
+	// Messages batched this tick, by destination
+	vector<Outbox> outboxes;
+	// Snapshot of the in-memory store, empty without SNAPSHOT_DIR
+	string snapshotPath;
+	// Approximate access counts of the keys this node has served, and the hottest keys
+	CountMinSketch keyAccesses;
+	SpaceSaving hotKeys;
 	// Member representing this member
 	Member *memberNode;
 	// Params object
@@ -83,19 +107,24 @@ public:
 	void findNeighbors();
 
 	// client side CRUD APIs
-	void clientCreate(string key, string value);
+	// ttl in ticks, 0 for a key that never expires
+	void clientCreate(string key, string value, int ttl = 0);
 	void clientRead(string key);
-	void clientUpdate(string key, string value);
+	void clientUpdate(string key, string value, int ttl = 0);
 	void clientDelete(string key);
 
 	// Send message to replicas
 	void sendMessage(Mp2Message msg);
-	void sendReplyMessage(Mp2Message msg, MessageType reply_type);
+	void sendReplyMessage(Mp2MessageView msg, MessageType reply_type);
+	void commitWrites();
+	// batch a message for to, and send the batches
+	void queueMessage(Address &to, const Mp2MessageView &msg);
+	void flushMessages();
 
   vector<Node> checkRing(vector<Node> membershipList);
   bool isNodeAlive(Address adr);
   void checkFailedNodes();
-  void sendReplicationMessage(Address addr, string key, string value, ReplicaType replica);
+  void sendReplicationMessage(Address addr, string key, string value, ReplicaType replica, uint64_t version, uint32_t expiresAt);
 
 	// receive messages from Emulnet
 	bool recvLoop();
@@ -103,19 +132,23 @@ public:
 
 	// handle messages from receiving queue
 	void checkMessages();
+	void recordAccess(string_view key);
 
-	// coordinator dispatches messages to corresponding nodes
-	void dispatchMessages(Message message);
+	// access statistics: the n hottest keys, and an upper bound of the accesses to a key
+	vector<HotKey> getHotKeys(size_t n);
+	uint64_t estimateAccesses(string_view key);
 
 	// find the addresses of nodes that are responsible for a key
   vector<Node> findNodes(string key, vector<Node> myRing);
   vector<Node> findNodes(string key);
 
 	// server
-	bool createKeyValue(string key, string value, ReplicaType replica);
-	string readKey(string key);
-	bool updateKeyValue(string key, string value, ReplicaType replica);
-	bool deletekey(string key);
+	uint64_t nextVersion();
+	uint32_t expiryOf(int ttl);
+	bool createKeyValue(string_view key, string_view value, ReplicaType replica, uint64_t version, uint32_t expiresAt);
+	const Entry *readKey(string_view key);
+	bool updateKeyValue(string_view key, string_view value, ReplicaType replica, uint64_t version, uint32_t expiresAt);
+	bool deletekey(string_view key);
 
 	// stabilization protocol - handle multiple failures
 	void stabilizationProtocol();
@@ -1,176 +1,322 @@
 /**********************************
  * FILE NAME: Message.cpp
  *
- * DESCRIPTION: Message class definition
+ * DESCRIPTION: Mp2Message codec, generated from MP2_SCHEMA
  **********************************/
 #include "Message.h"
 
+static char *putVarint(char *out, uint64_t value) {
+	while ( value >= 0x80 ) {
+		*out++ = (char) (value | 0x80);
+		value >>= 7;
+	}
+	*out++ = (char) value;
+	return out;
+}
+
+static char *putBytes(char *out, string_view bytes) {
+	out = putVarint(out, bytes.size());
+	memcpy(out, bytes.data(), bytes.size());
+	return out + bytes.size();
+}
+
 /**
- * Constructor
+ * FUNCTION NAME: getVarint
+ *
+ * DESCRIPTION: Read a varint at in, advancing in past it
+ *
+ * RETURNS:
+ * false if the varint runs past end or over MP2_VARINT_BYTES
  */
-// transID::fromAddr::CREATE::key::value::ReplicaType
-// transID::fromAddr::READ::key
-// transID::fromAddr::UPDATE::key::value::ReplicaType
-// transID::fromAddr::DELETE::key
-// transID::fromAddr::REPLY::sucess
-// transID::fromAddr::READREPLY::value
-Message::Message(string message){
-	this->delimiter = "::";
-	vector<string> tuple;
-	size_t pos = message.find(delimiter);
-	size_t start = 0;
-	while (pos != string::npos) {
-		string field = message.substr(start, pos-start);
-		tuple.push_back(field);
-		start = pos + 2;
-		pos = message.find(delimiter, start);
-	}
-	tuple.push_back(message.substr(start));
-
-	transID = stoi(tuple.at(0));
-	Address addr(tuple.at(1));
-	fromAddr = addr;
-	type = static_cast<MessageType>(stoi(tuple.at(2)));
-	switch(type){
-		case CREATE:
-		case UPDATE:
-			key = tuple.at(3);
-			value = tuple.at(4);
-			if (tuple.size() > 5)
-				replica = static_cast<ReplicaType>(stoi(tuple.at(5)));
-			break;
-		case READ:
-		case DELETE:
-			key = tuple.at(3);
-			break;
-		case REPLY:
-			if (tuple.at(3) == "1")
-				success = true;
-			else
-				success = false;
-			break;
-		case READREPLY:
-			value = tuple.at(3);
-			break;
+static bool getVarint(const char *&in, const char *end, uint64_t &value) {
+	value = 0;
+	for ( int shift = 0; in < end && shift < 7 * MP2_VARINT_BYTES; shift += 7 ) {
+		uint8_t byte = (uint8_t) *in++;
+		value |= (uint64_t) (byte & 0x7f) << shift;
+		if ( byte < 0x80 ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static size_t varintSize(uint64_t value) {
+	size_t size = 1;
+	while ( value >= 0x80 ) {
+		value >>= 7;
+		size++;
+	}
+	return size;
+}
+
+static bool getBytes(const char *&in, const char *end, string_view &bytes) {
+	uint64_t size;
+	if ( !getVarint(in, end, size) || size > (uint64_t) (end - in) ) {
+		return false;
 	}
+	bytes = string_view(in, size);
+	in += size;
+	return true;
+}
+
+static bool getByte(const char *&in, const char *end, uint8_t &byte) {
+	if ( in == end ) {
+		return false;
+	}
+	byte = (uint8_t) *in++;
+	return true;
 }
 
 /**
- * Constructor
+ * FUNCTION NAME: sizeAs
+ *
+ * DESCRIPTION: Bytes of a message of type T: the header and the fields
+ * 				MP2_SCHEMA lists for T
  */
-// construct a create or update message
-Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value, ReplicaType _replica){
-	this->delimiter = "::";
-	transID = _transID;
-	fromAddr = _fromAddr;
-	type = _type;
-	key = _key;
-	value = _value;
-	replica = _replica;
+template <MessageType T>
+static size_t sizeAs(const Mp2MessageView &msg) {
+	constexpr unsigned fields = MP2_SCHEMA[T];
+	size_t size = MP2_HEADER_BYTES;
+	if constexpr ( (fields & FIELD_REPLICA) != 0 ) {
+		size++;
+	}
+	if constexpr ( (fields & FIELD_FROM_TYPE) != 0 ) {
+		size++;
+	}
+	if constexpr ( (fields & FIELD_SUCCESS) != 0 ) {
+		size++;
+	}
+	if constexpr ( (fields & FIELD_VERSION) != 0 ) {
+		size += varintSize(msg.version);
+	}
+	if constexpr ( (fields & FIELD_EXPIRES_AT) != 0 ) {
+		size += varintSize(msg.expiresAt);
+	}
+	if constexpr ( (fields & FIELD_KEY) != 0 ) {
+		size += varintSize(msg.key.size()) + msg.key.size();
+	}
+	if constexpr ( (fields & FIELD_VALUE) != 0 ) {
+		size += varintSize(msg.value.size()) + msg.value.size();
+	}
+	return size;
 }
 
 /**
- * Constructor
+ * FUNCTION NAME: encodeAs
+ *
+ * DESCRIPTION: Write a message of type T at out: the header, then the
+ * 				fields MP2_SCHEMA lists for T. out has room for sizeAs<T>.
+ *
+ * RETURNS:
+ * the end of the message
  */
-Message::Message(const Message& anotherMessage) {
-	this->delimiter = anotherMessage.delimiter;
-	this->fromAddr = anotherMessage.fromAddr;
-	this->key = anotherMessage.key;
-	this->replica = anotherMessage.replica;
-	this->success = anotherMessage.success;
-	this->transID = anotherMessage.transID;
-	this->type = anotherMessage.type;
-	this->value = anotherMessage.value;
+template <MessageType T>
+static char *encodeAs(const Mp2MessageView &msg, char *out) {
+	constexpr unsigned fields = MP2_SCHEMA[T];
+	out[0] = (char) T;
+	memcpy(out + 1, &msg.transID, sizeof(msg.transID));
+	memcpy(out + 5, msg.fromAddr.addr, sizeof(msg.fromAddr.addr));
+	out += MP2_HEADER_BYTES;
+	if constexpr ( (fields & FIELD_REPLICA) != 0 ) {
+		*out++ = (char) msg.replica;
+	}
+	if constexpr ( (fields & FIELD_FROM_TYPE) != 0 ) {
+		*out++ = (char) msg.fromMessageType;
+	}
+	if constexpr ( (fields & FIELD_SUCCESS) != 0 ) {
+		*out++ = (char) msg.success;
+	}
+	if constexpr ( (fields & FIELD_VERSION) != 0 ) {
+		out = putVarint(out, msg.version);
+	}
+	if constexpr ( (fields & FIELD_EXPIRES_AT) != 0 ) {
+		out = putVarint(out, msg.expiresAt);
+	}
+	if constexpr ( (fields & FIELD_KEY) != 0 ) {
+		out = putBytes(out, msg.key);
+	}
+	if constexpr ( (fields & FIELD_VALUE) != 0 ) {
+		out = putBytes(out, msg.value);
+	}
+	return out;
 }
 
 /**
- * Constructor
+ * FUNCTION NAME: decodeAs
+ *
+ * DESCRIPTION: Parse the fields MP2_SCHEMA lists for T, between the header
+ * 				and end. The other fields are reset, so a view can be reused
+ * 				from message to message.
+ *
+ * RETURNS:
+ * false if a field is truncated or bytes are left over
  */
-Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value){
-	this->delimiter = "::";
-	transID = _transID;
-	fromAddr = _fromAddr;
-	type = _type;
-	key = _key;
-	value = _value;
+template <MessageType T>
+static bool decodeAs(Mp2MessageView &msg, const char *in, const char *end) {
+	constexpr unsigned fields = MP2_SCHEMA[T];
+	uint8_t byte = 0;
+	uint64_t number = 0;
+	msg.type = T;
+	// a READREPLY answers a READ
+	msg.fromMessageType = T == READREPLY ? READ : CREATE;
+	msg.replica = PRIMARY;
+	msg.success = false;
+	msg.version = 0;
+	msg.expiresAt = 0;
+	msg.key = string_view();
+	msg.value = string_view();
+	if constexpr ( (fields & FIELD_REPLICA) != 0 ) {
+		if ( !getByte(in, end, byte) ) {
+			return false;
+		}
+		msg.replica = (ReplicaType) byte;
+	}
+	if constexpr ( (fields & FIELD_FROM_TYPE) != 0 ) {
+		if ( !getByte(in, end, byte) ) {
+			return false;
+		}
+		msg.fromMessageType = (MessageType) byte;
+	}
+	if constexpr ( (fields & FIELD_SUCCESS) != 0 ) {
+		if ( !getByte(in, end, byte) ) {
+			return false;
+		}
+		msg.success = byte != 0;
+	}
+	if constexpr ( (fields & FIELD_VERSION) != 0 ) {
+		if ( !getVarint(in, end, msg.version) ) {
+			return false;
+		}
+	}
+	if constexpr ( (fields & FIELD_EXPIRES_AT) != 0 ) {
+		if ( !getVarint(in, end, number) ) {
+			return false;
+		}
+		msg.expiresAt = (uint32_t) number;
+	}
+	if constexpr ( (fields & FIELD_KEY) != 0 ) {
+		if ( !getBytes(in, end, msg.key) ) {
+			return false;
+		}
+	}
+	if constexpr ( (fields & FIELD_VALUE) != 0 ) {
+		if ( !getBytes(in, end, msg.value) ) {
+			return false;
+		}
+	}
+	return in == end;
 }
 
 /**
- * Constructor
+ * FUNCTION NAME: write
+ *
+ * DESCRIPTION: Write msg at out with the encoder of its type
+ *
+ * RETURNS:
+ * the end of the message
  */
-// construct a read or delete message
-Message::Message(int _transID, Address _fromAddr, MessageType _type, string _key){
-	this->delimiter = "::";
-	transID = _transID;
-	fromAddr = _fromAddr;
-	type = _type;
-	key = _key;
+static char *write(const Mp2MessageView &msg, char *out) {
+	switch ( msg.type ) {
+		case CREATE: return encodeAs<CREATE>(msg, out);
+		case READ: return encodeAs<READ>(msg, out);
+		case UPDATE: return encodeAs<UPDATE>(msg, out);
+		case DELETE: return encodeAs<DELETE>(msg, out);
+		case REPLY: return encodeAs<REPLY>(msg, out);
+		case READREPLY: return encodeAs<READREPLY>(msg, out);
+	}
+	return out;
 }
 
 /**
  * Constructor
  */
-// construct reply message
-Message::Message(int _transID, Address _fromAddr, MessageType _type, bool _success){
-	this->delimiter = "::";
-	transID = _transID;
-	fromAddr = _fromAddr;
-	type = _type;
-	success = _success;
+Mp2MessageView::Mp2MessageView(): type(CREATE), fromMessageType(CREATE), replica(PRIMARY), success(false),
+		transID(0), version(0), expiresAt(0) {
+	fromAddr.init();
 }
 
 /**
- * Constructor
+ * FUNCTION NAME: decode
+ *
+ * DESCRIPTION: Parse a message in wire format with the decoder of its type.
+ * 				Only the views are set: no byte is copied and nothing is
+ * 				allocated.
+ *
+ * RETURNS:
+ * false if the message is truncated or malformed
  */
-// construct read reply message
-Message::Message(int _transID, Address _fromAddr, string _value){
-	this->delimiter = "::";
-	transID = _transID;
-	fromAddr = _fromAddr;
-	type = READREPLY;
-	value = _value;
+bool Mp2MessageView::decode(const char *data, size_t size) {
+	if ( size < MP2_HEADER_BYTES ) {
+		return false;
+	}
+	memcpy(&transID, data + 1, sizeof(transID));
+	memcpy(fromAddr.addr, data + 5, sizeof(fromAddr.addr));
+	const char *in = data + MP2_HEADER_BYTES;
+	const char *end = data + size;
+	switch ( (uint8_t) data[0] ) {
+		case CREATE: return decodeAs<CREATE>(*this, in, end);
+		case READ: return decodeAs<READ>(*this, in, end);
+		case UPDATE: return decodeAs<UPDATE>(*this, in, end);
+		case DELETE: return decodeAs<DELETE>(*this, in, end);
+		case REPLY: return decodeAs<REPLY>(*this, in, end);
+		case READREPLY: return decodeAs<READREPLY>(*this, in, end);
+	}
+	return false;
 }
 
 /**
- * FUNCTION NAME: toString
+ * FUNCTION NAME: encode
  *
- * DESCRIPTION: Serialized Message in string format
+ * DESCRIPTION: Write the message in wire format into out, reusing its buffer
  */
-string Message::toString(){
-	string message = to_string(transID) + delimiter + fromAddr.getAddress() + delimiter + to_string(type) + delimiter;
-	switch(type){
-		case CREATE:
-		case UPDATE:
-			message += key + delimiter + value + delimiter + to_string(replica);
-			break;
-		case READ:
-		case DELETE:
-			message += key;
-			break;
-		case REPLY:
-			if (success)
-				message += "1";
-			else
-				message += "0";
-			break;
-		case READREPLY:
-			message += value;
-			break;
-	}
-	return message;
+void Mp2MessageView::encode(string &out) const {
+	out.resize(encodedSize());
+	write(*this, &out[0]);
 }
 
 /**
- * Assignment operator overloading
+ * FUNCTION NAME: decodeRecord
+ *
+ * DESCRIPTION: Parse the next record of a frame in place, like decode
+ *
+ * RETURNS:
+ * false if the record is truncated or malformed, which leaves the rest of
+ * the frame unreadable
  */
-Message& Message::operator =(const Message& anotherMessage) {
-	this->delimiter = anotherMessage.delimiter;
-	this->fromAddr = anotherMessage.fromAddr;
-	this->key = anotherMessage.key;
-	this->replica = anotherMessage.replica;
-	this->success = anotherMessage.success;
-	this->transID = anotherMessage.transID;
-	this->type = anotherMessage.type;
-	this->value = anotherMessage.value;
-	return *this;
+bool Mp2MessageView::decodeRecord(const char *&in, const char *end) {
+	string_view record;
+	if ( !getBytes(in, end, record) ) {
+		return false;
+	}
+	return decode(record.data(), record.size());
+}
+
+/**
+ * FUNCTION NAME: encodeRecord
+ *
+ * DESCRIPTION: Write the message at out as a record of a frame, prefixed
+ * 				with its length. out has room for recordSize() bytes.
+ *
+ * RETURNS:
+ * the end of the record
+ */
+char *Mp2MessageView::encodeRecord(char *out) const {
+	return write(*this, putVarint(out, encodedSize()));
+}
+
+size_t Mp2MessageView::recordSize() const {
+	size_t size = encodedSize();
+	return varintSize(size) + size;
+}
+
+size_t Mp2MessageView::encodedSize() const {
+	switch ( type ) {
+		case CREATE: return sizeAs<CREATE>(*this);
+		case READ: return sizeAs<READ>(*this);
+		case UPDATE: return sizeAs<UPDATE>(*this);
+		case DELETE: return sizeAs<DELETE>(*this);
+		case REPLY: return sizeAs<REPLY>(*this);
+		case READREPLY: return sizeAs<READREPLY>(*this);
+	}
+	return 0;
 }
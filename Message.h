@@ -9,112 +9,138 @@
 #include "stdincludes.h"
 #include "Member.h"
 #include "common.h"
+#include "InlineKey.h"
+#include <stdint.h>
+
+/*
+ * Macros
+ */
+// part of an Mp2Message every type carries: type (1) | transID (4) | fromAddr (6)
+#define MP2_HEADER_BYTES 11
+// longest varint, that of a 64-bit integer
+#define MP2_VARINT_BYTES 10
+
+/*
+ * Mp2Message schema. After the header a message carries only the fields its
+ * type lists below, in the order of their bits: a replica, message type or
+ * success flag is a byte, version and expiresAt are varints (7 bits per byte,
+ * low bits first), and the key and the value are a varint length followed by
+ * the bytes. Integers are in host byte order, like the rest of the emulated
+ * network. Fields a type does not carry decode as 0 or empty.
+ * A frame, the payload of one EmulNet message, holds the messages a node
+ * sends one destination in a tick as records: the varint length of the
+ * message, then the message.
+ */
+enum Mp2Field {
+	FIELD_REPLICA = 1,
+	FIELD_FROM_TYPE = 2,
+	FIELD_SUCCESS = 4,
+	FIELD_VERSION = 8,
+	FIELD_EXPIRES_AT = 16,
+	FIELD_KEY = 32,
+	FIELD_VALUE = 64
+};
+
+// fields of each MessageType, indexed by the type
+constexpr unsigned MP2_SCHEMA[] = {
+	// CREATE
+	FIELD_REPLICA | FIELD_VERSION | FIELD_EXPIRES_AT | FIELD_KEY | FIELD_VALUE,
+	// READ
+	FIELD_KEY,
+	// UPDATE
+	FIELD_REPLICA | FIELD_VERSION | FIELD_EXPIRES_AT | FIELD_KEY | FIELD_VALUE,
+	// DELETE
+	FIELD_KEY,
+	// REPLY to a CREATE, UPDATE or DELETE; the coordinator knows the key and value
+	FIELD_FROM_TYPE | FIELD_SUCCESS,
+	// READREPLY, the REPLY to a READ: the replica's newest version and value
+	FIELD_SUCCESS | FIELD_VERSION | FIELD_VALUE
+};
 
 /**
- * CLASS NAME: Message
+ * CLASS NAME: Mp2MessageView
  *
- * DESCRIPTION: This class is used for message passing among nodes
+ * DESCRIPTION: An Mp2Message whose key and value are views. Decoding points
+ * 				them into the receive buffer, so a message is read without
+ * 				allocating; encoding writes the wire format into a buffer the
+ * 				caller reuses. Both are generated from MP2_SCHEMA, one encoder
+ * 				and one decoder per type.
  */
-class Message{
+class Mp2MessageView {
 public:
 	MessageType type;
+	MessageType fromMessageType;
 	ReplicaType replica;
-	string key;
-	string value;
-	Address fromAddr;
+	bool success;
 	int transID;
-	bool success; // success or not 
-	// delimiter
-	string delimiter;
-	// construct a message from a string
-	Message(string message);
-	Message(const Message& anotherMessage);
-	// construct a create or update message
-	Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value);
-	Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value, ReplicaType _replica);
-	// construct a read or delete message
-	Message(int _transID, Address _fromAddr, MessageType _type, string _key);
-	// construct reply message
-	Message(int _transID, Address _fromAddr, MessageType _type, bool _success);
-	// construct read reply message
-	Message(int _transID, Address _fromAddr, string _value);
-	Message& operator = (const Message& anotherMessage);
-	// serialize to a string
-	string toString();
+	Address fromAddr;
+	uint64_t version;
+	uint32_t expiresAt;
+	string_view key;
+	string_view value;
+	Mp2MessageView();
+	// parse size bytes at data; the views stay valid as long as data
+	bool decode(const char *data, size_t size);
+	// replace out with the wire format
+	void encode(string &out) const;
+	// parse the record of a frame at in, advancing in past it
+	bool decodeRecord(const char *&in, const char *end);
+	// write the message at out as a record of a frame; returns the end of the record
+	char *encodeRecord(char *out) const;
+	// bytes of the wire format, alone and as a record
+	size_t encodedSize() const;
+	size_t recordSize() const;
 };
 
 /**
- * CLASS NAME: Mp2Message
+ * CLASS NAME: BasicMp2Message
  *
- * DESCRIPTION: Another variant for message
+ * DESCRIPTION: Another variant for message. KeyType is the type of the key
+ * 				it carries (see Mp2Message below). It owns its key and value;
+ * 				on the wire it is an Mp2MessageView.
  */
-class Mp2Message{
+template <class KeyType>
+class BasicMp2Message{
 public:
-  Mp2Message();
-  Mp2Message(MessageType msg):type(msg) {}
-  virtual ~Mp2Message() {}
+  BasicMp2Message();
+  BasicMp2Message(MessageType msg):type(msg) {}
+  virtual ~BasicMp2Message() {}
 	MessageType type;
-	MessageType fromMessageType;
-	ReplicaType replica;
-	string key;
+	MessageType fromMessageType = CREATE;
+	ReplicaType replica = PRIMARY;
+	KeyType key;
 	string value;
 	Address fromAddr;
-	int transID;
-  bool got_reply;
-	bool success; // success or not 
-	// delimiter
-	string delimiter = "::";
-
-Mp2Message(string message){
-  this->delimiter = "::";
-  vector<string> tuple;
-  size_t pos = message.find(delimiter);
-  size_t start = 0;
-  while (pos != string::npos) {
-    string field = message.substr(start, pos-start);
-    tuple.push_back(field);
-    start = pos + 2;
-    pos = message.find(delimiter, start);
-  }
-  tuple.push_back(message.substr(start));
-
-  transID = stoi(tuple.at(0));
-  Address addr(tuple.at(1));
-  fromAddr = addr;
-  type = static_cast<MessageType>(stoi(tuple.at(2)));
-  switch(type){
-    case CREATE:
-    case UPDATE:
-      key = tuple.at(3);
-      value = tuple.at(4);
-      if (tuple.size() > 5)
-        replica = static_cast<ReplicaType>(stoi(tuple.at(5)));
-      break;
-    case READ:
-    case DELETE:
-      key = tuple.at(3);
-      break;
-    case REPLY:
-      fromMessageType = static_cast<MessageType>(stoi(tuple.at(6)));
-      if (tuple.at(3) == "1")
-        success = true;
-      else
-        success = false;
-      key = tuple.at(4);
-      value = tuple.at(5);
-      break;
-    case READREPLY:
-      value = tuple.at(3);
-      break;
-  }
+	int transID = 0;
+  bool got_reply = false;
+	bool success = false; // success or not 
+	// version of the written value (last writer wins), carried by CREATE, UPDATE and REPLY
+	uint64_t version = 0;
+	// tick the written value expires at, 0 for never; carried by CREATE and UPDATE
+	uint32_t expiresAt = 0;
+
+/**
+ * Constructor
+ */
+// copy a decoded message
+explicit BasicMp2Message(const Mp2MessageView &message){
+  type = message.type;
+  fromMessageType = message.fromMessageType;
+  replica = message.replica;
+  success = message.success;
+  transID = message.transID;
+  fromAddr = message.fromAddr;
+  version = message.version;
+  expiresAt = message.expiresAt;
+  key = message.key;
+  value = message.value;
 }
 
 /**
  * Constructor
  */
 // construct a create or update message
-Mp2Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value, ReplicaType _replica){
-  this->delimiter = "::";
+BasicMp2Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value, ReplicaType _replica){
   transID = _transID;
   fromAddr = _fromAddr;
   type = _type;
@@ -126,22 +152,24 @@ Mp2Message(int _transID, Address _fromAddr, MessageType _type, string _key, stri
 /**
  * Constructor
  */
-Mp2Message(const Mp2Message& anotherMessage) {
-  this->delimiter = anotherMessage.delimiter;
+BasicMp2Message(const BasicMp2Message& anotherMessage) {
   this->fromAddr = anotherMessage.fromAddr;
+  this->fromMessageType = anotherMessage.fromMessageType;
+  this->got_reply = anotherMessage.got_reply;
   this->key = anotherMessage.key;
   this->replica = anotherMessage.replica;
   this->success = anotherMessage.success;
   this->transID = anotherMessage.transID;
   this->type = anotherMessage.type;
   this->value = anotherMessage.value;
+  this->version = anotherMessage.version;
+  this->expiresAt = anotherMessage.expiresAt;
 }
 
 /**
  * Constructor
  */
-Mp2Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value){
-  this->delimiter = "::";
+BasicMp2Message(int _transID, Address _fromAddr, MessageType _type, string _key, string _value){
   transID = _transID;
   fromAddr = _fromAddr;
   type = _type;
@@ -153,8 +181,7 @@ Mp2Message(int _transID, Address _fromAddr, MessageType _type, string _key, stri
  * Constructor
  */
 // construct a read or delete message
-Mp2Message(int _transID, Address _fromAddr, MessageType _type, string _key){
-  this->delimiter = "::";
+BasicMp2Message(int _transID, Address _fromAddr, MessageType _type, string _key){
   transID = _transID;
   fromAddr = _fromAddr;
   type = _type;
@@ -165,8 +192,7 @@ Mp2Message(int _transID, Address _fromAddr, MessageType _type, string _key){
  * Constructor
  */
 // construct reply message
-Mp2Message(int _transID, Address _fromAddr, MessageType _type, bool _success){
-  this->delimiter = "::";
+BasicMp2Message(int _transID, Address _fromAddr, MessageType _type, bool _success){
   transID = _transID;
   fromAddr = _fromAddr;
   type = _type;
@@ -177,8 +203,7 @@ Mp2Message(int _transID, Address _fromAddr, MessageType _type, bool _success){
  * Constructor
  */
 // construct read reply message
-Mp2Message(int _transID, Address _fromAddr, string _value){
-  this->delimiter = "::";
+BasicMp2Message(int _transID, Address _fromAddr, string _value){
   transID = _transID;
   fromAddr = _fromAddr;
   type = READREPLY;
@@ -186,48 +211,54 @@ Mp2Message(int _transID, Address _fromAddr, string _value){
 }
 
 /**
- * FUNCTION NAME: toString
+ * FUNCTION NAME: view
  *
- * DESCRIPTION: Serialized Message in string format
+ * DESCRIPTION: The message with views of its key and value
  */
-string toString(){
-  string message = to_string(transID) + delimiter + fromAddr.getAddress() + delimiter + to_string(type) + delimiter;
-  switch(type){
-    case CREATE:
-    case UPDATE:
-      message += key + delimiter + value + delimiter + to_string(replica);
-      break;
-    case READ:
-    case DELETE:
-      message += key;
-      break;
-    case REPLY:
-      if (success)
-        message += "1"+delimiter+key+delimiter+value+delimiter+ to_string(fromMessageType);
-      else
-        message += "0"+delimiter+key+delimiter+value+delimiter+ to_string(fromMessageType);
-      break;
-    case READREPLY:
-      message += value;
-      break;
-  }
+Mp2MessageView view() const {
+  Mp2MessageView message;
+  message.type = type;
+  message.fromMessageType = fromMessageType;
+  message.replica = replica;
+  message.success = success;
+  message.transID = transID;
+  message.fromAddr = fromAddr;
+  message.version = version;
+  message.expiresAt = expiresAt;
+  message.key = key;
+  message.value = value;
   return message;
 }
 
+/**
+ * FUNCTION NAME: encode
+ *
+ * DESCRIPTION: Replace out with the message in wire format
+ */
+void encode(string &out) const {
+  view().encode(out);
+}
+
 /**
  * Assignment operator overloading
  */
-Mp2Message& operator =(const Mp2Message& anotherMessage) {
-  this->delimiter = anotherMessage.delimiter;
+BasicMp2Message& operator =(const BasicMp2Message& anotherMessage) {
   this->fromAddr = anotherMessage.fromAddr;
+  this->fromMessageType = anotherMessage.fromMessageType;
+  this->got_reply = anotherMessage.got_reply;
   this->key = anotherMessage.key;
   this->replica = anotherMessage.replica;
   this->success = anotherMessage.success;
   this->transID = anotherMessage.transID;
   this->type = anotherMessage.type;
   this->value = anotherMessage.value;
+  this->version = anotherMessage.version;
+  this->expiresAt = anotherMessage.expiresAt;
   return *this;
 }
 };
 
+// keys of KEY_LENGTH bytes travel inline in the message
+typedef BasicMp2Message<Key> Mp2Message;
+
 #endif
@@ -9,7 +9,7 @@
 /**
  * Constructor
  */
-Params::Params(): PORTNUM(8001) {}
+Params::Params(): PORTNUM(8001), MEMORY_BUDGET(0), COLD_AFTER(0), VALUE_LOG_MIN(0), DEDUP(0), COMPRESS(0) {}
 
 /**
  * FUNCTION NAME: setparams
@@ -19,6 +19,8 @@ Params::Params(): PORTNUM(8001) {}
 void Params::setparams(char *config_file) {
 	//trace.funcEntry("Params::setparams");
 	char CRUD[10];
+	char option[32];
+	char setting[256];
 	FILE *fp = fopen(config_file,"r");
 
 	fscanf(fp,"MAX_NNB: %d", &MAX_NNB);
@@ -26,6 +28,30 @@ void Params::setparams(char *config_file) {
 	fscanf(fp,"\nDROP_MSG: %d", &DROP_MSG);
 	fscanf(fp,"\nMSG_DROP_PROB: %lf", &MSG_DROP_PROB);
 	fscanf(fp,"\nCRUD_TEST: %s", CRUD);
+	// optional, in any order
+	while ( fscanf(fp," %31[A-Z_]: %255s", option, setting) == 2 ) {
+		if ( 0 == strcmp(option, "STORAGE_DIR") ) {
+			STORAGE_DIR = setting;
+		}
+		else if ( 0 == strcmp(option, "SNAPSHOT_DIR") ) {
+			SNAPSHOT_DIR = setting;
+		}
+		else if ( 0 == strcmp(option, "MEMORY_BUDGET") ) {
+			MEMORY_BUDGET = strtoul(setting, NULL, 10);
+		}
+		else if ( 0 == strcmp(option, "COLD_AFTER") ) {
+			COLD_AFTER = strtoul(setting, NULL, 10);
+		}
+		else if ( 0 == strcmp(option, "VALUE_LOG_MIN") ) {
+			VALUE_LOG_MIN = strtoul(setting, NULL, 10);
+		}
+		else if ( 0 == strcmp(option, "DEDUP") ) {
+			DEDUP = strtoul(setting, NULL, 10);
+		}
+		else if ( 0 == strcmp(option, "COMPRESS") ) {
+			COMPRESS = strtoul(setting, NULL, 10);
+		}
+	}
 
 	if ( 0 == strcmp(CRUD, "CREATE") ) {
 		this->CRUDTEST = CREATE_TEST;
@@ -32,6 +32,20 @@ public:
 	int allNodesJoined;
 	short PORTNUM;
 	int CRUDTEST;
+	// directory of the persistent per-node stores; empty keeps every store in memory
+	string STORAGE_DIR;
+	// directory of the per-node snapshots of in-memory stores, saved at exit and loaded at start
+	string SNAPSHOT_DIR;
+	// bytes of keys and values an in-memory store keeps in memory before spilling values; 0 for no bound
+	unsigned long MEMORY_BUDGET;
+	// ticks a key of an in-memory store goes unused before it moves to the cold tier; 0 for no cold tier
+	unsigned long COLD_AFTER;
+	// bytes from which a persistent store keeps a value in its value log; 0 for the default
+	unsigned long VALUE_LOG_MIN;
+	// 1 to keep each distinct value of an in-memory store once; 0 by default
+	unsigned long DEDUP;
+	// 1 to compress the values of an in-memory store with a trained dictionary; 0 by default
+	unsigned long COMPRESS;
 	Params();
 	void setparams(char *);
 	int getcurrtime();
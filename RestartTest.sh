@@ -0,0 +1,65 @@
+#!/bin/bash
+
+#################################################
+# FILE NAME: RestartTest.sh
+#
+# DESCRIPTION: Runs every Application test workload twice on the same
+#              STORAGE_DIR, then twice on the same SNAPSHOT_DIR, so that the
+#              second run restarts each node on the keys the first one left
+#              behind. Fails if a run does not exit cleanly or if no node
+#              of the second run comes up with keys.
+#
+# RUN PROCEDURE:
+# $ chmod +x RestartTest.sh
+# $ ./RestartTest.sh
+#################################################
+
+TESTS="create delete read update"
+OPTIONS="STORAGE_DIR SNAPSHOT_DIR"
+WORKDIR=$(mktemp -d)
+STATUS=0
+
+make clean > /dev/null 2>&1
+make > /dev/null 2>&1
+if [ $? -ne 0 ]
+then
+	echo "COMPILATION ERROR !!!"
+	exit 1
+fi
+
+for option in ${OPTIONS}
+do
+	for test in ${TESTS}
+	do
+		rm -rf ${WORKDIR}/store
+		mkdir -p ${WORKDIR}/store
+		cp ./testcases/${test}.conf ${WORKDIR}/${test}.conf
+		echo "${option}: ${WORKDIR}/store" >> ${WORKDIR}/${test}.conf
+		for run in first restart
+		do
+			./Application ${WORKDIR}/${test}.conf > /dev/null 2>&1
+			code=$?
+			if [ ${code} -ne 0 ]
+			then
+				echo "${option} ${test} ${run} run: exit ${code}"
+				STATUS=1
+			fi
+		done
+		# the nodes of the restart run must come up with the keys of the first
+		if ! grep -q "restarted with" dbg.log
+		then
+			echo "${option} ${test}: no node restarted with keys"
+			STATUS=1
+		fi
+	done
+done
+
+rm -rf ${WORKDIR}
+make clean > /dev/null 2>&1
+if [ ${STATUS} -eq 0 ]
+then
+	echo "RESTART TEST: PASSED"
+else
+	echo "RESTART TEST: FAILED"
+fi
+exit ${STATUS}
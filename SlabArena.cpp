@@ -0,0 +1,249 @@
+/**********************************
+ * FILE NAME: SlabArena.cpp
+ *
+ * DESCRIPTION: SlabArena class definition
+ **********************************/
+
+#include "SlabArena.h"
+
+// returned for zero length requests so that callers never see NULL
+static char emptyBlock[1];
+
+/**
+ * Constructor
+ */
+SlabArena::SlabArena(): cursor(NULL), limit(NULL), inUse(0), reserved(0), freeBytes(0) {
+	memset(freeLists, 0, sizeof(freeLists));
+	largeBlocks.prev = &largeBlocks;
+	largeBlocks.next = &largeBlocks;
+}
+
+/**
+ * Destructor
+ */
+SlabArena::~SlabArena() {
+	clear();
+}
+
+/**
+ * FUNCTION NAME: sizeClass
+ *
+ * DESCRIPTION: Map a request size (1..SLAB_MAX_BLOCK) to its size class
+ */
+int SlabArena::sizeClass(size_t size) {
+	if ( size <= 128 ) {
+		return (int)((size + 7) / 8) - 1;
+	}
+	int log2 = 63 - __builtin_clzll(size - 1);
+	size_t base = (size_t)1 << log2;
+	return 16 + 4 * (log2 - 7) + (int)((size - base - 1) / (base / 4));
+}
+
+/**
+ * FUNCTION NAME: classSize
+ *
+ * DESCRIPTION: Block size of a size class
+ */
+size_t SlabArena::classSize(int sizeClass) {
+	if ( sizeClass < 16 ) {
+		return (size_t)(sizeClass + 1) * 8;
+	}
+	size_t base = (size_t)128 << ((sizeClass - 16) / 4);
+	return base + (size_t)((sizeClass - 16) % 4 + 1) * (base / 4);
+}
+
+/**
+ * FUNCTION NAME: allocate
+ *
+ * DESCRIPTION: Allocate a block of at least size bytes, 8 byte aligned
+ */
+char *SlabArena::allocate(size_t size) {
+	if ( size == 0 ) {
+		return emptyBlock;
+	}
+	inUse += size;
+	if ( size > SLAB_MAX_BLOCK ) {
+		LargeBlock *large = (LargeBlock *) malloc(sizeof(LargeBlock) + size);
+		large->prev = &largeBlocks;
+		large->next = largeBlocks.next;
+		largeBlocks.next->prev = large;
+		largeBlocks.next = large;
+		reserved += sizeof(LargeBlock) + size;
+		return (char *)(large + 1);
+	}
+
+	int c = sizeClass(size);
+	size_t blockSize = classSize(c);
+	char *block = freeLists[c];
+	if ( block != NULL ) {
+		// Reuse a freed block; the free list link lives in its first word
+		memcpy(&freeLists[c], block, sizeof(char *));
+		freeBytes -= blockSize;
+		return block;
+	}
+	if ( cursor == NULL || (size_t)(limit - cursor) < blockSize ) {
+		// The tail of the old slab (less than one block) is abandoned
+		cursor = (char *) malloc(SLAB_SIZE);
+		limit = cursor + SLAB_SIZE;
+		slabs.push_back(cursor);
+		reserved += SLAB_SIZE;
+	}
+	block = cursor;
+	cursor += blockSize;
+	return block;
+}
+
+/**
+ * FUNCTION NAME: deallocate
+ *
+ * DESCRIPTION: Return a block to its free list. size must be the size
+ * 				passed to allocate.
+ */
+void SlabArena::deallocate(char *block, size_t size) {
+	if ( size == 0 ) {
+		return;
+	}
+	inUse -= size;
+	if ( size > SLAB_MAX_BLOCK ) {
+		LargeBlock *large = (LargeBlock *) block - 1;
+		large->prev->next = large->next;
+		large->next->prev = large->prev;
+		reserved -= sizeof(LargeBlock) + size;
+		free(large);
+		return;
+	}
+	int c = sizeClass(size);
+	memcpy(block, &freeLists[c], sizeof(char *));
+	freeLists[c] = block;
+	freeBytes += classSize(c);
+}
+
+/**
+ * FUNCTION NAME: copy
+ *
+ * DESCRIPTION: Copy bytes into a new block
+ *
+ * RETURNS:
+ * view of the arena copy
+ */
+string_view SlabArena::copy(string_view bytes) {
+	char *block = allocate(bytes.size());
+	memcpy(block, bytes.data(), bytes.size());
+	return string_view(block, bytes.size());
+}
+
+/**
+ * FUNCTION NAME: replace
+ *
+ * DESCRIPTION: Overwrite the block behind old with bytes. The block is reused
+ * 				when both sizes fall in the same size class.
+ *
+ * RETURNS:
+ * view of the arena copy
+ */
+string_view SlabArena::replace(string_view old, string_view bytes) {
+	if ( old.size() > 0 && bytes.size() > 0 && old.size() <= SLAB_MAX_BLOCK && bytes.size() <= SLAB_MAX_BLOCK
+			&& sizeClass(old.size()) == sizeClass(bytes.size()) ) {
+		char *block = const_cast<char *>(old.data());
+		memmove(block, bytes.data(), bytes.size());
+		inUse = inUse - old.size() + bytes.size();
+		return string_view(block, bytes.size());
+	}
+	string_view fresh = copy(bytes);
+	release(old);
+	return fresh;
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Free a block previously returned by copy or replace
+ */
+void SlabArena::release(string_view bytes) {
+	deallocate(const_cast<char *>(bytes.data()), bytes.size());
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Give every slab and oversized block back to the system
+ */
+void SlabArena::clear() {
+	while ( largeBlocks.next != &largeBlocks ) {
+		LargeBlock *large = largeBlocks.next;
+		largeBlocks.next = large->next;
+		free(large);
+	}
+	largeBlocks.prev = &largeBlocks;
+	for ( size_t i = 0; i < slabs.size(); i++ ) {
+		free(slabs[i]);
+	}
+	slabs.clear();
+	cursor = NULL;
+	limit = NULL;
+	memset(freeLists, 0, sizeof(freeLists));
+	inUse = 0;
+	reserved = 0;
+	freeBytes = 0;
+}
+
+/**
+ * FUNCTION NAME: swap
+ *
+ * DESCRIPTION: Exchange the contents of two arenas
+ */
+void SlabArena::swap(SlabArena &anotherArena) {
+	slabs.swap(anotherArena.slabs);
+	// the list heads live inside the arenas, so relink the neighbours
+	std::swap(largeBlocks, anotherArena.largeBlocks);
+	relinkLarge(&anotherArena.largeBlocks);
+	anotherArena.relinkLarge(&largeBlocks);
+	std::swap(cursor, anotherArena.cursor);
+	std::swap(limit, anotherArena.limit);
+	for ( int i = 0; i < NUM_CLASSES; i++ ) {
+		std::swap(freeLists[i], anotherArena.freeLists[i]);
+	}
+	std::swap(inUse, anotherArena.inUse);
+	std::swap(reserved, anotherArena.reserved);
+	std::swap(freeBytes, anotherArena.freeBytes);
+}
+
+/**
+ * FUNCTION NAME: shouldCompact
+ *
+ * DESCRIPTION: Returns true when enough memory sits on free lists that
+ * 				copying the live blocks into a fresh arena pays off
+ */
+bool SlabArena::shouldCompact() const {
+	size_t slabBytes = slabs.size() * (size_t)SLAB_SIZE;
+	return freeBytes >= SLAB_COMPACT_MIN_FREE && freeBytes >= slabBytes * SLAB_COMPACT_RATIO;
+}
+
+size_t SlabArena::bytesInUse() const {
+	return inUse;
+}
+
+size_t SlabArena::bytesReserved() const {
+	return reserved;
+}
+
+size_t SlabArena::bytesFree() const {
+	return freeBytes;
+}
+
+/**
+ * FUNCTION NAME: relinkLarge
+ *
+ * DESCRIPTION: Point the oversized block list back at this arena's list head
+ * 				after the head has been copied from the head at oldHead
+ */
+void SlabArena::relinkLarge(LargeBlock *oldHead) {
+	if ( largeBlocks.next == oldHead ) {
+		// the copied list was empty
+		largeBlocks.prev = &largeBlocks;
+		largeBlocks.next = &largeBlocks;
+		return;
+	}
+	largeBlocks.next->prev = &largeBlocks;
+	largeBlocks.prev->next = &largeBlocks;
+}
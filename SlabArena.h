@@ -0,0 +1,83 @@
+/**********************************
+ * FILE NAME: SlabArena.h
+ *
+ * DESCRIPTION: Header file of the SlabArena class
+ **********************************/
+
+#ifndef SLABARENA_H_
+#define SLABARENA_H_
+
+#include "stdincludes.h"
+#include <stdint.h>
+
+/*
+ * Macros
+ */
+// bytes carved from the system per slab
+#define SLAB_SIZE (1 << 20)
+// largest block served from a slab; bigger blocks go straight to malloc
+#define SLAB_MAX_BLOCK 4096
+// compact once this many bytes sit on free lists ...
+#define SLAB_COMPACT_MIN_FREE (4 * SLAB_SIZE)
+// ... and they make up at least this fraction of the slab bytes
+#define SLAB_COMPACT_RATIO 0.5
+
+/**
+ * CLASS NAME: SlabArena
+ *
+ * DESCRIPTION: Allocator for the key and value bytes of the storage layer.
+ * 				Blocks are rounded up to a size class (8 byte steps up to 128,
+ * 				then four classes per power of two up to SLAB_MAX_BLOCK) and
+ * 				bump allocated from large slabs. Freed blocks go to a per
+ * 				class free list and are reused before the slab grows.
+ *
+ * 				Slab blocks carry no header: callers give back the size they
+ * 				asked for, which the storage layer always knows from its
+ * 				string_view. Oversized blocks are linked into a list so that
+ * 				clear() can find them.
+ * 				Freed memory is only returned to the system by clear() or by
+ * 				moving the live data into a fresh arena (see HashTable::compact).
+ */
+class SlabArena {
+public:
+	SlabArena();
+	virtual ~SlabArena();
+	char *allocate(size_t size);
+	void deallocate(char *block, size_t size);
+	// allocate and fill a block; returns a view of the arena copy
+	string_view copy(string_view bytes);
+	// replace a block previously returned by copy, in place when the size class allows
+	string_view replace(string_view old, string_view bytes);
+	void release(string_view bytes);
+	void clear();
+	void swap(SlabArena &anotherArena);
+	bool shouldCompact() const;
+	// bytes handed out, as requested by callers
+	size_t bytesInUse() const;
+	// bytes taken from the system (slabs and oversized blocks)
+	size_t bytesReserved() const;
+	// bytes waiting on free lists
+	size_t bytesFree() const;
+private:
+	static const int NUM_CLASSES = 36;
+	// header in front of every oversized block
+	struct LargeBlock {
+		LargeBlock *prev;
+		LargeBlock *next;
+	};
+	vector<char *> slabs;
+	LargeBlock largeBlocks;
+	char *cursor;
+	char *limit;
+	char *freeLists[NUM_CLASSES];
+	size_t inUse;
+	size_t reserved;
+	size_t freeBytes;
+	SlabArena(const SlabArena &anotherArena);
+	SlabArena& operator =(const SlabArena &anotherArena);
+	static int sizeClass(size_t size);
+	static size_t classSize(int sizeClass);
+	void relinkLarge(LargeBlock *oldHead);
+};
+
+#endif /* SLABARENA_H_ */
@@ -0,0 +1,227 @@
+/**********************************
+ * FILE NAME: Snapshot.cpp
+ *
+ * DESCRIPTION: Snapshot and SnapshotWriter class definitions
+ **********************************/
+
+#include "Snapshot.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static uint32_t getU32(const char *in) {
+	uint32_t value;
+	memcpy(&value, in, sizeof(value));
+	return value;
+}
+
+static uint64_t getU64(const char *in) {
+	uint64_t value;
+	memcpy(&value, in, sizeof(value));
+	return value;
+}
+
+/**
+ * Constructor
+ */
+SnapshotWriter::SnapshotWriter(): file(NULL), offset(0), failed(false) {}
+
+/**
+ * Destructor: an unfinished file is removed
+ */
+SnapshotWriter::~SnapshotWriter() {
+	if ( file != NULL ) {
+		fclose(file);
+		unlink(temporary.c_str());
+	}
+}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Start a snapshot that will replace path once finished
+ */
+bool SnapshotWriter::open(const string &path) {
+	this->path = path;
+	temporary = path + ".tmp";
+	file = fopen(temporary.c_str(), "wb");
+	if ( file == NULL ) {
+		perror(temporary.c_str());
+		return false;
+	}
+	char header[SNAPSHOT_HEADER_SIZE] = {0};
+	return write(header, SNAPSHOT_HEADER_SIZE);
+}
+
+bool SnapshotWriter::write(const void *bytes, size_t size) {
+	if ( !failed && fwrite(bytes, 1, size, file) != size ) {
+		perror(temporary.c_str());
+		failed = true;
+	}
+	offset += size;
+	return !failed;
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Append a record and remember its offset for the index
+ */
+bool SnapshotWriter::add(string_view key, const Entry &entry) {
+	string_view value = entry.value();
+	char header[SNAPSHOT_RECORD_HEADER];
+	uint32_t keySize = (uint32_t) key.size();
+	uint32_t valueSize = (uint32_t) value.size();
+	uint64_t version = entry.getVersion();
+	uint32_t expiresAt = entry.getExpiresAt();
+	memcpy(header, &keySize, 4);
+	memcpy(header + 4, &valueSize, 4);
+	memcpy(header + 8, &version, 8);
+	memcpy(header + 16, &expiresAt, 4);
+	header[20] = (char) entry.getReplica();
+	offsets.push_back(offset);
+	write(header, SNAPSHOT_RECORD_HEADER);
+	write(key.data(), key.size());
+	return write(value.data(), value.size());
+}
+
+/**
+ * FUNCTION NAME: finish
+ *
+ * DESCRIPTION: Write the 8-byte aligned index and the header, sync, and
+ * 				rename the file into place
+ *
+ * RETURNS:
+ * true if the snapshot replaced path
+ */
+bool SnapshotWriter::finish() {
+	char padding[8] = {0};
+	write(padding, (8 - offset % 8) % 8);
+	uint64_t header[4] = {SNAPSHOT_MAGIC, offsets.size(), offset, 0};
+	write(offsets.data(), offsets.size() * sizeof(uint64_t));
+	header[3] = offset;
+	if ( !failed && (fseek(file, 0, SEEK_SET) != 0 || fwrite(header, 1, sizeof(header), file) != sizeof(header)
+			|| fflush(file) != 0 || fsync(fileno(file)) != 0) ) {
+		perror(temporary.c_str());
+		failed = true;
+	}
+	fclose(file);
+	file = NULL;
+	if ( failed || rename(temporary.c_str(), path.c_str()) != 0 ) {
+		if ( !failed ) {
+			perror(path.c_str());
+		}
+		unlink(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Constructor
+ */
+Snapshot::Snapshot(): base(NULL), length(0), keys(0), indexOffset(0) {}
+
+/**
+ * Destructor
+ */
+Snapshot::~Snapshot() {
+	if ( base != NULL ) {
+		munmap((void *) base, length);
+	}
+}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Map a snapshot file and check its header
+ *
+ * RETURNS:
+ * false if the file is missing or is not a complete snapshot
+ */
+bool Snapshot::open(const string &path) {
+	this->path = path;
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if ( fd < 0 ) {
+		perror(path.c_str());
+		return false;
+	}
+	struct stat info;
+	if ( fstat(fd, &info) != 0 || (uint64_t) info.st_size < SNAPSHOT_HEADER_SIZE ) {
+		fprintf(stderr, "%s: not a snapshot\n", path.c_str());
+		close(fd);
+		return false;
+	}
+	length = (size_t) info.st_size;
+	void *mapping = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if ( mapping == MAP_FAILED ) {
+		perror(path.c_str());
+		return false;
+	}
+	base = (const char *) mapping;
+	keys = (size_t) getU64(base + 8);
+	indexOffset = getU64(base + 16);
+	if ( getU64(base) != SNAPSHOT_MAGIC || getU64(base + 24) != length || indexOffset % 8 != 0
+			|| indexOffset < SNAPSHOT_HEADER_SIZE || keys > (length - indexOffset) / 8 ) {
+		fprintf(stderr, "%s: corrupt snapshot header\n", path.c_str());
+		munmap(mapping, length);
+		base = NULL;
+		keys = 0;
+		return false;
+	}
+	return true;
+}
+
+size_t Snapshot::size() const {
+	return keys;
+}
+
+/**
+ * FUNCTION NAME: record
+ *
+ * DESCRIPTION: Decode the record at position. The key and the entry's value
+ * 				are views of the mapping.
+ */
+bool Snapshot::record(size_t position, string_view &key, Entry &entry) const {
+	uint64_t offset = getU64(base + indexOffset + position * 8);
+	if ( offset < SNAPSHOT_HEADER_SIZE || offset + SNAPSHOT_RECORD_HEADER > indexOffset ) {
+		return false;
+	}
+	const char *header = base + offset;
+	uint64_t keySize = getU32(header);
+	uint64_t valueSize = getU32(header + 4);
+	if ( offset + SNAPSHOT_RECORD_HEADER + keySize + valueSize > indexOffset ) {
+		return false;
+	}
+	key = string_view(header + SNAPSHOT_RECORD_HEADER, keySize);
+	entry = Entry(string_view(header + SNAPSHOT_RECORD_HEADER + keySize, valueSize), getU64(header + 8),
+			(ReplicaType) header[20], getU32(header + 16));
+	return true;
+}
+
+string_view Snapshot::key(size_t position) const {
+	string_view stored;
+	Entry entry;
+	record(position, stored, entry);
+	return stored;
+}
+
+/**
+ * FUNCTION NAME: find
+ *
+ * DESCRIPTION: Binary search of the offset index
+ */
+size_t Snapshot::find(string_view key) const {
+	size_t low = 0;
+	size_t high = keys;
+	while ( low < high ) {
+		size_t middle = (low + high) / 2;
+		if ( this->key(middle) < key ) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low < keys && this->key(low) == key ? low : keys;
+}
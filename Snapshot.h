@@ -0,0 +1,82 @@
+/**********************************
+ * FILE NAME: Snapshot.h
+ *
+ * DESCRIPTION: Header file of the Snapshot and SnapshotWriter classes
+ **********************************/
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include "stdincludes.h"
+#include "Entry.h"
+#include <stdint.h>
+
+/*
+ * Macros
+ */
+#define SNAPSHOT_MAGIC 0x32304e5041534e4bULL
+// header: magic, key count, index offset, file size
+#define SNAPSHOT_HEADER_SIZE 32
+// record header: key size, value size, version, expiry tick, replica
+#define SNAPSHOT_RECORD_HEADER 21
+// snapshot keys moved into the table per rehydration step
+#define SNAPSHOT_REHYDRATE_KEYS 1024
+
+/**
+ * CLASS NAME: SnapshotWriter
+ *
+ * DESCRIPTION: Writes a snapshot file: the header, the records in key order,
+ * 				then an index of one 8-byte record offset per key. The file is
+ * 				built under a temporary name and renamed into place once synced,
+ * 				so a crash leaves either the old snapshot or the new one.
+ */
+class SnapshotWriter {
+public:
+	SnapshotWriter();
+	virtual ~SnapshotWriter();
+	bool open(const string &path);
+	// key must be greater than every key added before
+	bool add(string_view key, const Entry &entry);
+	bool finish();
+private:
+	FILE *file;
+	string path;
+	string temporary;
+	uint64_t offset;
+	vector<uint64_t> offsets;
+	bool failed;
+	SnapshotWriter(const SnapshotWriter &anotherWriter);
+	SnapshotWriter& operator =(const SnapshotWriter &anotherWriter);
+	bool write(const void *bytes, size_t size);
+};
+
+/**
+ * CLASS NAME: Snapshot
+ *
+ * DESCRIPTION: Read-only view of a snapshot file through mmap. Opening it only
+ * 				checks the header, whatever the number of keys; lookups binary
+ * 				search the offset index and page in what they touch. Keys and
+ * 				values returned are views of the mapping, valid while it is open.
+ */
+class Snapshot {
+public:
+	Snapshot();
+	virtual ~Snapshot();
+	bool open(const string &path);
+	size_t size() const;
+	// position of key, or size() if it is not in the snapshot
+	size_t find(string_view key) const;
+	// record at position; false if it is out of the file
+	bool record(size_t position, string_view &key, Entry &entry) const;
+private:
+	const char *base;
+	size_t length;
+	size_t keys;
+	uint64_t indexOffset;
+	string path;
+	Snapshot(const Snapshot &anotherSnapshot);
+	Snapshot& operator =(const Snapshot &anotherSnapshot);
+	string_view key(size_t position) const;
+};
+
+#endif /* SNAPSHOT_H_ */
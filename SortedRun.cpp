@@ -0,0 +1,416 @@
+/**********************************
+ * FILE NAME: SortedRun.cpp
+ *
+ * DESCRIPTION: SortedRun and SortedRunWriter class definitions
+ **********************************/
+
+#include "SortedRun.h"
+#include <sys/stat.h>
+
+static void putU32(string &out, uint32_t value) {
+	out.append((const char *) &value, sizeof(value));
+}
+
+static void putU64(string &out, uint64_t value) {
+	out.append((const char *) &value, sizeof(value));
+}
+
+static uint32_t getU32(const char *in) {
+	uint32_t value;
+	memcpy(&value, in, sizeof(value));
+	return value;
+}
+
+static uint64_t getU64(const char *in) {
+	uint64_t value;
+	memcpy(&value, in, sizeof(value));
+	return value;
+}
+
+/**
+ * FUNCTION NAME: readFully
+ *
+ * DESCRIPTION: pread exactly size bytes at offset
+ */
+static bool readFully(int fd, char *out, size_t size, uint64_t offset) {
+	while ( size > 0 ) {
+		ssize_t n = pread(fd, out, size, (off_t) offset);
+		if ( n <= 0 ) {
+			return false;
+		}
+		out += n;
+		size -= (size_t) n;
+		offset += (uint64_t) n;
+	}
+	return true;
+}
+
+/**
+ * Constructor
+ */
+SortedRunWriter::SortedRunWriter(): file(NULL), offset(0), keys(0), failed(false) {}
+
+/**
+ * Destructor: an unfinished file is removed
+ */
+SortedRunWriter::~SortedRunWriter() {
+	if ( file != NULL ) {
+		fclose(file);
+		unlink(path.c_str());
+	}
+}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Create the run file at path. expectedKeys sizes the bloom filter.
+ *
+ * RETURNS:
+ * false if the file cannot be created
+ */
+bool SortedRunWriter::open(const string &path, size_t expectedKeys) {
+	this->path = path;
+	file = fopen(path.c_str(), "wb");
+	if ( file == NULL ) {
+		perror(path.c_str());
+		return false;
+	}
+	bloom = BloomFilter(expectedKeys);
+	return true;
+}
+
+bool SortedRunWriter::write(string_view bytes) {
+	if ( !failed && fwrite(bytes.data(), 1, bytes.size(), file) != bytes.size() ) {
+		perror(path.c_str());
+		failed = true;
+	}
+	offset += bytes.size();
+	return !failed;
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Append a record. key must be greater than every key added before.
+ */
+bool SortedRunWriter::add(string_view key, const Entry &entry) {
+	if ( block.size() >= RUN_BLOCK_SIZE && !flushBlock() ) {
+		return false;
+	}
+	if ( block.empty() ) {
+		blockFirstKey.assign(key);
+	}
+	string_view value = entry.value();
+	putU32(block, (uint32_t) key.size());
+	putU32(block, (uint32_t) value.size());
+	putU64(block, entry.getVersion());
+	block.push_back((char) entry.getReplica());
+	block.push_back((char) ((entry.isTombstone() ? RUN_FLAG_TOMBSTONE : 0) | (entry.isBlob() ? RUN_FLAG_BLOB : 0)));
+	putU32(block, entry.getExpiresAt());
+	block.append(key);
+	block.append(value);
+	bloom.add(key);
+	keys++;
+	return !failed;
+}
+
+/**
+ * FUNCTION NAME: flushBlock
+ *
+ * DESCRIPTION: Write the pending data block and add it to the block index
+ */
+bool SortedRunWriter::flushBlock() {
+	if ( block.empty() ) {
+		return true;
+	}
+	putU32(index, (uint32_t) blockFirstKey.size());
+	index.append(blockFirstKey);
+	putU64(index, offset);
+	putU32(index, (uint32_t) block.size());
+	write(block);
+	block.clear();
+	return !failed;
+}
+
+/**
+ * FUNCTION NAME: finish
+ *
+ * DESCRIPTION: Write the index, the bloom filter and the footer, then sync
+ * 				and close the file
+ *
+ * RETURNS:
+ * true if the whole run reached the disk
+ */
+bool SortedRunWriter::finish() {
+	flushBlock();
+	uint64_t indexOffset = offset;
+	write(index);
+	uint64_t bloomOffset = offset;
+	write(bloom.bytes());
+	string footer;
+	putU64(footer, indexOffset);
+	putU64(footer, bloomOffset - indexOffset);
+	putU64(footer, bloomOffset);
+	putU64(footer, bloom.bytes().size());
+	putU64(footer, keys);
+	putU64(footer, RUN_MAGIC);
+	write(footer);
+	if ( !failed && (fflush(file) != 0 || fsync(fileno(file)) != 0) ) {
+		perror(path.c_str());
+		failed = true;
+	}
+	fclose(file);
+	file = NULL;
+	if ( failed ) {
+		unlink(path.c_str());
+	}
+	return !failed;
+}
+
+size_t SortedRunWriter::keyCount() const {
+	return keys;
+}
+
+const string& SortedRunWriter::getPath() const {
+	return path;
+}
+
+/**
+ * Constructor
+ */
+SortedRun::SortedRun(): fd(-1), size(0), keys(0) {}
+
+/**
+ * Destructor
+ */
+SortedRun::~SortedRun() {
+	if ( fd >= 0 ) {
+		close(fd);
+	}
+}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Open a finished run and load its block index and bloom filter
+ *
+ * RETURNS:
+ * false if the file is missing or is not a complete run
+ */
+bool SortedRun::open(const string &path) {
+	this->path = path;
+	fd = ::open(path.c_str(), O_RDONLY);
+	if ( fd < 0 ) {
+		perror(path.c_str());
+		return false;
+	}
+	struct stat info;
+	char footer[RUN_FOOTER_SIZE];
+	if ( fstat(fd, &info) != 0 || (uint64_t) info.st_size < RUN_FOOTER_SIZE
+			|| !readFully(fd, footer, RUN_FOOTER_SIZE, (uint64_t) info.st_size - RUN_FOOTER_SIZE)
+			|| getU64(footer + 40) != RUN_MAGIC ) {
+		fprintf(stderr, "%s: not a sorted run\n", path.c_str());
+		return false;
+	}
+	size = (uint64_t) info.st_size;
+	uint64_t indexOffset = getU64(footer);
+	uint64_t indexSize = getU64(footer + 8);
+	uint64_t bloomOffset = getU64(footer + 16);
+	uint64_t bloomSize = getU64(footer + 24);
+	keys = (size_t) getU64(footer + 32);
+	if ( bloomOffset + bloomSize + RUN_FOOTER_SIZE > size || indexOffset + indexSize > bloomOffset ) {
+		fprintf(stderr, "%s: corrupt footer\n", path.c_str());
+		return false;
+	}
+
+	string bytes(indexSize, '\0');
+	if ( !readFully(fd, &bytes[0], indexSize, indexOffset) ) {
+		perror(path.c_str());
+		return false;
+	}
+	for ( size_t at = 0; at + 4 <= bytes.size(); ) {
+		IndexEntry entry;
+		uint32_t keySize = getU32(&bytes[at]);
+		if ( at + 4 + keySize + 12 > bytes.size() ) {
+			fprintf(stderr, "%s: corrupt block index\n", path.c_str());
+			return false;
+		}
+		entry.firstKey.assign(&bytes[at + 4], keySize);
+		entry.offset = getU64(&bytes[at + 4 + keySize]);
+		entry.size = getU32(&bytes[at + 12 + keySize]);
+		index.push_back(entry);
+		at += 16 + keySize;
+	}
+
+	bytes.assign(bloomSize, '\0');
+	if ( !readFully(fd, &bytes[0], bloomSize, bloomOffset) || !bloom.load(bytes) ) {
+		fprintf(stderr, "%s: corrupt bloom filter\n", path.c_str());
+		return false;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: readBlock
+ *
+ * DESCRIPTION: Read data block blockIndex into buffer
+ */
+bool SortedRun::readBlock(size_t blockIndex, string &buffer) const {
+	const IndexEntry &entry = index[blockIndex];
+	buffer.resize(entry.size);
+	if ( !readFully(fd, &buffer[0], entry.size, entry.offset) ) {
+		perror(path.c_str());
+		return false;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: findBlock
+ *
+ * RETURNS:
+ * the number of blocks whose first key is not greater than key; key can
+ * only be in the last of them
+ */
+size_t SortedRun::findBlock(string_view key) const {
+	size_t low = 0;
+	size_t high = index.size();
+	while ( low < high ) {
+		size_t middle = (low + high) / 2;
+		if ( string_view(index[middle].firstKey) <= key ) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/**
+ * FUNCTION NAME: decode
+ *
+ * DESCRIPTION: Decode the record at offset of block. The key and the entry's
+ * 				value are views of block.
+ */
+bool SortedRun::decode(string_view block, size_t offset, string_view &key, Entry &entry) {
+	if ( offset + RUN_RECORD_HEADER > block.size() ) {
+		return false;
+	}
+	const char *header = block.data() + offset;
+	uint32_t keySize = getU32(header);
+	uint32_t valueSize = getU32(header + 4);
+	if ( offset + RUN_RECORD_HEADER + keySize + valueSize > block.size() ) {
+		return false;
+	}
+	key = block.substr(offset + RUN_RECORD_HEADER, keySize);
+	entry = Entry(block.substr(offset + RUN_RECORD_HEADER + keySize, valueSize), getU64(header + 8),
+			(ReplicaType) header[16], getU32(header + 18));
+	if ( header[17] & RUN_FLAG_BLOB ) {
+		entry.setBlob(entry.value());
+	}
+	entry.setTombstone((header[17] & RUN_FLAG_TOMBSTONE) != 0);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: get
+ *
+ * DESCRIPTION: Look key up. On success the entry's value is a view of buffer.
+ *
+ * RETURNS:
+ * true if the run holds a record (possibly a tombstone) for key
+ */
+bool SortedRun::get(string_view key, Entry &entry, string &buffer) const {
+	if ( !bloom.mayContain(key) ) {
+		return false;
+	}
+	size_t blocks = findBlock(key);
+	if ( blocks == 0 || !readBlock(blocks - 1, buffer) ) {
+		return false;
+	}
+	string_view stored;
+	for ( size_t offset = 0; decode(buffer, offset, stored, entry); ) {
+		if ( stored == key ) {
+			return true;
+		}
+		if ( stored > key ) {
+			return false;
+		}
+		offset += RUN_RECORD_HEADER + stored.size() + entry.value().size();
+	}
+	return false;
+}
+
+bool SortedRun::mayContain(string_view key) const {
+	return bloom.mayContain(key);
+}
+
+SortedRun::Iterator SortedRun::begin() const {
+	return Iterator(this, 0);
+}
+
+/**
+ * FUNCTION NAME: lowerBound
+ *
+ * DESCRIPTION: Iterator at the first record whose key is not less than key
+ */
+SortedRun::Iterator SortedRun::lowerBound(string_view key) const {
+	size_t blocks = findBlock(key);
+	Iterator it(this, blocks == 0 ? 0 : blocks - 1);
+	while ( it.valid() && it.key() < key ) {
+		it.next();
+	}
+	return it;
+}
+
+size_t SortedRun::keyCount() const {
+	return keys;
+}
+
+uint64_t SortedRun::fileSize() const {
+	return size;
+}
+
+const string& SortedRun::getPath() const {
+	return path;
+}
+
+/**
+ * Iterator constructors
+ */
+SortedRun::Iterator::Iterator(): run(NULL), blockIndex(0), offset(string::npos) {}
+
+SortedRun::Iterator::Iterator(const SortedRun *run, size_t blockIndex): run(run), blockIndex(blockIndex) {
+	loadBlock();
+}
+
+void SortedRun::Iterator::loadBlock() {
+	offset = string::npos;
+	if ( blockIndex < run->index.size() && run->readBlock(blockIndex, block) && !block.empty() ) {
+		offset = 0;
+	}
+}
+
+bool SortedRun::Iterator::valid() const {
+	return offset != string::npos;
+}
+
+string_view SortedRun::Iterator::key() const {
+	return string_view(block).substr(offset + RUN_RECORD_HEADER, getU32(block.data() + offset));
+}
+
+Entry SortedRun::Iterator::entry() const {
+	string_view key;
+	Entry entry;
+	decode(block, offset, key, entry);
+	return entry;
+}
+
+void SortedRun::Iterator::next() {
+	offset += RUN_RECORD_HEADER + getU32(block.data() + offset) + getU32(block.data() + offset + 4);
+	if ( offset >= block.size() ) {
+		blockIndex++;
+		loadBlock();
+	}
+}
@@ -0,0 +1,138 @@
+/**********************************
+ * FILE NAME: SortedRun.h
+ *
+ * DESCRIPTION: Header file of the SortedRun and SortedRunWriter classes
+ **********************************/
+
+#ifndef SORTEDRUN_H_
+#define SORTEDRUN_H_
+
+#include "stdincludes.h"
+#include "Entry.h"
+#include "BloomFilter.h"
+#include <stdint.h>
+
+/*
+ * Macros
+ */
+// a data block is closed once it holds at least this many bytes
+#define RUN_BLOCK_SIZE 4096
+#define RUN_MAGIC 0x324e5552534d534cULL
+// record header: key size, value size, version, replica, flags, expiry tick
+#define RUN_RECORD_HEADER 22
+// record flags: a deleted key; a value log pointer in place of the value
+#define RUN_FLAG_TOMBSTONE 1
+#define RUN_FLAG_BLOB 2
+// footer: index offset and size, bloom offset and size, key count, magic
+#define RUN_FOOTER_SIZE 48
+
+/*
+ * Sorted run file layout (integers in host byte order):
+ *
+ * 		data blocks		records in key order, each a RUN_RECORD_HEADER
+ * 						followed by the key and value bytes
+ * 		block index		per block: u32 key size, first key, u64 offset, u32 size
+ * 		bloom filter	BloomFilter::bytes() of every key in the run
+ * 		footer			RUN_FOOTER_SIZE bytes
+ */
+
+/**
+ * CLASS NAME: SortedRunWriter
+ *
+ * DESCRIPTION: Writes one sorted run file. Keys must be added in strictly
+ * 				increasing order. The file is synced to disk by finish();
+ * 				a writer destroyed before finish() removes its file.
+ */
+class SortedRunWriter {
+public:
+	SortedRunWriter();
+	virtual ~SortedRunWriter();
+	bool open(const string &path, size_t expectedKeys);
+	bool add(string_view key, const Entry &entry);
+	bool finish();
+	size_t keyCount() const;
+	const string& getPath() const;
+private:
+	FILE *file;
+	string path;
+	uint64_t offset;
+	size_t keys;
+	string block;
+	string blockFirstKey;
+	string index;
+	BloomFilter bloom;
+	bool failed;
+	SortedRunWriter(const SortedRunWriter &anotherWriter);
+	SortedRunWriter& operator =(const SortedRunWriter &anotherWriter);
+	bool flushBlock();
+	bool write(string_view bytes);
+};
+
+/**
+ * CLASS NAME: SortedRun
+ *
+ * DESCRIPTION: Read side of an immutable sorted run. The block index and the
+ * 				bloom filter are held in memory; data blocks are read with
+ * 				pread, so one run can serve several threads at once.
+ * 				A point lookup costs at most one block read, and none when the
+ * 				bloom filter rules the key out.
+ */
+class SortedRun {
+private:
+	struct IndexEntry {
+		string firstKey;
+		uint64_t offset;
+		uint32_t size;
+	};
+public:
+	/**
+	 * CLASS NAME: Iterator
+	 *
+	 * DESCRIPTION: Walks the records of a run in key order, one block in
+	 * 				memory at a time. key() and entry() refer to that block
+	 * 				and change with next().
+	 */
+	class Iterator {
+	public:
+		Iterator();
+		bool valid() const;
+		string_view key() const;
+		Entry entry() const;
+		void next();
+	private:
+		friend class SortedRun;
+		const SortedRun *run;
+		size_t blockIndex;
+		string block;
+		// offset of the current record in block, or npos past the end
+		size_t offset;
+		Iterator(const SortedRun *run, size_t blockIndex);
+		void loadBlock();
+	};
+
+	SortedRun();
+	virtual ~SortedRun();
+	bool open(const string &path);
+	// newest record of key in this run, tombstones included
+	bool get(string_view key, Entry &entry, string &buffer) const;
+	bool mayContain(string_view key) const;
+	Iterator begin() const;
+	Iterator lowerBound(string_view key) const;
+	size_t keyCount() const;
+	uint64_t fileSize() const;
+	const string& getPath() const;
+private:
+	int fd;
+	string path;
+	uint64_t size;
+	size_t keys;
+	vector<IndexEntry> index;
+	BloomFilter bloom;
+	SortedRun(const SortedRun &anotherRun);
+	SortedRun& operator =(const SortedRun &anotherRun);
+	bool readBlock(size_t blockIndex, string &buffer) const;
+	size_t findBlock(string_view key) const;
+	static bool decode(string_view block, size_t offset, string_view &key, Entry &entry);
+};
+
+#endif /* SORTEDRUN_H_ */
@@ -0,0 +1,187 @@
+/**********************************
+ * FILE NAME: SpaceSaving.cpp
+ *
+ * DESCRIPTION: SpaceSaving class definition
+ **********************************/
+
+#include "SpaceSaving.h"
+
+/**
+ * Constructor
+ */
+SpaceSaving::SpaceSaving(size_t capacity): capacity(capacity), lowest(-1), highest(-1) {
+	assert(capacity > 0);
+	counters.reserve(capacity);
+	buckets.reserve(capacity);
+	monitored.reserve(capacity);
+}
+
+/**
+ * FUNCTION NAME: offer
+ *
+ * DESCRIPTION: Count one occurrence of key. An unmonitored key replaces the
+ * 				key with the lowest count once every counter is taken.
+ */
+void SpaceSaving::offer(string_view key) {
+	Key candidate(key);
+	FlatHashMap<Key, int, InlineKeyHash<KEY_INLINE_BYTES> >::iterator search = monitored.find(candidate);
+	if ( search != monitored.end() ) {
+		increment(search->second);
+		return;
+	}
+	int counter;
+	if ( counters.size() < capacity ) {
+		counter = (int) counters.size();
+		counters.push_back(Counter());
+		counters[counter].error = 0;
+		counters[counter].bucket = -1;
+	}
+	else {
+		// the counter stays in its bucket, so the key starts from its count
+		counter = buckets[lowest].first;
+		monitored.erase(counters[counter].key);
+		counters[counter].error = buckets[lowest].count;
+	}
+	counters[counter].key = candidate;
+	monitored.emplace(candidate, counter);
+	increment(counter);
+}
+
+/**
+ * FUNCTION NAME: increment
+ *
+ * DESCRIPTION: Move a counter into the bucket of its count plus one: the next
+ * 				bucket up, or a new one linked in right above its own. A new
+ * 				counter goes into the bucket of count 1.
+ */
+void SpaceSaving::increment(int counter) {
+	int from = counters[counter].bucket;
+	uint64_t count = from < 0 ? 1 : buckets[from].count + 1;
+	int next = from < 0 ? lowest : buckets[from].next;
+	int to = next;
+	if ( to < 0 || buckets[to].count != count ) {
+		to = newBucket(count, from, next);
+	}
+	if ( from >= 0 ) {
+		detach(counter);
+	}
+	attach(counter, to);
+}
+
+/**
+ * FUNCTION NAME: newBucket
+ *
+ * DESCRIPTION: Link an empty bucket of count between prev and next
+ */
+int SpaceSaving::newBucket(uint64_t count, int prev, int next) {
+	int bucket;
+	if ( !freeBuckets.empty() ) {
+		bucket = freeBuckets.back();
+		freeBuckets.pop_back();
+	}
+	else {
+		bucket = (int) buckets.size();
+		buckets.push_back(Bucket());
+	}
+	buckets[bucket].count = count;
+	buckets[bucket].first = -1;
+	buckets[bucket].prev = prev;
+	buckets[bucket].next = next;
+	if ( prev >= 0 ) {
+		buckets[prev].next = bucket;
+	}
+	else {
+		lowest = bucket;
+	}
+	if ( next >= 0 ) {
+		buckets[next].prev = bucket;
+	}
+	else {
+		highest = bucket;
+	}
+	return bucket;
+}
+
+void SpaceSaving::attach(int counter, int bucket) {
+	Counter &c = counters[counter];
+	c.bucket = bucket;
+	c.prev = -1;
+	c.next = buckets[bucket].first;
+	if ( c.next >= 0 ) {
+		counters[c.next].prev = counter;
+	}
+	buckets[bucket].first = counter;
+}
+
+/**
+ * FUNCTION NAME: detach
+ *
+ * DESCRIPTION: Take a counter out of its bucket, unlinking the bucket if
+ * 				that leaves it empty
+ */
+void SpaceSaving::detach(int counter) {
+	Counter &c = counters[counter];
+	Bucket &b = buckets[c.bucket];
+	if ( c.prev >= 0 ) {
+		counters[c.prev].next = c.next;
+	}
+	else {
+		b.first = c.next;
+	}
+	if ( c.next >= 0 ) {
+		counters[c.next].prev = c.prev;
+	}
+	if ( b.first < 0 ) {
+		if ( b.prev >= 0 ) {
+			buckets[b.prev].next = b.next;
+		}
+		else {
+			lowest = b.next;
+		}
+		if ( b.next >= 0 ) {
+			buckets[b.next].prev = b.prev;
+		}
+		else {
+			highest = b.prev;
+		}
+		freeBuckets.push_back(c.bucket);
+	}
+	c.bucket = -1;
+}
+
+/**
+ * FUNCTION NAME: top
+ *
+ * DESCRIPTION: Walk the buckets down from the highest count
+ */
+vector<HotKey> SpaceSaving::top(size_t n) const {
+	vector<HotKey> hot;
+	for ( int bucket = highest; bucket >= 0 && hot.size() < n; bucket = buckets[bucket].prev ) {
+		for ( int counter = buckets[bucket].first; counter >= 0 && hot.size() < n; counter = counters[counter].next ) {
+			HotKey key;
+			key.key = counters[counter].key;
+			key.count = buckets[bucket].count;
+			key.error = counters[counter].error;
+			hot.push_back(key);
+		}
+	}
+	return hot;
+}
+
+uint64_t SpaceSaving::count(string_view key) const {
+	FlatHashMap<Key, int, InlineKeyHash<KEY_INLINE_BYTES> >::const_iterator search = monitored.find(Key(key));
+	return search == monitored.end() ? 0 : buckets[counters[search->second].bucket].count;
+}
+
+size_t SpaceSaving::size() const {
+	return counters.size();
+}
+
+void SpaceSaving::clear() {
+	counters.clear();
+	buckets.clear();
+	freeBuckets.clear();
+	monitored.clear();
+	lowest = -1;
+	highest = -1;
+}
@@ -0,0 +1,81 @@
+/**********************************
+ * FILE NAME: SpaceSaving.h
+ *
+ * DESCRIPTION: Header file of the SpaceSaving class
+ **********************************/
+
+#ifndef SPACESAVING_H_
+#define SPACESAVING_H_
+
+#include "stdincludes.h"
+#include "FlatHashMap.h"
+#include "InlineKey.h"
+#include <stdint.h>
+
+/*
+ * Macros
+ */
+// keys monitored; any key seen more than 1/HOT_KEYS_TRACKED of the time is among them
+#define HOT_KEYS_TRACKED 64
+// hot keys each node logs at exit
+#define HOT_KEYS_LOGGED 3
+
+// a monitored key: count is at most error above the true count
+struct HotKey {
+	string key;
+	uint64_t count;
+	uint64_t error;
+};
+
+/**
+ * CLASS NAME: SpaceSaving
+ *
+ * DESCRIPTION: Top-k frequent keys of a stream in the memory of k counters
+ * 				(Space-Saving). A key that is not monitored takes over the
+ * 				counter with the lowest count, inheriting that count as its
+ * 				possible overcount. Counters sit in buckets of equal count,
+ * 				kept in a list ordered by count (the stream-summary), so an
+ * 				increment moves the counter to the neighbouring bucket and
+ * 				every offer costs O(1).
+ */
+class SpaceSaving {
+public:
+	explicit SpaceSaving(size_t capacity = HOT_KEYS_TRACKED);
+	void offer(string_view key);
+	// the n keys with the highest counts, highest first
+	vector<HotKey> top(size_t n) const;
+	// count of a monitored key, 0 for any other
+	uint64_t count(string_view key) const;
+	size_t size() const;
+	void clear();
+private:
+	struct Counter {
+		Key key;
+		uint64_t error;
+		int bucket;
+		// neighbours in the bucket
+		int prev;
+		int next;
+	};
+	struct Bucket {
+		uint64_t count;
+		// first counter with this count
+		int first;
+		// neighbours with the next lower and next higher counts
+		int prev;
+		int next;
+	};
+	size_t capacity;
+	vector<Counter> counters;
+	vector<Bucket> buckets;
+	vector<int> freeBuckets;
+	int lowest;
+	int highest;
+	FlatHashMap<Key, int, InlineKeyHash<KEY_INLINE_BYTES> > monitored;
+	void increment(int counter);
+	int newBucket(uint64_t count, int prev, int next);
+	void attach(int counter, int bucket);
+	void detach(int counter);
+};
+
+#endif /* SPACESAVING_H_ */
@@ -0,0 +1,126 @@
+/**********************************
+ * FILE NAME: SpillFile.cpp
+ *
+ * DESCRIPTION: SpillFile class definition
+ **********************************/
+
+#include "SpillFile.h"
+#include <errno.h>
+
+/**
+ * Constructor
+ */
+SpillFile::SpillFile(): fd(-1), written(0), live(0), dead(0) {}
+
+/**
+ * Destructor
+ */
+SpillFile::~SpillFile() {
+	if ( fd >= 0 ) {
+		close(fd);
+	}
+}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Create an anonymous spill file in directory
+ */
+bool SpillFile::open(const string &directory) {
+	path = directory + "/spill.XXXXXX";
+	fd = mkstemp(&path[0]);
+	if ( fd < 0 ) {
+		perror(path.c_str());
+		return false;
+	}
+	unlink(path.c_str());
+	return true;
+}
+
+uint64_t SpillFile::append(string_view value) {
+	uint64_t offset = written + pending.size();
+	pending.append(value.data(), value.size());
+	live += value.size();
+	return offset;
+}
+
+/**
+ * FUNCTION NAME: flush
+ *
+ * DESCRIPTION: Write the buffered values at the end of the file
+ *
+ * RETURNS:
+ * false on an I/O error, in which case the buffered values are lost and
+ * their offsets will be handed out again
+ */
+bool SpillFile::flush() {
+	size_t done = 0;
+	while ( done < pending.size() ) {
+		ssize_t bytes = pwrite(fd, pending.data() + done, pending.size() - done, written + done);
+		if ( bytes < 0 && errno == EINTR ) {
+			continue;
+		}
+		if ( bytes <= 0 ) {
+			perror(path.c_str());
+			live -= pending.size();
+			pending.clear();
+			return false;
+		}
+		done += bytes;
+	}
+	written += pending.size();
+	pending.clear();
+	return true;
+}
+
+/**
+ * FUNCTION NAME: read
+ *
+ * DESCRIPTION: Read size bytes at offset into value
+ */
+bool SpillFile::read(uint64_t offset, size_t size, string &value) const {
+	value.resize(size);
+	size_t done = 0;
+	while ( done < size ) {
+		ssize_t bytes = pread(fd, &value[done], size - done, offset + done);
+		if ( bytes < 0 && errno == EINTR ) {
+			continue;
+		}
+		if ( bytes <= 0 ) {
+			perror(path.c_str());
+			return false;
+		}
+		done += bytes;
+	}
+	return true;
+}
+
+void SpillFile::release(size_t size) {
+	live -= size;
+	dead += size;
+}
+
+bool SpillFile::shouldCompact() const {
+	return dead > live && dead >= SPILL_COMPACT_MIN_BYTES;
+}
+
+void SpillFile::swap(SpillFile &anotherFile) {
+	std::swap(fd, anotherFile.fd);
+	path.swap(anotherFile.path);
+	std::swap(written, anotherFile.written);
+	pending.swap(anotherFile.pending);
+	std::swap(live, anotherFile.live);
+	std::swap(dead, anotherFile.dead);
+}
+
+uint64_t SpillFile::liveBytes() const {
+	return live;
+}
+
+uint64_t SpillFile::deadBytes() const {
+	return dead;
+}
+
+size_t SpillFile::pendingBytes() const {
+	return pending.size();
+}
@@ -0,0 +1,62 @@
+/**********************************
+ * FILE NAME: SpillFile.h
+ *
+ * DESCRIPTION: Header file of the SpillFile class
+ **********************************/
+
+#ifndef SPILLFILE_H_
+#define SPILLFILE_H_
+
+#include "stdincludes.h"
+#include <stdint.h>
+
+/*
+ * Macros
+ */
+// the spill file is rewritten once dead bytes outnumber live ones beyond this size
+#define SPILL_COMPACT_MIN_BYTES (4 << 20)
+// buffered bytes a rewrite of the file holds before writing them out
+#define SPILL_FLUSH_BYTES (1 << 20)
+
+/**
+ * CLASS NAME: SpillFile
+ *
+ * DESCRIPTION: Append-only scratch file holding values evicted from memory.
+ * 				The file is unlinked as soon as it is created: it only extends
+ * 				the memory of the running table and is gone when it closes.
+ * 				Appends are buffered until flush, so a batch of evictions costs
+ * 				one write; a value is read back with one pread. Overwritten
+ * 				and faulted-in values leave dead bytes behind, counted so the
+ * 				owner knows when to rewrite the file.
+ */
+class SpillFile {
+public:
+	SpillFile();
+	virtual ~SpillFile();
+	bool open(const string &directory);
+	// buffer value at the end of the file; returns its offset
+	uint64_t append(string_view value);
+	// write the buffered values out; on failure they are dropped
+	bool flush();
+	bool read(uint64_t offset, size_t size, string &value) const;
+	// the value at some offset is no longer needed
+	void release(size_t size);
+	bool shouldCompact() const;
+	void swap(SpillFile &anotherFile);
+	uint64_t liveBytes() const;
+	uint64_t deadBytes() const;
+	size_t pendingBytes() const;
+private:
+	int fd;
+	// name the file was created under, for error messages
+	string path;
+	// bytes written to the file; buffered bytes follow
+	uint64_t written;
+	string pending;
+	uint64_t live;
+	uint64_t dead;
+	SpillFile(const SpillFile &anotherFile);
+	SpillFile& operator =(const SpillFile &anotherFile);
+};
+
+#endif /* SPILLFILE_H_ */
@@ -0,0 +1,116 @@
+/**********************************
+ * FILE NAME: TimingWheel.cpp
+ *
+ * DESCRIPTION: TimingWheel class definition
+ **********************************/
+
+#include "TimingWheel.h"
+
+/**
+ * Constructor
+ */
+TimingWheel::TimingWheel(): now(0), timers(0) {}
+
+/**
+ * FUNCTION NAME: place
+ *
+ * DESCRIPTION: Put a timer in the slot of the lowest level whose current
+ * 				span holds its tick, or queue it if it is already due
+ */
+void TimingWheel::place(Timer &timer) {
+	if ( timer.expiresAt <= now ) {
+		due.push_back(std::move(timer));
+		return;
+	}
+	for ( int level = 0; level < WHEEL_LEVELS; level++ ) {
+		int shift = WHEEL_BITS * (level + 1);
+		// same slot of every level above: it fits in this one
+		if ( shift >= 32 || (timer.expiresAt >> shift) == (now >> shift) ) {
+			uint32_t slot = (timer.expiresAt >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+			slots[level][slot].push_back(std::move(timer));
+			return;
+		}
+	}
+	// beyond the top level: park in its last slot before the current one
+	uint32_t top = WHEEL_BITS * (WHEEL_LEVELS - 1);
+	slots[WHEEL_LEVELS - 1][((now >> top) - 1) & (WHEEL_SLOTS - 1)].push_back(std::move(timer));
+}
+
+void TimingWheel::schedule(string_view key, uint32_t expiresAt) {
+	Timer timer;
+	timer.key.assign(key);
+	timer.expiresAt = expiresAt;
+	place(timer);
+	timers++;
+}
+
+/**
+ * FUNCTION NAME: cascade
+ *
+ * DESCRIPTION: Re-place the timers of the level slot the clock just entered
+ */
+void TimingWheel::cascade(int level) {
+	vector<Timer> moving;
+	moving.swap(slots[level][(now >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)]);
+	for ( size_t i = 0; i < moving.size(); i++ ) {
+		place(moving[i]);
+	}
+}
+
+/**
+ * FUNCTION NAME: advance
+ *
+ * DESCRIPTION: Tick the clock forward to now. On every tick the level 0 slot
+ * 				is queued; crossing a level boundary first cascades the
+ * 				higher level slots, highest first.
+ */
+void TimingWheel::advance(uint32_t now) {
+	while ( this->now < now ) {
+		this->now++;
+		int level = 0;
+		while ( level + 1 < WHEEL_LEVELS && (this->now & ((1U << (WHEEL_BITS * (level + 1))) - 1)) == 0 ) {
+			level++;
+		}
+		for ( ; level > 0; level-- ) {
+			cascade(level);
+		}
+		vector<Timer> &slot = slots[0][this->now & (WHEEL_SLOTS - 1)];
+		for ( size_t i = 0; i < slot.size(); i++ ) {
+			due.push_back(std::move(slot[i]));
+		}
+		slot.clear();
+	}
+}
+
+bool TimingWheel::pop(Timer &timer) {
+	if ( due.empty() ) {
+		return false;
+	}
+	timer = std::move(due.front());
+	due.pop_front();
+	timers--;
+	return true;
+}
+
+uint32_t TimingWheel::getTime() const {
+	return now;
+}
+
+size_t TimingWheel::size() const {
+	return timers;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Drop every timer; the clock keeps its time
+ */
+void TimingWheel::clear() {
+	for ( int level = 0; level < WHEEL_LEVELS; level++ ) {
+		for ( int slot = 0; slot < WHEEL_SLOTS; slot++ ) {
+			vector<Timer>().swap(slots[level][slot]);
+		}
+	}
+	due.clear();
+	timers = 0;
+}
@@ -0,0 +1,65 @@
+/**********************************
+ * FILE NAME: TimingWheel.h
+ *
+ * DESCRIPTION: Header file of the TimingWheel class
+ **********************************/
+
+#ifndef TIMINGWHEEL_H_
+#define TIMINGWHEEL_H_
+
+#include "stdincludes.h"
+#include <stdint.h>
+#include <deque>
+
+/*
+ * Macros
+ */
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+// 64^4 ticks ahead; later timers wait in the last slot of the top level
+#define WHEEL_LEVELS 4
+// expired keys reclaimed per tick
+#define EXPIRE_KEYS_PER_TICK 256
+
+/**
+ * CLASS NAME: TimingWheel
+ *
+ * DESCRIPTION: Hierarchical timing wheel of key expiry ticks. Level 0 has one
+ * 				slot per tick; a slot of level L covers 64^L ticks. A timer
+ * 				goes to the lowest level whose span reaches its tick, and when
+ * 				the clock enters a higher level slot its timers are cascaded
+ * 				down. Scheduling is O(1), and advancing costs one level 0 slot
+ * 				per tick plus one cascade every 64 ticks, however many timers
+ * 				there are.
+ *
+ * 				Due timers are queued rather than returned, so the owner can
+ * 				drain them a bounded number at a time. Timers are never
+ * 				cancelled: the owner checks a popped timer against the key's
+ * 				current expiry and drops it if the key was rewritten.
+ */
+class TimingWheel {
+public:
+	struct Timer {
+		string key;
+		uint32_t expiresAt;
+	};
+	TimingWheel();
+	void schedule(string_view key, uint32_t expiresAt);
+	// move the clock to now, queueing every timer due by then
+	void advance(uint32_t now);
+	// next due timer; false when none is queued
+	bool pop(Timer &timer);
+	uint32_t getTime() const;
+	// timers scheduled or queued, including ones that went stale
+	size_t size() const;
+	void clear();
+private:
+	vector<Timer> slots[WHEEL_LEVELS][WHEEL_SLOTS];
+	deque<Timer> due;
+	uint32_t now;
+	size_t timers;
+	void place(Timer &timer);
+	void cascade(int level);
+};
+
+#endif /* TIMINGWHEEL_H_ */
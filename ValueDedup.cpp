@@ -0,0 +1,174 @@
+/**********************************
+ * FILE NAME: ValueDedup.cpp
+ *
+ * DESCRIPTION: ValueDedup class definition
+ **********************************/
+
+#include "ValueDedup.h"
+
+/*
+ * Reference count of a shared value, kept in the header bytes in front of it
+ */
+static uint32_t getRefs(string_view value) {
+	uint32_t refs;
+	memcpy(&refs, value.data() - DEDUP_HEADER, sizeof(refs));
+	return refs;
+}
+
+static void setRefs(string_view value, uint32_t refs) {
+	memcpy(const_cast<char *>(value.data()) - DEDUP_HEADER, &refs, sizeof(refs));
+}
+
+static uint64_t rotl(uint64_t x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t fmix(uint64_t k) {
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+	return k;
+}
+
+/**
+ * Constructor
+ */
+ValueDedup::ValueDedup(): refs(0), stored(0), referenced(0) {}
+
+/**
+ * FUNCTION NAME: hash
+ *
+ * DESCRIPTION: MurmurHash3 x64 128 of the value bytes (seed 0): two 64-bit
+ * 				lanes mixing 16 bytes per round
+ */
+ContentHash ValueDedup::hash(string_view value) {
+	const uint64_t c1 = 0x87c37b91114253d5ULL;
+	const uint64_t c2 = 0x4cf5ad432745937fULL;
+	const unsigned char *data = (const unsigned char *) value.data();
+	size_t size = value.size();
+	size_t blocks = size / 16;
+	uint64_t h1 = 0;
+	uint64_t h2 = 0;
+	for ( size_t i = 0; i < blocks; i++ ) {
+		uint64_t k1, k2;
+		memcpy(&k1, data + 16 * i, 8);
+		memcpy(&k2, data + 16 * i + 8, 8);
+		h1 ^= rotl(k1 * c1, 31) * c2;
+		h1 = (rotl(h1, 27) + h2) * 5 + 0x52dce729;
+		h2 ^= rotl(k2 * c2, 33) * c1;
+		h2 = (rotl(h2, 31) + h1) * 5 + 0x38495ab5;
+	}
+	const unsigned char *tail = data + 16 * blocks;
+	uint64_t k1 = 0;
+	uint64_t k2 = 0;
+	switch ( size & 15 ) {
+		case 15: k2 ^= (uint64_t) tail[14] << 48; // fall through
+		case 14: k2 ^= (uint64_t) tail[13] << 40; // fall through
+		case 13: k2 ^= (uint64_t) tail[12] << 32; // fall through
+		case 12: k2 ^= (uint64_t) tail[11] << 24; // fall through
+		case 11: k2 ^= (uint64_t) tail[10] << 16; // fall through
+		case 10: k2 ^= (uint64_t) tail[9] << 8; // fall through
+		case 9: k2 ^= (uint64_t) tail[8];
+			h2 ^= rotl(k2 * c2, 33) * c1;
+			// fall through
+		case 8: k1 ^= (uint64_t) tail[7] << 56; // fall through
+		case 7: k1 ^= (uint64_t) tail[6] << 48; // fall through
+		case 6: k1 ^= (uint64_t) tail[5] << 40; // fall through
+		case 5: k1 ^= (uint64_t) tail[4] << 32; // fall through
+		case 4: k1 ^= (uint64_t) tail[3] << 24; // fall through
+		case 3: k1 ^= (uint64_t) tail[2] << 16; // fall through
+		case 2: k1 ^= (uint64_t) tail[1] << 8; // fall through
+		case 1: k1 ^= (uint64_t) tail[0];
+			h1 ^= rotl(k1 * c1, 31) * c2;
+	}
+	h1 ^= size;
+	h2 ^= size;
+	h1 += h2;
+	h2 += h1;
+	h1 = fmix(h1);
+	h2 = fmix(h2);
+	h1 += h2;
+	h2 += h1;
+	ContentHash result;
+	result.low = h1;
+	result.high = h2;
+	return result;
+}
+
+/**
+ * FUNCTION NAME: acquire
+ *
+ * DESCRIPTION: Take a reference to the shared copy of value, storing it
+ * 				first if no equal value is stored yet
+ *
+ * RETURNS:
+ * a view of the copy, valid until its last reference is released
+ */
+string_view ValueDedup::acquire(string_view value) {
+	ContentHash h = hash(value);
+	FlatHashMap<ContentHash, string_view, ContentHashHash>::iterator search = values.find(h);
+	refs++;
+	referenced += value.size();
+	if ( search != values.end() && search->second == value ) {
+		setRefs(search->second, getRefs(search->second) + 1);
+		return search->second;
+	}
+	char *block = arena.allocate(DEDUP_HEADER + value.size());
+	memcpy(block + DEDUP_HEADER, value.data(), value.size());
+	string_view copy(block + DEDUP_HEADER, value.size());
+	setRefs(copy, 1);
+	stored += DEDUP_HEADER + value.size();
+	// on a collision the copy stays private to its entry
+	if ( search == values.end() ) {
+		values.emplace(h, copy);
+	}
+	return copy;
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Drop a reference to a copy returned by acquire, freeing the
+ * 				copy with its last reference
+ */
+void ValueDedup::release(string_view value) {
+	uint32_t left = getRefs(value) - 1;
+	refs--;
+	referenced -= value.size();
+	if ( left > 0 ) {
+		setRefs(value, left);
+		return;
+	}
+	FlatHashMap<ContentHash, string_view, ContentHashHash>::iterator search = values.find(hash(value));
+	if ( search != values.end() && search->second.data() == value.data() ) {
+		values.erase(search);
+	}
+	stored -= DEDUP_HEADER + value.size();
+	arena.deallocate(const_cast<char *>(value.data()) - DEDUP_HEADER, DEDUP_HEADER + value.size());
+}
+
+void ValueDedup::clear() {
+	values.clear();
+	arena.clear();
+	refs = 0;
+	stored = 0;
+	referenced = 0;
+}
+
+size_t ValueDedup::uniqueValues() const {
+	return values.size();
+}
+
+unsigned long ValueDedup::references() const {
+	return refs;
+}
+
+size_t ValueDedup::bytesStored() const {
+	return stored;
+}
+
+size_t ValueDedup::bytesReferenced() const {
+	return referenced;
+}
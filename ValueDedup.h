@@ -0,0 +1,76 @@
+/**********************************
+ * FILE NAME: ValueDedup.h
+ *
+ * DESCRIPTION: Header file of the ValueDedup class
+ **********************************/
+
+#ifndef VALUEDEDUP_H_
+#define VALUEDEDUP_H_
+
+#include "stdincludes.h"
+#include "SlabArena.h"
+#include "FlatHashMap.h"
+#include <stdint.h>
+
+/*
+ * Macros
+ */
+// reference count in front of every shared value
+#define DEDUP_HEADER 4
+
+// 128-bit hash of a value's bytes
+struct ContentHash {
+	uint64_t low;
+	uint64_t high;
+	bool operator ==(const ContentHash &another) const {
+		return low == another.low && high == another.high;
+	}
+};
+
+class ContentHashHash {
+public:
+	size_t operator ()(const ContentHash &hash) const {
+		return (size_t) hash.low;
+	}
+};
+
+/**
+ * CLASS NAME: ValueDedup
+ *
+ * DESCRIPTION: Content-addressed store of the values of a table, each
+ * 				distinct value kept once. A value is looked up by the 128-bit
+ * 				MurmurHash3 of its bytes; entries holding equal values all
+ * 				view the same copy, and a reference count in the DEDUP_HEADER
+ * 				bytes in front of it frees the copy with its last reference.
+ * 				A hit is confirmed by comparing bytes, so a hash collision
+ * 				costs a private copy, never a wrong value.
+ * 				The copies live in an arena of their own, which the table's
+ * 				compaction leaves alone.
+ */
+class ValueDedup {
+public:
+	ValueDedup();
+	// the shared copy of value, with one more reference
+	string_view acquire(string_view value);
+	// drop a reference taken by acquire
+	void release(string_view value);
+	void clear();
+	// distinct values stored
+	size_t uniqueValues() const;
+	unsigned long references() const;
+	// value bytes kept, headers included
+	size_t bytesStored() const;
+	// value bytes the references would take as separate copies
+	size_t bytesReferenced() const;
+	static ContentHash hash(string_view value);
+private:
+	SlabArena arena;
+	FlatHashMap<ContentHash, string_view, ContentHashHash> values;
+	unsigned long refs;
+	size_t stored;
+	size_t referenced;
+	ValueDedup(const ValueDedup &anotherDedup);
+	ValueDedup& operator =(const ValueDedup &anotherDedup);
+};
+
+#endif /* VALUEDEDUP_H_ */
@@ -0,0 +1,238 @@
+/**********************************
+ * FILE NAME: ValueDictionary.cpp
+ *
+ * DESCRIPTION: ValueDictionary class definition
+ **********************************/
+
+#include "ValueDictionary.h"
+#include <unordered_map>
+
+// codes counted while training: symbols, then 256 + byte for escaped bytes
+#define DICT_TRAIN_CODES 512
+
+/**
+ * Constructor: an untrained dictionary compresses nothing
+ */
+ValueDictionary::ValueDictionary(): trained(false), count(0), compressions(0), bytesIn(0), bytesOut(0) {
+	memset(symbol, 0, sizeof(symbol));
+	memset(symbolWord, 0, sizeof(symbolWord));
+	memset(length, 0, sizeof(length));
+	for ( int bytes = 0; bytes <= DICT_SYMBOL_BYTES; bytes++ ) {
+		mask[bytes] = bytes == DICT_SYMBOL_BYTES ? ~0ULL : (1ULL << (8 * bytes)) - 1;
+	}
+}
+
+/**
+ * FUNCTION NAME: match
+ *
+ * DESCRIPTION: Longest symbol the size bytes at in start with
+ *
+ * RETURNS:
+ * its code, or -1 if no symbol matches
+ */
+int ValueDictionary::match(const char *in, size_t size) const {
+	const vector<uint8_t> &codes = byFirst[(uint8_t) in[0]];
+	if ( size >= DICT_SYMBOL_BYTES ) {
+		// compare whole words (little-endian): the symbol padding is zero, so mask the input to its length
+		uint64_t word;
+		memcpy(&word, in, DICT_SYMBOL_BYTES);
+		for ( size_t i = 0; i < codes.size(); i++ ) {
+			uint8_t code = codes[i];
+			if ( (word & mask[length[code]]) == symbolWord[code] ) {
+				return code;
+			}
+		}
+		return -1;
+	}
+	for ( size_t i = 0; i < codes.size(); i++ ) {
+		uint8_t code = codes[i];
+		if ( length[code] <= size && memcmp(symbol[code], in, length[code]) == 0 ) {
+			return code;
+		}
+	}
+	return -1;
+}
+
+/**
+ * FUNCTION NAME: build
+ *
+ * DESCRIPTION: Make table the symbol table
+ */
+void ValueDictionary::build(const vector<string> &table) {
+	count = min(table.size(), (size_t) DICT_SYMBOLS);
+	memset(symbol, 0, sizeof(symbol));
+	memset(symbolWord, 0, sizeof(symbolWord));
+	memset(length, 0, sizeof(length));
+	for ( int i = 0; i < 256; i++ ) {
+		byFirst[i].clear();
+	}
+	for ( size_t code = 0; code < count; code++ ) {
+		memcpy(symbol[code], table[code].data(), table[code].size());
+		length[code] = (uint8_t) table[code].size();
+		memcpy(&symbolWord[code], symbol[code], DICT_SYMBOL_BYTES);
+		byFirst[(uint8_t) table[code][0]].push_back((uint8_t) code);
+	}
+	for ( int i = 0; i < 256; i++ ) {
+		sort(byFirst[i].begin(), byFirst[i].end(), [this](uint8_t a, uint8_t b) {
+			return length[a] > length[b];
+		});
+	}
+}
+
+/**
+ * FUNCTION NAME: train
+ *
+ * DESCRIPTION: Grow a symbol table on up to DICT_SAMPLE_BYTES of the sample.
+ * 				Each generation encodes the sample with the table so far and
+ * 				scores every symbol and escaped byte it used, and every
+ * 				concatenation of two adjacent ones (cut to DICT_SYMBOL_BYTES),
+ * 				by the bytes it would have covered. The DICT_SYMBOLS best make
+ * 				the next table, so symbols can double in length each round.
+ */
+void ValueDictionary::train(const vector<string_view> &sample) {
+	vector<string_view> values;
+	size_t bytes = 0;
+	for ( size_t i = 0; i < sample.size() && bytes < DICT_SAMPLE_BYTES; i++ ) {
+		string_view value = sample[i].substr(0, DICT_SAMPLE_BYTES - bytes);
+		if ( !value.empty() ) {
+			values.push_back(value);
+			bytes += value.size();
+		}
+	}
+	build(vector<string>());
+	vector<uint32_t> single(DICT_TRAIN_CODES);
+	unordered_map<uint32_t, uint32_t> pairs;
+	unordered_map<string, uint64_t> gains;
+	vector<pair<uint64_t, string> > ranked;
+	for ( int generation = 0; generation < DICT_GENERATIONS; generation++ ) {
+		fill(single.begin(), single.end(), 0);
+		pairs.clear();
+		for ( size_t i = 0; i < values.size(); i++ ) {
+			string_view value = values[i];
+			int previous = -1;
+			for ( size_t position = 0; position < value.size(); ) {
+				int code = match(value.data() + position, value.size() - position);
+				if ( code < 0 ) {
+					code = 256 + (uint8_t) value[position];
+					position++;
+				}
+				else {
+					position += length[code];
+				}
+				single[code]++;
+				if ( previous >= 0 ) {
+					pairs[previous * DICT_TRAIN_CODES + code]++;
+				}
+				previous = code;
+			}
+		}
+		auto text = [this](int code) {
+			return code >= 256 ? string(1, (char) (code - 256)) : string(symbol[code], length[code]);
+		};
+		gains.clear();
+		for ( int code = 0; code < DICT_TRAIN_CODES; code++ ) {
+			if ( single[code] > 0 ) {
+				string candidate = text(code);
+				gains[candidate] += (uint64_t) single[code] * candidate.size();
+			}
+		}
+		for ( unordered_map<uint32_t, uint32_t>::iterator it = pairs.begin(); it != pairs.end(); ++it ) {
+			string candidate = text(it->first / DICT_TRAIN_CODES) + text(it->first % DICT_TRAIN_CODES);
+			candidate.resize(min(candidate.size(), (size_t) DICT_SYMBOL_BYTES));
+			gains[candidate] += (uint64_t) it->second * candidate.size();
+		}
+		ranked.clear();
+		for ( unordered_map<string, uint64_t>::iterator it = gains.begin(); it != gains.end(); ++it ) {
+			ranked.push_back(make_pair(it->second, it->first));
+		}
+		// highest gain first; ties broken by the bytes so training is deterministic
+		sort(ranked.begin(), ranked.end(), [](const pair<uint64_t, string> &a, const pair<uint64_t, string> &b) {
+			return a.first != b.first ? a.first > b.first : a.second < b.second;
+		});
+		vector<string> table;
+		for ( size_t i = 0; i < ranked.size() && table.size() < DICT_SYMBOLS; i++ ) {
+			table.push_back(ranked[i].second);
+		}
+		build(table);
+	}
+	trained = true;
+}
+
+bool ValueDictionary::isTrained() const {
+	return trained;
+}
+
+size_t ValueDictionary::symbols() const {
+	return count;
+}
+
+/**
+ * FUNCTION NAME: compress
+ *
+ * DESCRIPTION: Encode value with the longest matching symbol at each position
+ *
+ * RETURNS:
+ * true if out holds an encoding shorter than value
+ */
+bool ValueDictionary::compress(string_view value, string &out) {
+	if ( !trained || value.empty() ) {
+		return false;
+	}
+	out.clear();
+	for ( size_t position = 0; position < value.size() && out.size() < value.size(); ) {
+		int code = match(value.data() + position, value.size() - position);
+		if ( code < 0 ) {
+			out.push_back((char) DICT_ESCAPE);
+			out.push_back(value[position]);
+			position++;
+		}
+		else {
+			out.push_back((char) code);
+			position += length[code];
+		}
+	}
+	if ( out.size() >= value.size() ) {
+		return false;
+	}
+	compressions++;
+	bytesIn += value.size();
+	bytesOut += out.size();
+	return true;
+}
+
+/**
+ * FUNCTION NAME: decompress
+ *
+ * DESCRIPTION: Expand each code of encoded: a symbol is copied as a whole
+ * 				DICT_SYMBOL_BYTES word and the output advanced by its length,
+ * 				so decoding never branches on the symbol's size
+ */
+void ValueDictionary::decompress(string_view encoded, string &out) const {
+	out.resize(encoded.size() * DICT_SYMBOL_BYTES);
+	char *next = &out[0];
+	for ( size_t i = 0; i < encoded.size(); i++ ) {
+		uint8_t code = (uint8_t) encoded[i];
+		if ( code == DICT_ESCAPE ) {
+			if ( ++i < encoded.size() ) {
+				*next++ = encoded[i];
+			}
+		}
+		else {
+			memcpy(next, symbol[code], DICT_SYMBOL_BYTES);
+			next += length[code];
+		}
+	}
+	out.resize(next - out.data());
+}
+
+unsigned long ValueDictionary::getCompressions() const {
+	return compressions;
+}
+
+uint64_t ValueDictionary::getBytesIn() const {
+	return bytesIn;
+}
+
+uint64_t ValueDictionary::getBytesOut() const {
+	return bytesOut;
+}
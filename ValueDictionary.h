@@ -0,0 +1,79 @@
+/**********************************
+ * FILE NAME: ValueDictionary.h
+ *
+ * DESCRIPTION: Header file of the ValueDictionary class
+ **********************************/
+
+#ifndef VALUEDICTIONARY_H_
+#define VALUEDICTIONARY_H_
+
+#include "stdincludes.h"
+#include <stdint.h>
+
+/*
+ * Macros
+ */
+// longest symbol
+#define DICT_SYMBOL_BYTES 8
+// codes 0..DICT_SYMBOLS-1 are symbols, DICT_ESCAPE is followed by a literal byte
+#define DICT_SYMBOLS 255
+#define DICT_ESCAPE 255
+// value bytes a dictionary is trained on
+#define DICT_SAMPLE_BYTES (16 << 10)
+// rounds of training
+#define DICT_GENERATIONS 5
+// values a table holds before it trains its dictionary
+#define DICT_TRAIN_VALUES 256
+
+/**
+ * CLASS NAME: ValueDictionary
+ *
+ * DESCRIPTION: Static dictionary compression for small values, in the
+ * 				style of FSST (fast static symbol table). The dictionary is a
+ * 				table of up to DICT_SYMBOLS symbols of 1 to DICT_SYMBOL_BYTES
+ * 				bytes, trained once from a sample of values. A value is encoded
+ * 				as one code byte per symbol, the longest symbol matching at each
+ * 				position; a byte no symbol covers costs DICT_ESCAPE and the byte.
+ * 				Every value is encoded on its own, so any one value decodes
+ * 				without touching the others, by one table lookup and one 8-byte
+ * 				copy per code: tens of nanoseconds for a value of a few hundred
+ * 				bytes.
+ * 				Training grows the table over DICT_GENERATIONS rounds: each
+ * 				round encodes the sample with the current table and keeps the
+ * 				symbols, and the concatenations of adjacent symbols, that cover
+ * 				the most bytes.
+ */
+class ValueDictionary {
+public:
+	ValueDictionary();
+	// build the symbol table from sample values; replaces any earlier one
+	void train(const vector<string_view> &sample);
+	bool isTrained() const;
+	size_t symbols() const;
+	// encode value into out; false if that does not make it shorter
+	bool compress(string_view value, string &out);
+	// decode a value encoded by compress into out
+	void decompress(string_view encoded, string &out) const;
+	// values compressed and their bytes before and after
+	unsigned long getCompressions() const;
+	uint64_t getBytesIn() const;
+	uint64_t getBytesOut() const;
+private:
+	bool trained;
+	size_t count;
+	// symbol bytes, padded with zeros to DICT_SYMBOL_BYTES
+	char symbol[DICT_SYMBOLS][DICT_SYMBOL_BYTES];
+	uint8_t length[DICT_SYMBOLS];
+	// the symbol bytes as a word, and the mask of the low bytes of each length
+	uint64_t symbolWord[DICT_SYMBOLS];
+	uint64_t mask[DICT_SYMBOL_BYTES + 1];
+	// symbol codes by first byte, longest first
+	vector<uint8_t> byFirst[256];
+	unsigned long compressions;
+	uint64_t bytesIn;
+	uint64_t bytesOut;
+	int match(const char *in, size_t size) const;
+	void build(const vector<string> &table);
+};
+
+#endif /* VALUEDICTIONARY_H_ */
@@ -0,0 +1,417 @@
+/**********************************
+ * FILE NAME: ValueLog.cpp
+ *
+ * DESCRIPTION: ValueLog class definition
+ **********************************/
+
+#include "ValueLog.h"
+#include <dirent.h>
+#include <errno.h>
+
+static void putU32(string &out, uint32_t value) {
+	out.append((const char *) &value, sizeof(value));
+}
+
+static void putU64(string &out, uint64_t value) {
+	out.append((const char *) &value, sizeof(value));
+}
+
+static uint32_t getU32(const char *in) {
+	uint32_t value;
+	memcpy(&value, in, sizeof(value));
+	return value;
+}
+
+static uint64_t getU64(const char *in) {
+	uint64_t value;
+	memcpy(&value, in, sizeof(value));
+	return value;
+}
+
+/**
+ * FUNCTION NAME: syncDirectory
+ *
+ * DESCRIPTION: fsync a directory so that a file created in it is durable
+ */
+static bool syncDirectory(const string &path) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if ( fd < 0 ) {
+		return false;
+	}
+	bool synced = fsync(fd) == 0;
+	close(fd);
+	return synced;
+}
+
+/**
+ * FUNCTION NAME: encodePointer
+ *
+ * DESCRIPTION: The bytes an entry keeps in place of a value in the log
+ */
+static void encodePointer(uint32_t segment, uint64_t offset, uint32_t size, string &pointer) {
+	pointer.clear();
+	putU32(pointer, segment);
+	putU64(pointer, offset);
+	putU32(pointer, size);
+}
+
+static bool decodePointer(string_view pointer, uint32_t &segment, uint64_t &offset, uint32_t &size) {
+	if ( pointer.size() != VLOG_POINTER_SIZE ) {
+		return false;
+	}
+	segment = getU32(pointer.data());
+	offset = getU64(pointer.data() + 4);
+	size = getU32(pointer.data() + 12);
+	return true;
+}
+
+/**
+ * Constructor: open the segments already in directory (which must exist).
+ * New records always go to a new segment.
+ */
+ValueLog::ValueLog(const string &directory): directory(directory), opened(false), head(0), nextSegment(1),
+		collections(0), collectionDone(false), collecting(false) {
+	DIR *dir = opendir(directory.c_str());
+	if ( dir == NULL ) {
+		perror(directory.c_str());
+		return;
+	}
+	for ( struct dirent *file = readdir(dir); file != NULL; file = readdir(dir) ) {
+		string name = file->d_name;
+		if ( name.size() <= 5 || name.compare(name.size() - 5, 5, ".vlog") != 0 ) {
+			continue;
+		}
+		uint32_t number = (uint32_t) strtoul(name.c_str(), NULL, 10);
+		Segment segment;
+		segment.fd = open(segmentPath(number).c_str(), O_RDWR);
+		if ( segment.fd < 0 ) {
+			perror(segmentPath(number).c_str());
+			continue;
+		}
+		segment.size = (uint64_t) lseek(segment.fd, 0, SEEK_END);
+		segment.garbage = 0;
+		segments[number] = segment;
+		nextSegment = max(nextSegment, number + 1);
+	}
+	closedir(dir);
+	opened = true;
+}
+
+/**
+ * Destructor
+ */
+ValueLog::~ValueLog() {
+	waitForCollection();
+	for ( map<uint32_t, Segment>::iterator it = segments.begin(); it != segments.end(); ++it ) {
+		close(it->second.fd);
+	}
+}
+
+bool ValueLog::isOpen() const {
+	return opened;
+}
+
+string ValueLog::segmentPath(uint32_t number) const {
+	char name[32];
+	sprintf(name, "/%06u.vlog", number);
+	return directory + name;
+}
+
+/**
+ * FUNCTION NAME: openHead
+ *
+ * DESCRIPTION: Create a new, empty head segment
+ */
+bool ValueLog::openHead() {
+	uint32_t number = nextSegment++;
+	Segment segment;
+	segment.fd = open(segmentPath(number).c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if ( segment.fd < 0 ) {
+		perror(segmentPath(number).c_str());
+		return false;
+	}
+	segment.size = 0;
+	segment.garbage = 0;
+	segments[number] = segment;
+	head = number;
+	syncDirectory(directory);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: append
+ *
+ * DESCRIPTION: Buffer a record at the end of the head segment. The pointer
+ * 				is valid once sync returns true.
+ */
+void ValueLog::append(string_view key, string_view value, string &pointer) {
+	if ( head == 0 ) {
+		// if there is still no head, sync fails and the pointer is never stored
+		openHead();
+	}
+	uint64_t offset = (head != 0 ? segments[head].size : 0) + pending.size() + VLOG_RECORD_HEADER + key.size();
+	putU32(pending, (uint32_t) key.size());
+	putU32(pending, (uint32_t) value.size());
+	pending.append(key.data(), key.size());
+	pending.append(value.data(), value.size());
+	encodePointer(head, offset, (uint32_t) value.size(), pointer);
+}
+
+/**
+ * FUNCTION NAME: sync
+ *
+ * DESCRIPTION: Write the buffered records at the end of the head segment and
+ * 				sync them. The head is sealed once it is full.
+ *
+ * RETURNS:
+ * false on an I/O error, in which case the buffered records are dropped
+ */
+bool ValueLog::sync() {
+	if ( pending.empty() ) {
+		return true;
+	}
+	if ( head == 0 ) {
+		pending.clear();
+		return false;
+	}
+	Segment &segment = segments[head];
+	size_t done = 0;
+	while ( done < pending.size() ) {
+		ssize_t bytes = pwrite(segment.fd, pending.data() + done, pending.size() - done, segment.size + done);
+		if ( bytes < 0 && errno == EINTR ) {
+			continue;
+		}
+		if ( bytes <= 0 ) {
+			break;
+		}
+		done += bytes;
+	}
+	if ( done < pending.size() || fdatasync(segment.fd) != 0 ) {
+		perror(segmentPath(head).c_str());
+		pending.clear();
+		return false;
+	}
+	segment.size += pending.size();
+	pending.clear();
+	if ( segment.size >= VLOG_SEGMENT_BYTES ) {
+		head = 0;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: read
+ *
+ * DESCRIPTION: Read the value at pointer into value with one pread
+ */
+bool ValueLog::read(string_view pointer, string &value) const {
+	uint32_t number, size;
+	uint64_t offset;
+	if ( !decodePointer(pointer, number, offset, size) ) {
+		return false;
+	}
+	map<uint32_t, Segment>::const_iterator segment = segments.find(number);
+	if ( segment == segments.end() ) {
+		return false;
+	}
+	value.resize(size);
+	size_t done = 0;
+	while ( done < size ) {
+		ssize_t bytes = pread(segment->second.fd, &value[done], size - done, offset + done);
+		if ( bytes < 0 && errno == EINTR ) {
+			continue;
+		}
+		if ( bytes <= 0 ) {
+			perror(segmentPath(number).c_str());
+			return false;
+		}
+		done += bytes;
+	}
+	return true;
+}
+
+void ValueLog::release(string_view pointer) {
+	uint32_t number, size;
+	uint64_t offset;
+	if ( !decodePointer(pointer, number, offset, size) ) {
+		return;
+	}
+	map<uint32_t, Segment>::iterator segment = segments.find(number);
+	if ( segment != segments.end() ) {
+		segment->second.garbage += size;
+	}
+}
+
+/**
+ * FUNCTION NAME: collected
+ *
+ * DESCRIPTION: Hand over the records of a segment the background thread has
+ * 				read, or start reading the next segment due for collection.
+ * 				Cheap when there is nothing to do, so it can run every tick.
+ *
+ * RETURNS:
+ * true if records holds every record of segment
+ */
+bool ValueLog::collected(uint32_t &segment, vector<Record> &records) {
+	records.clear();
+	if ( !collecting ) {
+		startCollection();
+		return false;
+	}
+	if ( !collectionDone.load(std::memory_order_acquire) ) {
+		return false;
+	}
+	collector.join();
+	collecting = false;
+	if ( !job.succeeded ) {
+		return false;
+	}
+	string_view data = job.data;
+	size_t offset = 0;
+	while ( offset + VLOG_RECORD_HEADER <= data.size() ) {
+		size_t keySize = getU32(data.data() + offset);
+		size_t valueSize = getU32(data.data() + offset + 4);
+		size_t end = offset + VLOG_RECORD_HEADER + keySize + valueSize;
+		// a torn record at the end was never pointed at
+		if ( end > data.size() ) {
+			break;
+		}
+		Record record;
+		record.key = data.substr(offset + VLOG_RECORD_HEADER, keySize);
+		record.value = data.substr(offset + VLOG_RECORD_HEADER + keySize, valueSize);
+		encodePointer(job.segment, offset + VLOG_RECORD_HEADER + keySize, (uint32_t) valueSize, record.pointer);
+		records.push_back(record);
+		offset = end;
+	}
+	segment = job.segment;
+	collections++;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: startCollection
+ *
+ * DESCRIPTION: Pick the sealed segment with the most garbage, if enough of
+ * 				it is garbage, and read it on the background thread
+ */
+void ValueLog::startCollection() {
+	uint32_t victim = 0;
+	uint64_t most = 0;
+	for ( map<uint32_t, Segment>::iterator it = segments.begin(); it != segments.end(); ++it ) {
+		const Segment &segment = it->second;
+		if ( it->first == head || find(retired.begin(), retired.end(), it->first) != retired.end() ) {
+			continue;
+		}
+		if ( segment.garbage * 100 >= segment.size * VLOG_GC_PERCENT && segment.garbage > most ) {
+			victim = it->first;
+			most = segment.garbage;
+		}
+	}
+	if ( victim == 0 ) {
+		return;
+	}
+	job.segment = victim;
+	job.fd = segments[victim].fd;
+	job.size = segments[victim].size;
+	job.data.clear();
+	job.succeeded = false;
+	collecting = true;
+	collectionDone.store(false, std::memory_order_relaxed);
+	collector = std::thread(runCollection, &job, &collectionDone);
+}
+
+/**
+ * FUNCTION NAME: runCollection
+ *
+ * DESCRIPTION: Background thread body: read the whole segment. Only touches
+ * 				job; the segment is sealed, so nothing writes to it.
+ */
+void ValueLog::runCollection(Collection *job, std::atomic<bool> *done) {
+	job->data.resize(job->size);
+	size_t read = 0;
+	while ( read < job->size ) {
+		ssize_t bytes = pread(job->fd, &job->data[read], job->size - read, read);
+		if ( bytes < 0 && errno == EINTR ) {
+			continue;
+		}
+		if ( bytes <= 0 ) {
+			break;
+		}
+		read += bytes;
+	}
+	job->succeeded = read == job->size;
+	done->store(true, std::memory_order_release);
+}
+
+void ValueLog::retire(uint32_t segment, bool awaitFlush) {
+	if ( awaitFlush ) {
+		retired.push_back(segment);
+	}
+	else {
+		drop(segment);
+	}
+}
+
+void ValueLog::flushed() {
+	for ( size_t i = 0; i < retired.size(); i++ ) {
+		drop(retired[i]);
+	}
+	retired.clear();
+}
+
+/**
+ * FUNCTION NAME: drop
+ *
+ * DESCRIPTION: Close and delete a segment
+ */
+void ValueLog::drop(uint32_t segment) {
+	map<uint32_t, Segment>::iterator it = segments.find(segment);
+	if ( it == segments.end() ) {
+		return;
+	}
+	close(it->second.fd);
+	unlink(segmentPath(segment).c_str());
+	segments.erase(it);
+}
+
+void ValueLog::waitForCollection() {
+	if ( collecting ) {
+		collector.join();
+		collecting = false;
+	}
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Delete every segment
+ */
+void ValueLog::clear() {
+	waitForCollection();
+	pending.clear();
+	while ( !segments.empty() ) {
+		drop(segments.begin()->first);
+	}
+	retired.clear();
+	head = 0;
+}
+
+uint64_t ValueLog::diskBytes() const {
+	uint64_t bytes = 0;
+	for ( map<uint32_t, Segment>::const_iterator it = segments.begin(); it != segments.end(); ++it ) {
+		bytes += it->second.size;
+	}
+	return bytes;
+}
+
+uint64_t ValueLog::garbageBytes() const {
+	uint64_t bytes = 0;
+	for ( map<uint32_t, Segment>::const_iterator it = segments.begin(); it != segments.end(); ++it ) {
+		bytes += it->second.garbage;
+	}
+	return bytes;
+}
+
+unsigned long ValueLog::getCollections() const {
+	return collections;
+}
@@ -0,0 +1,124 @@
+/**********************************
+ * FILE NAME: ValueLog.h
+ *
+ * DESCRIPTION: Header file of the ValueLog class
+ **********************************/
+
+#ifndef VALUELOG_H_
+#define VALUELOG_H_
+
+#include "stdincludes.h"
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+
+/*
+ * Macros
+ */
+// values of at least this many bytes are kept in the value log
+#define VLOG_MIN_BYTES 1024
+// the head segment is sealed once it holds this many bytes
+#ifndef VLOG_SEGMENT_BYTES
+#define VLOG_SEGMENT_BYTES (16 << 20)
+#endif
+// a sealed segment is collected once this percentage of it is garbage
+#define VLOG_GC_PERCENT 50
+// record header: key size, value size
+#define VLOG_RECORD_HEADER 8
+// pointer kept in place of a value: segment, value offset, value size
+#define VLOG_POINTER_SIZE 16
+
+/*
+ * Value log segment layout (integers in host byte order): records one after
+ * another, each a VLOG_RECORD_HEADER followed by the key and value bytes.
+ * The key is kept so that garbage collection can tell whether the table
+ * still points at the value.
+ */
+
+/**
+ * CLASS NAME: ValueLog
+ *
+ * DESCRIPTION: Large values of a persistent table, kept apart from the
+ * 				sorted runs (key-value separation). When the memtable is
+ * 				written out, each large value is appended to the head segment
+ * 				of the log and the run stores a VLOG_POINTER_SIZE pointer in
+ * 				its place, so compactions rewrite the pointer instead of the
+ * 				value, and runs and their block caches stay small. A value is
+ * 				read back with one pread.
+ *
+ * 				Overwriting or deleting a key releases its old value, counted
+ * 				as garbage of its segment. Once a sealed segment is mostly
+ * 				garbage it is collected: a background thread reads it, then
+ * 				the owner keeps the values the table still points at, appends
+ * 				them at the head and points the table at the copies. The
+ * 				segment is deleted after the next memtable flush, once no run
+ * 				that is read can point into it. Garbage counts live in memory:
+ * 				a reopened log counts only what is released from then on.
+ */
+class ValueLog {
+public:
+	// a record of the segment being collected; views are valid until the next collection
+	struct Record {
+		string_view key;
+		string_view value;
+		string pointer;
+	};
+
+	explicit ValueLog(const string &directory);
+	virtual ~ValueLog();
+	bool isOpen() const;
+	// buffer key and value at the head; pointer receives what the entry keeps in place of the value
+	void append(string_view key, string_view value, string &pointer);
+	// write and sync the buffered records; no pointer to them may be stored before
+	bool sync();
+	bool read(string_view pointer, string &value) const;
+	// the value at pointer is no longer referenced
+	void release(string_view pointer);
+	// the records of a finished collection; otherwise start one if a segment is due
+	bool collected(uint32_t &segment, vector<Record> &records);
+	// a collected segment is done with; delete it now, or after the next flush if awaitFlush
+	void retire(uint32_t segment, bool awaitFlush);
+	// a memtable flush is durable: delete the segments retired before it
+	void flushed();
+	void clear();
+	uint64_t diskBytes() const;
+	uint64_t garbageBytes() const;
+	unsigned long getCollections() const;
+private:
+	struct Segment {
+		int fd;
+		uint64_t size;
+		uint64_t garbage;
+	};
+	struct Collection {
+		uint32_t segment;
+		int fd;
+		uint64_t size;
+		string data;
+		bool succeeded;
+	};
+	string directory;
+	bool opened;
+	map<uint32_t, Segment> segments;
+	// segment appends go to; 0 until the first append
+	uint32_t head;
+	uint32_t nextSegment;
+	string pending;
+	// retired segments, deleted after the next flush
+	vector<uint32_t> retired;
+	unsigned long collections;
+	Collection job;
+	std::thread collector;
+	std::atomic<bool> collectionDone;
+	bool collecting;
+	ValueLog(const ValueLog &anotherLog);
+	ValueLog& operator =(const ValueLog &anotherLog);
+	string segmentPath(uint32_t number) const;
+	bool openHead();
+	void drop(uint32_t segment);
+	void startCollection();
+	void waitForCollection();
+	static void runCollection(Collection *job, std::atomic<bool> *done);
+};
+
+#endif /* VALUELOG_H_ */
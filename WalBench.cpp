@@ -0,0 +1,107 @@
+/**********************************
+ * FILE NAME: WalBench.cpp
+ *
+ * DESCRIPTION: Durable write throughput of HashTable behind a WriteAheadLog,
+ * 				syncing once per write against group commits of growing size
+ *
+ * RUN PROCEDURE:
+ * $ make bench
+ * $ ./WalBench [numWrites [directory]]     e.g. ./WalBench 10000 /var/tmp
+ **********************************/
+
+#include "stdincludes.h"
+#include "WriteAheadLog.h"
+#include "HashTable.h"
+#include <chrono>
+
+/*
+ * Macros
+ */
+#define DEFAULT_WRITES 10000
+#define BENCH_KEY_LENGTH 6
+#define BENCH_VALUE_LENGTH 100
+
+static const char alphanum[] =
+"0123456789"
+"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+"abcdefghijklmnopqrstuvwxyz";
+
+// writes per commit (fsync)
+static const size_t batchSizes[] = {1, 8, 64, 512};
+
+/**
+ * FUNCTION NAME: makeKey
+ *
+ * DESCRIPTION: Deterministic, unique key for index i
+ */
+static void makeKey(uint64_t i, string &key) {
+	uint32_t x = (uint32_t)(i * 2654435761ULL);
+	key.assign(BENCH_KEY_LENGTH, '0');
+	for ( int c = 0; c < BENCH_KEY_LENGTH; c++ ) {
+		key[c] = alphanum[x % 62];
+		x /= 62;
+	}
+}
+
+/**
+ * FUNCTION NAME: run
+ *
+ * DESCRIPTION: Apply numWrites versioned puts to a fresh table and log,
+ * 				committing every batch writes
+ *
+ * RETURNS:
+ * writes per second
+ */
+static double run(const string &path, uint64_t numWrites, size_t batch, unsigned long &commits) {
+	unlink(path.c_str());
+	WriteAheadLog wal;
+	if ( !wal.open(path) ) {
+		exit(FAILURE);
+	}
+	HashTable table;
+	string key;
+	string value(BENCH_VALUE_LENGTH, 'v');
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for ( uint64_t i = 0; i < numWrites; i++ ) {
+		makeKey(i, key);
+		Entry entry(value, i + 1, PRIMARY);
+		if ( table.putIfNewer(key, entry) == WRITE_APPLIED ) {
+			wal.appendPut(key, entry);
+		}
+		if ( wal.pendingRecords() == batch ) {
+			wal.commit();
+		}
+	}
+	wal.commit();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	commits = wal.getCommits();
+	unlink(path.c_str());
+	return numWrites / seconds;
+}
+
+int main(int argc, char *argv[]) {
+	uint64_t numWrites = DEFAULT_WRITES;
+	string directory = "/tmp";
+	if ( argc > 1 ) {
+		numWrites = strtoull(argv[1], NULL, 10);
+	}
+	if ( argc > 2 ) {
+		directory = argv[2];
+	}
+	string path = directory + "/walbench." + to_string(getpid());
+
+	printf("%llu writes of %d byte values, log in %s\n", (unsigned long long)numWrites, BENCH_VALUE_LENGTH,
+			directory.c_str());
+	printf("%8s %10s %14s %12s\n", "batch", "fsyncs", "writes/s", "us/write");
+	double single = 0;
+	for ( size_t b = 0; b < sizeof(batchSizes) / sizeof(batchSizes[0]); b++ ) {
+		unsigned long commits;
+		double writes = run(path, numWrites, batchSizes[b], commits);
+		if ( b == 0 ) {
+			single = writes;
+		}
+		printf("%8zu %10lu %14.0f %12.2f   x%.1f\n", batchSizes[b], commits, writes, 1e6 / writes,
+				writes / single);
+	}
+	return SUCCESS;
+}
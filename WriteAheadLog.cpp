@@ -0,0 +1,233 @@
+/**********************************
+ * FILE NAME: WriteAheadLog.cpp
+ *
+ * DESCRIPTION: WriteAheadLog class definition
+ **********************************/
+
+#include "WriteAheadLog.h"
+
+/**
+ * Constructor
+ */
+WriteAheadLog::WriteAheadLog(): fd(-1), pendingCount(0), logSize(0), torn(false), commits(0), records(0) {}
+
+/**
+ * Destructor: pending records are committed first
+ */
+WriteAheadLog::~WriteAheadLog() {
+	if ( fd >= 0 ) {
+		commit();
+		close(fd);
+	}
+}
+
+/**
+ * FUNCTION NAME: crc32
+ *
+ * DESCRIPTION: CRC-32 (IEEE 802.3, reflected) of bytes
+ */
+uint32_t WriteAheadLog::crc32(string_view bytes) {
+	static uint32_t table[256];
+	static bool tableReady = false;
+	if ( !tableReady ) {
+		for ( uint32_t i = 0; i < 256; i++ ) {
+			uint32_t c = i;
+			for ( int bit = 0; bit < 8; bit++ ) {
+				c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+			}
+			table[i] = c;
+		}
+		tableReady = true;
+	}
+	uint32_t crc = 0xFFFFFFFFU;
+	for ( size_t i = 0; i < bytes.size(); i++ ) {
+		crc = table[(crc ^ (unsigned char) bytes[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc ^ 0xFFFFFFFFU;
+}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Open the log at path for appending, creating it if needed
+ */
+bool WriteAheadLog::open(const string &path) {
+	this->path = path;
+	fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+	if ( fd < 0 ) {
+		perror(path.c_str());
+		return false;
+	}
+	off_t end = lseek(fd, 0, SEEK_END);
+	logSize = end > 0 ? (uint64_t) end : 0;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: replay
+ *
+ * DESCRIPTION: Redo every complete record into table, in log order, then cut
+ * 				off a torn tail so that new records follow valid ones
+ *
+ * RETURNS:
+ * number of records replayed
+ */
+size_t WriteAheadLog::replay(HashTable &table) {
+	string log(logSize, '\0');
+	size_t length = 0;
+	while ( length < log.size() ) {
+		ssize_t n = pread(fd, &log[length], log.size() - length, (off_t) length);
+		if ( n <= 0 ) {
+			break;
+		}
+		length += (size_t) n;
+	}
+	log.resize(length);
+
+	size_t replayed = 0;
+	size_t offset = 0;
+	while ( offset + WAL_RECORD_HEADER <= log.size() ) {
+		uint32_t payloadSize, checksum;
+		memcpy(&payloadSize, &log[offset], 4);
+		memcpy(&checksum, &log[offset + 4], 4);
+		if ( payloadSize < WAL_PAYLOAD_HEADER || offset + WAL_RECORD_HEADER + payloadSize > log.size() ) {
+			break;
+		}
+		string_view payload = string_view(log).substr(offset + WAL_RECORD_HEADER, payloadSize);
+		uint64_t version;
+		uint32_t expiresAt, keySize;
+		memcpy(&version, payload.data() + 2, 8);
+		memcpy(&expiresAt, payload.data() + 10, 4);
+		memcpy(&keySize, payload.data() + 14, 4);
+		if ( crc32(payload) != checksum || WAL_PAYLOAD_HEADER + keySize > payloadSize ) {
+			break;
+		}
+		string_view key = payload.substr(WAL_PAYLOAD_HEADER, keySize);
+		if ( payload[0] == WAL_PUT ) {
+			table.putIfNewer(key, Entry(payload.substr(WAL_PAYLOAD_HEADER + keySize), version,
+					(ReplicaType) payload[1], expiresAt));
+		}
+		else {
+			table.erase(key);
+		}
+		replayed++;
+		offset += WAL_RECORD_HEADER + payloadSize;
+	}
+	if ( offset < logSize ) {
+		fprintf(stderr, "%s: dropping %llu bytes of torn log tail\n", path.c_str(),
+				(unsigned long long)(logSize - offset));
+		if ( ftruncate(fd, (off_t) offset) == 0 ) {
+			logSize = offset;
+		}
+	}
+	return replayed;
+}
+
+/**
+ * FUNCTION NAME: append
+ *
+ * DESCRIPTION: Buffer one record until the next commit
+ */
+void WriteAheadLog::append(WalRecordType type, string_view key, const Entry &entry) {
+	string_view value = entry.value();
+	uint32_t payloadSize = (uint32_t)(WAL_PAYLOAD_HEADER + key.size() + value.size());
+	uint64_t version = entry.getVersion();
+	uint32_t expiresAt = entry.getExpiresAt();
+	uint32_t keySize = (uint32_t) key.size();
+	size_t start = pending.size();
+	pending.append((const char *) &payloadSize, 4);
+	pending.append(4, '\0');
+	pending.push_back((char) type);
+	pending.push_back((char) entry.getReplica());
+	pending.append((const char *) &version, 8);
+	pending.append((const char *) &expiresAt, 4);
+	pending.append((const char *) &keySize, 4);
+	pending.append(key);
+	pending.append(value);
+	uint32_t checksum = crc32(string_view(pending).substr(start + WAL_RECORD_HEADER));
+	memcpy(&pending[start + 4], &checksum, 4);
+	pendingCount++;
+}
+
+void WriteAheadLog::appendPut(string_view key, const Entry &entry) {
+	append(WAL_PUT, key, entry);
+}
+
+void WriteAheadLog::appendDelete(string_view key) {
+	append(WAL_DELETE, key, Entry());
+}
+
+/**
+ * FUNCTION NAME: commit
+ *
+ * DESCRIPTION: Group commit: write every pending record and sync once. If
+ * 				the write or the sync fails, the bytes written are cut off
+ * 				again, so that the next records follow valid ones, and the
+ * 				records stay pending for the next commit to retry.
+ *
+ * RETURNS:
+ * true once the records are durable (or there were none)
+ */
+bool WriteAheadLog::commit() {
+	if ( pendingCount == 0 ) {
+		return true;
+	}
+	// a failed commit may have left a torn record behind
+	if ( torn ) {
+		if ( ftruncate(fd, (off_t) logSize) != 0 ) {
+			perror(path.c_str());
+			return false;
+		}
+		torn = false;
+	}
+	size_t written = 0;
+	while ( written < pending.size() ) {
+		ssize_t n = write(fd, pending.data() + written, pending.size() - written);
+		if ( n < 0 ) {
+			break;
+		}
+		written += (size_t) n;
+	}
+	if ( written < pending.size() || fdatasync(fd) != 0 ) {
+		perror(path.c_str());
+		torn = ftruncate(fd, (off_t) logSize) != 0;
+		return false;
+	}
+	logSize += written;
+	records += pendingCount;
+	commits++;
+	pending.clear();
+	pendingCount = 0;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: reset
+ *
+ * DESCRIPTION: Empty the log. Only called once its records are durable in
+ * 				the table (see HashTable::checkpoint).
+ */
+bool WriteAheadLog::reset() {
+	if ( commit() && ftruncate(fd, 0) == 0 && fsync(fd) == 0 ) {
+		logSize = 0;
+		return true;
+	}
+	perror(path.c_str());
+	return false;
+}
+
+size_t WriteAheadLog::pendingRecords() const {
+	return pendingCount;
+}
+
+uint64_t WriteAheadLog::size() const {
+	return logSize;
+}
+
+unsigned long WriteAheadLog::getCommits() const {
+	return commits;
+}
+
+unsigned long WriteAheadLog::getRecords() const {
+	return records;
+}
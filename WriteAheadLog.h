@@ -0,0 +1,79 @@
+/**********************************
+ * FILE NAME: WriteAheadLog.h
+ *
+ * DESCRIPTION: Header file of the WriteAheadLog class
+ **********************************/
+
+#ifndef WRITEAHEADLOG_H_
+#define WRITEAHEADLOG_H_
+
+#include "stdincludes.h"
+#include "HashTable.h"
+#include <stdint.h>
+
+/*
+ * Macros
+ */
+#define WAL_FILE "wal"
+// once the log is this large the table is checkpointed and the log emptied
+#define WAL_CHECKPOINT_BYTES (8 << 20)
+// record header: payload size, CRC-32 of the payload
+#define WAL_RECORD_HEADER 8
+// payload header: type, replica, version, expiry tick, key size
+#define WAL_PAYLOAD_HEADER 18
+
+enum WalRecordType {WAL_PUT = 1, WAL_DELETE = 2};
+
+/**
+ * CLASS NAME: WriteAheadLog
+ *
+ * DESCRIPTION: Per-node redo log of the writes applied to the HashTable.
+ * 				Records are buffered by append and made durable together by
+ * 				commit, one write and one fdatasync per batch (group commit);
+ * 				MP2Node commits once per tick and holds back the write
+ * 				replies until then.
+ *
+ * 				Only writes that took effect are logged, as the resulting
+ * 				entry or a delete, so replaying the log over a table that
+ * 				already holds some of them (a checkpoint or an automatic
+ * 				memtable flush raced a crash) ends in the same state.
+ * 				Every record carries a CRC-32; replay stops at the first torn
+ * 				or corrupt record and cuts the log there, and a failed commit
+ * 				cuts off what it wrote, so that acknowledged records are never
+ * 				left behind a torn one.
+ */
+class WriteAheadLog {
+public:
+	WriteAheadLog();
+	virtual ~WriteAheadLog();
+	bool open(const string &path);
+	// apply every complete record to table; returns the number replayed
+	size_t replay(HashTable &table);
+	void appendPut(string_view key, const Entry &entry);
+	void appendDelete(string_view key);
+	// write and sync the pending records; on failure they stay pending
+	bool commit();
+	// empty the log once its records are durable elsewhere
+	bool reset();
+	size_t pendingRecords() const;
+	uint64_t size() const;
+	unsigned long getCommits() const;
+	unsigned long getRecords() const;
+private:
+	int fd;
+	string path;
+	string pending;
+	size_t pendingCount;
+	// bytes of complete, synced records
+	uint64_t logSize;
+	// bytes past logSize left by a failed commit are still to be cut off
+	bool torn;
+	unsigned long commits;
+	unsigned long records;
+	WriteAheadLog(const WriteAheadLog &anotherLog);
+	WriteAheadLog& operator =(const WriteAheadLog &anotherLog);
+	void append(WalRecordType type, string_view key, const Entry &entry);
+	static uint32_t crc32(string_view bytes);
+};
+
+#endif /* WRITEAHEADLOG_H_ */
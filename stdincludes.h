@@ -32,6 +32,7 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <string_view>
 #include <algorithm>
 #include <queue>
 #include <fstream>